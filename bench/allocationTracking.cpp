@@ -0,0 +1,53 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#include "allocationTracking.h"
+#include <cstdlib>
+#include <new>
+#include "stats.h"
+
+std::atomic<size_t> AllocationTracking::currentBytes{0};
+std::atomic<size_t> AllocationTracking::peakBytes{0};
+
+namespace {
+    // Every block is prefixed with its size, padded to keep the block maximally aligned
+    constexpr size_t HEADER_SIZE = alignof(std::max_align_t);
+
+    void* allocate(size_t size) noexcept {
+        auto* block = static_cast<unsigned char*>(std::malloc(size + HEADER_SIZE));
+        if (!block) return nullptr;
+        *reinterpret_cast<size_t*>(block) = size;
+        Stats::recordAllocation(size);
+
+        size_t current = AllocationTracking::currentBytes.fetch_add(size, std::memory_order_relaxed) + size;
+        size_t peak = AllocationTracking::peakBytes.load(std::memory_order_relaxed);
+        while (current > peak &&
+               !AllocationTracking::peakBytes.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {}
+        return block + HEADER_SIZE;
+    }
+
+    void deallocate(void* pointer) noexcept {
+        if (!pointer) return;
+        unsigned char* block = static_cast<unsigned char*>(pointer) - HEADER_SIZE;
+        AllocationTracking::currentBytes.fetch_sub(*reinterpret_cast<size_t*>(block), std::memory_order_relaxed);
+        std::free(block);
+    }
+
+    void* allocateOrThrow(size_t size) {
+        void* pointer = allocate(size);
+        if (!pointer) throw std::bad_alloc();
+        return pointer;
+    }
+}
+
+void* operator new(size_t size) { return allocateOrThrow(size); }
+void* operator new[](size_t size) { return allocateOrThrow(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void operator delete(void* pointer) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, size_t) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer); }
@@ -0,0 +1,45 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_ALLOCATIONTRACKING_H
+#define SYPHON_ALLOCATIONTRACKING_H
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <benchmark/benchmark.h>
+
+// Heap accounting for the benchmarks. allocationTracking.cpp replaces the global operator new and delete with
+// versions that keep track of the bytes in use and the highest it has been since the last reset.
+namespace AllocationTracking {
+    extern std::atomic<size_t> currentBytes;
+    extern std::atomic<size_t> peakBytes;
+
+    // Measures the peak heap growth over each iteration, and reports the largest as the peak_bytes counter
+    class PeakMemory {
+    public:
+        void begin() {
+            baseline = currentBytes.load(std::memory_order_relaxed);
+            peakBytes.store(baseline, std::memory_order_relaxed);
+        }
+
+        void end() {
+            largest = std::max(largest, peakBytes.load(std::memory_order_relaxed) - baseline);
+        }
+
+        void report(benchmark::State& state) const {
+            state.counters["peak_bytes"] = benchmark::Counter(static_cast<double>(largest),
+                                                              benchmark::Counter::kDefaults,
+                                                              benchmark::Counter::kIs1024);
+        }
+
+    private:
+        size_t baseline = 0;
+        size_t largest = 0;
+    };
+}
+
+
+#endif //SYPHON_ALLOCATIONTRACKING_H
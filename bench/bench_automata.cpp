@@ -0,0 +1,213 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include "allocationTracking.h"
+#include "automata.h"
+#include "automataTransformations.h"
+#include "compiledDFA.h"
+#include "lexer.h"
+#include "lexerSpec.h"
+#include "lexerStream.h"
+#include "benchKeywordsDirect.h"
+#include "benchKeywordsTable.h"
+#include "benchKeywordsHashed.h"
+
+// A random complete DFA over {a, b}. Each state is duplicated once, so minimization always has half the states to
+// merge on top of whatever the random structure gives it.
+static DFA createRandomDFA(int stateCount, unsigned seed) {
+    std::mt19937 rng(seed);
+    int half = std::max(stateCount / 2, 1);
+    std::vector<int> targetA(half), targetB(half);
+    std::vector<bool> accept(half);
+    for (int state = 0; state < half; ++state) {
+        targetA[state] = static_cast<int>(rng() % half);
+        targetB[state] = static_cast<int>(rng() % half);
+        accept[state] = rng() % 4 == 0;
+    }
+
+    DFA dfa;
+    dfa.setStartState(0);
+    for (int copy = 0; copy < 2; ++copy) {
+        for (int state = 0; state < half; ++state) {
+            int from = copy * half + state;
+            dfa.addState(from, accept[state]);
+            // Jump between the copies, so both stay reachable
+            dfa.addTransition(from, 'a', ((copy + state) % 2) * half + targetA[state]);
+            dfa.addTransition(from, 'b', (1 - copy) * half + targetB[state]);
+        }
+    }
+    return dfa;
+}
+
+static void BM_MinimizeDFA(benchmark::State& state) {
+    DFA dfa = createRandomDFA(static_cast<int>(state.range(0)), 42);
+    size_t minimizedStates = 0;
+    AllocationTracking::PeakMemory memory;
+
+    for (auto _ : state) {
+        memory.begin();
+        DFA minimized = AutomataTransformations::minimize_dfa(dfa);
+        minimizedStates = minimized.getStates().size();
+        benchmark::DoNotOptimize(minimized);
+        memory.end();
+    }
+
+    state.counters["states"] = static_cast<double>(dfa.getStates().size());
+    state.counters["minimized_states"] = static_cast<double>(minimizedStates);
+    memory.report(state);
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_MinimizeDFA)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond)->Complexity(benchmark::oNLogN);
+
+// A small keyword grammar: keywords, identifiers over a-y and 'Z' as separator. The generated lexers are built from
+// the same spec.
+static std::vector<Lexer::Rule> createKeywordRules() {
+    return LexerSpec::fromFile(SYPHON_BENCH_KEYWORDS_SPEC).rules;
+}
+
+static std::string createKeywordInput(size_t size) {
+    const std::vector<std::string> words = {"if", "else", "while", "counter", "value", "return", "index", "for", "x"};
+    std::mt19937 rng(17);
+    std::string input;
+    while (input.size() < size) {
+        input += words[rng() % words.size()];
+        input += 'Z';
+    }
+    return input;
+}
+
+static void BM_LexerTokenize(benchmark::State& state) {
+    Lexer lexer(createKeywordRules());
+    std::string input = createKeywordInput(1 << 20);
+    AllocationTracking::PeakMemory memory;
+
+    for (auto _ : state) {
+        memory.begin();
+        size_t tokens = 0;
+        lexer.forEachToken(input, [&tokens](const Token&) { tokens++; });
+        benchmark::DoNotOptimize(tokens);
+        memory.end();
+    }
+
+    state.counters["states"] = static_cast<double>(lexer.getDFA().getStateCount());
+    memory.report(state);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+}
+BENCHMARK(BM_LexerTokenize)->Unit(benchmark::kMillisecond);
+
+// The same input fed to a streaming session in chunks of the given size
+static void BM_LexerStream(benchmark::State& state) {
+    Lexer lexer(createKeywordRules());
+    std::string input = createKeywordInput(1 << 20);
+    auto chunkSize = static_cast<size_t>(state.range(0));
+    AllocationTracking::PeakMemory memory;
+
+    for (auto _ : state) {
+        memory.begin();
+        LexerStream stream(lexer);
+        size_t tokens = 0;
+        auto count = [&tokens](const Token&) { tokens++; };
+        for (size_t at = 0; at < input.size(); at += chunkSize) {
+            stream.feed(std::string_view(input).substr(at, chunkSize), count);
+        }
+        stream.finish(count);
+        benchmark::DoNotOptimize(tokens);
+        memory.end();
+    }
+
+    state.counters["states"] = static_cast<double>(lexer.getDFA().getStateCount());
+    memory.report(state);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+}
+BENCHMARK(BM_LexerStream)->RangeMultiplier(16)->Range(16, 65536)->Unit(benchmark::kMillisecond);
+
+// Speculative chunked lexing of a larger input, by thread count
+static void BM_LexerTokenizeParallel(benchmark::State& state) {
+    Lexer lexer(createKeywordRules());
+    std::string input = createKeywordInput(16 << 20);
+    auto threadCount = static_cast<unsigned>(state.range(0));
+    AllocationTracking::PeakMemory memory;
+
+    for (auto _ : state) {
+        memory.begin();
+        std::vector<Token> tokens = lexer.tokenizeParallel(input, threadCount);
+        benchmark::DoNotOptimize(tokens);
+        memory.end();
+    }
+
+    state.counters["states"] = static_cast<double>(lexer.getDFA().getStateCount());
+    memory.report(state);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+}
+BENCHMARK(BM_LexerTokenizeParallel)->RangeMultiplier(2)->Range(1, 16)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// The same grammar as BM_LexerTokenize, compiled to C++ by syphonc at build time
+template<typename ForEachToken>
+static void tokenizeGenerated(benchmark::State& state, ForEachToken forEachToken) {
+    std::string input = createKeywordInput(1 << 20);
+    AllocationTracking::PeakMemory memory;
+
+    for (auto _ : state) {
+        memory.begin();
+        size_t tokens = 0;
+        forEachToken(input, [&tokens](const auto&) { tokens++; });
+        benchmark::DoNotOptimize(tokens);
+        memory.end();
+    }
+
+    memory.report(state);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+}
+
+static void BM_GeneratedDirectCodedTokenize(benchmark::State& state) {
+    tokenizeGenerated(state, [](std::string_view input, auto&& onToken) {
+        benchKeywordsDirect::forEachToken(input, onToken);
+    });
+}
+BENCHMARK(BM_GeneratedDirectCodedTokenize)->Unit(benchmark::kMillisecond);
+
+static void BM_GeneratedTableDrivenTokenize(benchmark::State& state) {
+    tokenizeGenerated(state, [](std::string_view input, auto&& onToken) {
+        benchKeywordsTable::forEachToken(input, onToken);
+    });
+}
+BENCHMARK(BM_GeneratedTableDrivenTokenize)->Unit(benchmark::kMillisecond);
+
+// Direct-coded with the keywords looked up in a perfect hash table instead of matched by the DFA
+static void BM_GeneratedKeywordTableTokenize(benchmark::State& state) {
+    tokenizeGenerated(state, [](std::string_view input, auto&& onToken) {
+        benchKeywordsHashed::forEachToken(input, onToken);
+    });
+}
+BENCHMARK(BM_GeneratedKeywordTableTokenize)->Unit(benchmark::kMillisecond);
+
+// The baseline the merged lexer replaces: one matcher per rule, all tried at every token start
+static void BM_SeparateRuleMatchers(benchmark::State& state) {
+    std::vector<CompiledDFA> matchers;
+    for (const auto& rule : createKeywordRules()) {
+        matchers.emplace_back(AutomataTransformations::minimize_dfa(
+                AutomataTransformations::nfa_to_dfa(RegexToNFA::fromRegex(rule.regex))));
+    }
+    std::string input = createKeywordInput(1 << 20);
+
+    for (auto _ : state) {
+        size_t tokens = 0;
+        size_t offset = 0;
+        while (offset < input.size()) {
+            size_t longest = 0;
+            for (const auto& matcher : matchers) {
+                size_t length = matcher.longestPrefix(std::string_view(input).substr(offset));
+                if (length != CompiledDFA::NO_MATCH && length > longest) {
+                    longest = length;
+                }
+            }
+            offset += std::max<size_t>(longest, 1);
+            tokens++;
+        }
+        benchmark::DoNotOptimize(tokens);
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+}
+BENCHMARK(BM_SeparateRuleMatchers)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,599 @@
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <optional>
+#include <random>
+#include "allocationTracking.h"
+#include "automata.h"
+#include "automataTransformations.h"
+#include "bitParallelNFA.h"
+#include "compiledDFA.h"
+#include "dfaLayout.h"
+#include "frozenNFA.h"
+#include "lazyDFA.h"
+#include "lexer.h"
+#include "lexerSpec.h"
+#include "parallelConstruction.h"
+#include "pikeVM.h"
+#include "regexToNFA.h"
+#include "searcher.h"
+
+// Benchmarks for every stage of the pipeline, from parsing a regex to matching with the automaton built from it.
+// Every benchmark reports the states it produces or runs on, the bytes it processes per second (regex bytes for
+// the construction stages, input bytes for matching) and the peak heap growth of an iteration.
+
+using AllocationTracking::PeakMemory;
+
+// (a|b)*a(a|b)^n, whose minimal DFA needs 2^(n+1) states to remember the last n + 1 symbols
+static std::string createExponentialRegex(int n) {
+    std::string regex = "(a|b)*a";
+    for (int i = 0; i < n; ++i) {
+        regex += "(a|b)";
+    }
+    return regex;
+}
+
+// An alternation of count random lowercase keywords of 3 to 10 letters
+static std::string createKeywordAlternation(int count) {
+    std::mt19937 rng(23);
+    std::string regex = "(";
+    for (int keyword = 0; keyword < count; ++keyword) {
+        if (keyword > 0) regex += '|';
+        size_t length = 3 + rng() % 8;
+        for (size_t i = 0; i < length; ++i) {
+            regex += static_cast<char>('a' + rng() % 26);
+        }
+    }
+    return regex + ")";
+}
+
+static std::string createRandomInput(size_t size, const std::string& alphabet, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::string input(size, '\0');
+    for (char& c : input) {
+        c = alphabet[rng() % alphabet.size()];
+    }
+    return input;
+}
+
+static void reportCounters(benchmark::State& state, size_t states, size_t bytesPerIteration,
+                           const PeakMemory& memory) {
+    state.counters["states"] = static_cast<double>(states);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytesPerIteration));
+    memory.report(state);
+}
+
+// Regex parsing
+static void BM_ParseRegex(benchmark::State& state) {
+    std::string regex = createKeywordAlternation(static_cast<int>(state.range(0)));
+    PeakMemory memory;
+
+    for (auto _ : state) {
+        memory.begin();
+        std::string postfix = RegexToNFA::infixToPostfix(regex);
+        benchmark::DoNotOptimize(postfix);
+        memory.end();
+    }
+
+    reportCounters(state, RegexToNFA::fromRegex(regex).getStates().size(), regex.size(), memory);
+}
+BENCHMARK(BM_ParseRegex)->RangeMultiplier(10)->Range(10, 10000)->Unit(benchmark::kMicrosecond);
+
+// Thompson construction
+static void thompsonConstruction(benchmark::State& state, const std::string& regex) {
+    std::string postfix = RegexToNFA::infixToPostfix(regex);
+    PeakMemory memory;
+    size_t states = 0;
+
+    for (auto _ : state) {
+        memory.begin();
+        NFA nfa = RegexToNFA::fromPostfix(postfix);
+        states = nfa.getStates().size();
+        benchmark::DoNotOptimize(nfa);
+        memory.end();
+    }
+
+    reportCounters(state, states, regex.size(), memory);
+}
+
+static void BM_ThompsonExponential(benchmark::State& state) {
+    thompsonConstruction(state, createExponentialRegex(static_cast<int>(state.range(0))));
+}
+BENCHMARK(BM_ThompsonExponential)->RangeMultiplier(4)->Range(4, 1024)->Unit(benchmark::kMicrosecond);
+
+static void BM_ThompsonKeywords(benchmark::State& state) {
+    thompsonConstruction(state, createKeywordAlternation(static_cast<int>(state.range(0))));
+}
+BENCHMARK(BM_ThompsonKeywords)->RangeMultiplier(10)->Range(10, 10000)->Unit(benchmark::kMicrosecond);
+
+// Parsing and Thompson construction into a FrozenNFA, which skips the tree based NFA altogether
+static void BM_FreezeKeywords(benchmark::State& state) {
+    std::vector<std::string> rules = {createKeywordAlternation(static_cast<int>(state.range(0)))};
+    PeakMemory memory;
+    FrozenNFA nfa;
+
+    for (auto _ : state) {
+        memory.begin();
+        nfa = RegexToNFA::frozenFromRules(rules);
+        benchmark::DoNotOptimize(nfa);
+        memory.end();
+    }
+
+    state.counters["nfa_bytes"] = static_cast<double>(nfa.getMemoryUsage());
+    reportCounters(state, static_cast<size_t>(nfa.getStateCount()), rules[0].size(), memory);
+}
+BENCHMARK(BM_FreezeKeywords)->RangeMultiplier(10)->Range(10, 10000)->Unit(benchmark::kMicrosecond);
+
+// Subset construction
+static void subsetConstruction(benchmark::State& state, const std::string& regex) {
+    FrozenNFA nfa(RegexToNFA::fromRegex(regex));
+    PeakMemory memory;
+    size_t states = 0;
+
+    for (auto _ : state) {
+        memory.begin();
+        DFA dfa = AutomataTransformations::nfa_to_dfa(nfa);
+        states = dfa.getStates().size();
+        benchmark::DoNotOptimize(dfa);
+        memory.end();
+    }
+
+    state.counters["nfa_states"] = static_cast<double>(nfa.getStateCount());
+    reportCounters(state, states, regex.size(), memory);
+}
+
+static void BM_SubsetConstructionExponential(benchmark::State& state) {
+    subsetConstruction(state, createExponentialRegex(static_cast<int>(state.range(0))));
+}
+BENCHMARK(BM_SubsetConstructionExponential)->DenseRange(4, 14, 2)->Unit(benchmark::kMillisecond);
+
+static void BM_SubsetConstructionKeywords(benchmark::State& state) {
+    subsetConstruction(state, createKeywordAlternation(static_cast<int>(state.range(0))));
+}
+BENCHMARK(BM_SubsetConstructionKeywords)->RangeMultiplier(10)->Range(10, 10000)->Unit(benchmark::kMillisecond);
+
+// Minimization
+static void minimization(benchmark::State& state, const std::string& regex) {
+    DFA dfa = AutomataTransformations::nfa_to_dfa(RegexToNFA::fromRegex(regex));
+    PeakMemory memory;
+    size_t states = 0;
+
+    for (auto _ : state) {
+        memory.begin();
+        DFA minimized = AutomataTransformations::minimize_dfa(dfa);
+        states = minimized.getStates().size();
+        benchmark::DoNotOptimize(minimized);
+        memory.end();
+    }
+
+    state.counters["dfa_states"] = static_cast<double>(dfa.getStates().size());
+    reportCounters(state, states, regex.size(), memory);
+}
+
+static void BM_MinimizeExponential(benchmark::State& state) {
+    minimization(state, createExponentialRegex(static_cast<int>(state.range(0))));
+}
+BENCHMARK(BM_MinimizeExponential)->DenseRange(4, 14, 2)->Unit(benchmark::kMillisecond);
+
+static void BM_MinimizeKeywords(benchmark::State& state) {
+    minimization(state, createKeywordAlternation(static_cast<int>(state.range(0))));
+}
+BENCHMARK(BM_MinimizeKeywords)->RangeMultiplier(10)->Range(10, 10000)->Unit(benchmark::kMillisecond);
+
+// Subset construction and minimization of 10000 keywords (0) or of (a|b)*a(a|b)^14 (1) on 1, 4 and 16 threads by
+// ParallelConstruction, with thread count 0 standing for the sequential algorithms as the baseline. Wall time, as the
+// work is spread over threads.
+static std::string parallelRegex(const benchmark::State& state) {
+    return state.range(1) == 0 ? createKeywordAlternation(10000) : createExponentialRegex(14);
+}
+
+static void BM_ParallelSubsetConstruction(benchmark::State& state) {
+    std::string regex = parallelRegex(state);
+    FrozenNFA nfa(RegexToNFA::fromRegex(regex));
+    auto threads = static_cast<unsigned>(state.range(0));
+    PeakMemory memory;
+    size_t states = 0;
+
+    for (auto _ : state) {
+        memory.begin();
+        DFA dfa = threads == 0 ? AutomataTransformations::nfa_to_dfa(nfa) : ParallelConstruction::nfa_to_dfa(nfa, threads);
+        states = dfa.getStates().size();
+        benchmark::DoNotOptimize(dfa);
+        memory.end();
+    }
+
+    reportCounters(state, states, regex.size(), memory);
+}
+BENCHMARK(BM_ParallelSubsetConstruction)->ArgsProduct({{0, 1, 4, 16}, {0, 1}})->UseRealTime()
+        ->Unit(benchmark::kMillisecond);
+
+static void BM_ParallelMinimize(benchmark::State& state) {
+    std::string regex = parallelRegex(state);
+    DFA dfa = AutomataTransformations::nfa_to_dfa(RegexToNFA::fromRegex(regex));
+    auto threads = static_cast<unsigned>(state.range(0));
+    PeakMemory memory;
+    size_t states = 0;
+
+    for (auto _ : state) {
+        memory.begin();
+        DFA minimized = threads == 0 ? AutomataTransformations::minimize_dfa(dfa)
+                                     : ParallelConstruction::minimize_dfa(dfa, threads);
+        states = minimized.getStates().size();
+        benchmark::DoNotOptimize(minimized);
+        memory.end();
+    }
+
+    state.counters["dfa_states"] = static_cast<double>(dfa.getStates().size());
+    reportCounters(state, states, regex.size(), memory);
+}
+BENCHMARK(BM_ParallelMinimize)->ArgsProduct({{0, 1, 4, 16}, {0, 1}})->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// The whole pipeline for a bounded repeat of a class, which takes one copy of the class per repetition
+static void BM_CompileBoundedRepeat(benchmark::State& state) {
+    std::string regex = "[^\\n]{1," + std::to_string(state.range(0)) + "}";
+    PeakMemory memory;
+    size_t states = 0;
+
+    for (auto _ : state) {
+        memory.begin();
+        CompiledDFA dfa(AutomataTransformations::minimize_dfa(AutomataTransformations::nfa_to_dfa(
+                RegexToNFA::fromRegex(regex))));
+        states = dfa.getStateCount();
+        benchmark::DoNotOptimize(dfa);
+        memory.end();
+    }
+
+    state.counters["nfa_states"] = static_cast<double>(RegexToNFA::fromRegex(regex).getStates().size());
+    reportCounters(state, states, regex.size(), memory);
+}
+BENCHMARK(BM_CompileBoundedRepeat)->RangeMultiplier(10)->Range(10, 1000)->Unit(benchmark::kMillisecond);
+
+// The whole pipeline for a Unicode property, which compiles to byte range sequences of UTF-8
+static void compileUnicodeProperty(benchmark::State& state, const std::string& regex) {
+    PeakMemory memory;
+    size_t states = 0;
+    size_t columns = 0;
+
+    for (auto _ : state) {
+        memory.begin();
+        CompiledDFA dfa(AutomataTransformations::minimize_dfa(AutomataTransformations::nfa_to_dfa(
+                RegexToNFA::fromRegex(regex))));
+        states = dfa.getStateCount();
+        columns = dfa.getColumnCount();
+        benchmark::DoNotOptimize(dfa);
+        memory.end();
+    }
+
+    state.counters["byte_classes"] = static_cast<double>(columns);
+    state.counters["table_bytes"] = static_cast<double>(states * columns * sizeof(uint32_t));
+    reportCounters(state, states, regex.size(), memory);
+}
+
+static void BM_CompileUnicodeLetters(benchmark::State& state) {
+    compileUnicodeProperty(state, "\\p{L}");
+}
+BENCHMARK(BM_CompileUnicodeLetters)->Unit(benchmark::kMillisecond);
+
+static void BM_CompileUnicodeIdentifier(benchmark::State& state) {
+    compileUnicodeProperty(state, "\\p{XID_Start}\\p{XID_Continue}*");
+}
+BENCHMARK(BM_CompileUnicodeIdentifier)->Unit(benchmark::kMillisecond);
+
+// The whole pipeline for a token grammar, from spec rules to a compiled lexer
+static void BM_CompileTokenGrammar(benchmark::State& state) {
+    std::vector<Lexer::Rule> rules = LexerSpec::fromFile(SYPHON_BENCH_KEYWORDS_SPEC).rules;
+    size_t regexBytes = 0;
+    for (const auto& rule : rules) {
+        regexBytes += rule.regex.size();
+    }
+    PeakMemory memory;
+    size_t states = 0;
+
+    for (auto _ : state) {
+        memory.begin();
+        Lexer lexer(rules);
+        states = lexer.getDFA().getStateCount();
+        benchmark::DoNotOptimize(lexer);
+        memory.end();
+    }
+
+    reportCounters(state, states, regexBytes, memory);
+}
+BENCHMARK(BM_CompileTokenGrammar)->Unit(benchmark::kMicrosecond);
+
+// Matching throughput
+static void BM_MatchCompiledDFA(benchmark::State& state) {
+    CompiledDFA dfa(AutomataTransformations::minimize_dfa(AutomataTransformations::nfa_to_dfa(
+            RegexToNFA::fromRegex(createExponentialRegex(static_cast<int>(state.range(0)))))));
+    std::string input = createRandomInput(1 << 20, "ab", 29);
+    PeakMemory memory;
+
+    for (auto _ : state) {
+        memory.begin();
+        benchmark::DoNotOptimize(dfa.match(input));
+        memory.end();
+    }
+
+    reportCounters(state, dfa.getStateCount(), input.size(), memory);
+}
+BENCHMARK(BM_MatchCompiledDFA)->DenseRange(4, 14, 5)->Unit(benchmark::kMillisecond);
+
+// The cache persists across iterations, so this measures a warm lazy DFA, bounded by the default budget
+static void BM_MatchLazyDFA(benchmark::State& state) {
+    LazyDFA dfa(RegexToNFA::fromRegex(createExponentialRegex(static_cast<int>(state.range(0)))));
+    std::string input = createRandomInput(1 << 20, "ab", 29);
+    PeakMemory memory;
+
+    for (auto _ : state) {
+        memory.begin();
+        benchmark::DoNotOptimize(dfa.match(input));
+        memory.end();
+    }
+
+    state.counters["cache_clears"] = static_cast<double>(dfa.getCacheClears());
+    reportCounters(state, dfa.getCachedStateCount(), input.size(), memory);
+}
+BENCHMARK(BM_MatchLazyDFA)->DenseRange(4, 14, 5)->Unit(benchmark::kMillisecond);
+
+// NFA simulation without determinizing, on the Pike VM (0) or bit-parallel (1). Peak memory stays at zero, as neither
+// engine allocates while matching.
+static void BM_MatchNFASimulation(benchmark::State& state) {
+    FrozenNFA nfa(RegexToNFA::fromRegex(createExponentialRegex(static_cast<int>(state.range(1)))));
+    PikeVM pikeVM(nfa);
+    std::optional<BitParallelNFA> bitParallel;
+    if (state.range(0) == 1) {
+        bitParallel.emplace(nfa);
+    }
+    std::string input = createRandomInput(1 << 20, "ab", 29);
+    PeakMemory memory;
+
+    for (auto _ : state) {
+        memory.begin();
+        benchmark::DoNotOptimize(bitParallel ? bitParallel->match(input) : pikeVM.match(input));
+        memory.end();
+    }
+
+    reportCounters(state, static_cast<size_t>(nfa.getStateCount()), input.size(), memory);
+}
+BENCHMARK(BM_MatchNFASimulation)->ArgsProduct({{0, 1}, {4, 14, 30}})->Args({0, 60})->Unit(benchmark::kMillisecond);
+
+// Lexing key=value pairs, plain (0) or extracting the key and value of every pair with the tagged DFA (1)
+static void BM_LexCaptures(benchmark::State& state) {
+    Lexer lexer({{1, "(?<key>[a-z]+)=(?<value>[0-9]+)"}, {2, "[ \\n]+"}});
+    std::string input;
+    std::mt19937 rng(31);
+    while (input.size() < (1 << 20)) {
+        input += createRandomInput(1 + rng() % 8, "abcdefghijklmnopqrstuvwxyz", rng()) + "=" +
+                 createRandomInput(1 + rng() % 6, "0123456789", rng()) + (rng() % 8 == 0 ? "\n" : " ");
+    }
+    PeakMemory memory;
+    size_t tokens = 0;
+
+    for (auto _ : state) {
+        memory.begin();
+        tokens = 0;
+        if (state.range(0) == 0) {
+            lexer.forEachToken(input, [&tokens](const Token&) { tokens++; });
+        } else {
+            lexer.forEachTokenWithCaptures(input, [&tokens](const Token&, const std::vector<Capture>& captures) {
+                tokens += captures.size() / 2;
+            });
+        }
+        benchmark::DoNotOptimize(tokens);
+        memory.end();
+    }
+
+    state.counters["tagged_states"] = static_cast<double>(lexer.getTaggedDFA()->getStateCount());
+    reportCounters(state, lexer.getDFA().getStateCount(), input.size(), memory);
+}
+BENCHMARK(BM_LexCaptures)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Lexing text made of count keywords with a skewed distribution, the first keywords being the most common, on a DFA
+// in partition order as minimize_dfa leaves it (0), in breadth-first order (1) or laid out by a profile of the first
+// 64 KiB of the input (2)
+static void BM_LexStateLayout(benchmark::State& state) {
+    const int count = static_cast<int>(state.range(1));
+    std::string alternation = createKeywordAlternation(count);
+    std::vector<std::string> keywords;
+    for (size_t begin = 1, end; begin < alternation.size(); begin = end + 1) {
+        end = alternation.find_first_of("|)", begin);
+        keywords.push_back(alternation.substr(begin, end - begin));
+    }
+    std::string input;
+    std::mt19937 rng(37);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    while (input.size() < (1 << 20)) {
+        double u = uniform(rng);
+        input += keywords[static_cast<size_t>(u * u * u * static_cast<double>(keywords.size()))] + " ";
+    }
+
+    CompiledDFA dfa(AutomataTransformations::minimize_dfa(AutomataTransformations::nfa_to_dfa(
+            RegexToNFA::frozenFromRules({alternation, "[a-z]+", " +"}))));
+    if (state.range(0) == 1) {
+        dfa = dfa.renumbered(DFALayout::breadthFirst(dfa));
+    } else if (state.range(0) == 2) {
+        dfa = dfa.renumbered(DFALayout::byProfile(dfa, DFALayout::countVisits(dfa, input.substr(0, 1 << 16))));
+    }
+    Lexer lexer(dfa, {1, 2, 3});
+    PeakMemory memory;
+
+    for (auto _ : state) {
+        memory.begin();
+        size_t tokens = 0;
+        lexer.forEachToken(input, [&tokens](const Token&) { tokens++; });
+        benchmark::DoNotOptimize(tokens);
+        memory.end();
+    }
+
+    state.counters["table_bytes"] = static_cast<double>(dfa.getStateCount() * dfa.getColumnCount() *
+                                                        dfa.getStateWidth());
+    reportCounters(state, dfa.getStateCount(), input.size(), memory);
+}
+BENCHMARK(BM_LexStateLayout)->ArgsProduct({{0, 1, 2}, {100, 5000}})->Unit(benchmark::kMillisecond);
+
+// Lexing the text of BM_LexStateLayout with the transitions in the dense table (0) or the comb (1), to weigh the size
+// of the tables against the extra compare of a comb step
+static void BM_LexTableEncoding(benchmark::State& state) {
+    const int count = static_cast<int>(state.range(1));
+    std::string alternation = createKeywordAlternation(count);
+    std::vector<std::string> keywords;
+    for (size_t begin = 1, end; begin < alternation.size(); begin = end + 1) {
+        end = alternation.find_first_of("|)", begin);
+        keywords.push_back(alternation.substr(begin, end - begin));
+    }
+    std::string input;
+    std::mt19937 rng(37);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    while (input.size() < (1 << 20)) {
+        double u = uniform(rng);
+        input += keywords[static_cast<size_t>(u * u * u * static_cast<double>(keywords.size()))] + " ";
+    }
+
+    CompiledDFA dfa(AutomataTransformations::minimize_dfa(AutomataTransformations::nfa_to_dfa(
+            RegexToNFA::frozenFromRules({alternation, "[a-z]+", " +"}))),
+                    state.range(0) == 0 ? CompiledDFA::Encoding::DENSE : CompiledDFA::Encoding::COMB);
+    Lexer lexer(dfa, {1, 2, 3});
+    PeakMemory memory;
+
+    for (auto _ : state) {
+        memory.begin();
+        size_t tokens = 0;
+        lexer.forEachToken(input, [&tokens](const Token&) { tokens++; });
+        benchmark::DoNotOptimize(tokens);
+        memory.end();
+    }
+
+    state.counters["table_bytes"] = static_cast<double>(dfa.getMemoryUsage());
+    reportCounters(state, dfa.getStateCount(), input.size(), memory);
+}
+BENCHMARK(BM_LexTableEncoding)->ArgsProduct({{0, 1}, {100, 5000}})->Unit(benchmark::kMillisecond);
+
+// Lexing the keywords of BM_LexStateLayout, every other word an identifier that is no keyword, with the keywords
+// merged into the DFA (0) or in a keyword table the identifier rule's tokens are looked up in (1). Reports the time
+// to build the lexer as build_seconds.
+static void BM_LexKeywordTable(benchmark::State& state) {
+    const int count = static_cast<int>(state.range(1));
+    std::string alternation = createKeywordAlternation(count);
+    std::vector<std::string> keywords;
+    for (size_t begin = 1, end; begin < alternation.size(); begin = end + 1) {
+        end = alternation.find_first_of("|)", begin);
+        keywords.push_back(alternation.substr(begin, end - begin));
+    }
+    std::string input;
+    std::mt19937 rng(37);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    while (input.size() < (1 << 20)) {
+        double u = uniform(rng);
+        input += keywords[static_cast<size_t>(u * u * u * static_cast<double>(keywords.size()))] + " ";
+        for (size_t length = 1 + rng() % 10; length > 0; --length) {
+            input += static_cast<char>('a' + rng() % 26);
+        }
+        input += ' ';
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Lexer lexer({{1, alternation}, {2, "[a-z]+"}, {3, " +"}}, CompiledDFA::Encoding::DENSE, {}, 1, state.range(0) == 1);
+    double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    PeakMemory memory;
+
+    for (auto _ : state) {
+        memory.begin();
+        size_t tokens = 0;
+        lexer.forEachToken(input, [&tokens](const Token&) { tokens++; });
+        benchmark::DoNotOptimize(tokens);
+        memory.end();
+    }
+
+    state.counters["build_seconds"] = buildSeconds;
+    state.counters["keywords"] = static_cast<double>(lexer.getKeywordTable().size());
+    state.counters["table_bytes"] = static_cast<double>(lexer.getDFA().getMemoryUsage() +
+                                                        lexer.getKeywordTable().getMemoryUsage());
+    reportCounters(state, lexer.getDFA().getStateCount(), input.size(), memory);
+}
+BENCHMARK(BM_LexKeywordTable)->ArgsProduct({{0, 1}, {100, 5000}})->Unit(benchmark::kMillisecond);
+
+// Unanchored search over a sparse-match corpus: random lowercase text with a match planted every 16 KiB
+static std::string createSparseCorpus(const std::vector<std::string>& needles) {
+    std::string corpus = createRandomInput(1 << 20, "abcdefghijklmnopqrstuvwxyz", 53);
+    for (size_t at = 8192, i = 0; at + 16 < corpus.size(); at += 16384, ++i) {
+        const std::string& needle = needles[i % needles.size()];
+        corpus.replace(at, needle.size(), needle);
+    }
+    return corpus;
+}
+
+static void search(benchmark::State& state, const std::string& regex, const std::vector<std::string>& needles) {
+    Searcher searcher(regex, state.range(0) != 0);
+    std::string corpus = createSparseCorpus(needles);
+    PeakMemory memory;
+    size_t matches = 0;
+
+    for (auto _ : state) {
+        memory.begin();
+        matches = searcher.findAll(corpus).size();
+        benchmark::DoNotOptimize(matches);
+        memory.end();
+    }
+
+    state.counters["matches"] = static_cast<double>(matches);
+    state.counters["literals"] = static_cast<double>(searcher.getPrefilter().getLiterals().size());
+    reportCounters(state, searcher.getDFA().getStateCount(), corpus.size(), memory);
+}
+
+// Argument 1 searches with the prefilter, 0 without
+static void BM_SearchLiteral(benchmark::State& state) {
+    search(state, "syphon", {"syphon"});
+}
+BENCHMARK(BM_SearchLiteral)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+static void BM_SearchAlternation(benchmark::State& state) {
+    search(state, "(syph|lex)(on|er)", {"syphon", "lexer", "lexon", "syphon"});
+}
+BENCHMARK(BM_SearchAlternation)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+static void BM_SearchFirstByteSet(benchmark::State& state) {
+    search(state, "(q|x|z)(q|x|z)(q|x|z)(q|x|z)", {"qxzq", "zzxq"});
+}
+BENCHMARK(BM_SearchFirstByteSet)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// (a|b)*c over a's and b's with no c: every position starts a scan to the end of the input, so searching by
+// restarting an anchored scan at each position is quadratic, while findAll's forward and reverse passes stay linear.
+// Argument 1 uses findAll, 0 restarts find after every match.
+static void BM_SearchUnanchoredNoMatch(benchmark::State& state) {
+    Searcher searcher("(a|b)*c");
+    std::string input = createRandomInput(static_cast<size_t>(state.range(1)), "ab", 61);
+    PeakMemory memory;
+
+    for (auto _ : state) {
+        memory.begin();
+        if (state.range(0) != 0) {
+            benchmark::DoNotOptimize(searcher.findAll(input));
+        } else {
+            benchmark::DoNotOptimize(searcher.find(input));
+        }
+        memory.end();
+    }
+
+    reportCounters(state, searcher.getDFA().getStateCount(), input.size(), memory);
+}
+BENCHMARK(BM_SearchUnanchoredNoMatch)->ArgsProduct({{0, 1}, {1 << 10, 1 << 13, 1 << 16}})
+        ->Unit(benchmark::kMicrosecond);
+
+// a|a(a|b)*c over a run of a's: every match is a single a, but the anchored scan extending it runs on to the end of the
+// input looking for the c. findAll stops each scan where an earlier one already found nothing, so the time stays
+// linear in the input.
+static void BM_SearchFindAllOverlappingScans(benchmark::State& state) {
+    Searcher searcher("a|a(a|b)*c");
+    std::string input(static_cast<size_t>(state.range(0)), 'a');
+    PeakMemory memory;
+
+    for (auto _ : state) {
+        memory.begin();
+        benchmark::DoNotOptimize(searcher.findAll(input));
+        memory.end();
+    }
+
+    state.SetComplexityN(state.range(0));
+    reportCounters(state, searcher.getDFA().getStateCount(), input.size(), memory);
+}
+BENCHMARK(BM_SearchFindAllOverlappingScans)->RangeMultiplier(4)->Range(10000, 640000)->Unit(benchmark::kMillisecond)
+        ->Complexity(benchmark::oN);
@@ -0,0 +1,12 @@
+# The keyword grammar the lexer benchmarks run on: keywords, identifiers over a-y and 'Z' as separator
+IF       if
+ELSE     else
+WHILE    while
+FOR      for
+RETURN   return
+BREAK    break
+CONTINUE continue
+SWITCH   switch
+CASE     case
+IDENT    [a-y]+
+SEPARATOR Z
@@ -6,6 +6,7 @@
 #define SYPHON_AUTOMATA_H
 
 
+#include <cstdint>
 #include <set>
 #include <string>
 #include <map>
@@ -18,11 +19,80 @@ class State;
 class NFA;
 class DFA;
 static const char EPSILON = '\0'; // Epsilon transition symbol
+static const int NO_RULE = -1; // Rule of a state that accepts nothing
+static const int NO_TAG = -1; // Tag of an edge that records no position
+
+// Storage for Thompson construction. Every fragment adds its states and edges here as it is built, so combining
+// fragments never copies transitions.
+struct NFAArena {
+    // An edge on a byte, or an epsilon edge. An epsilon edge may carry a tag, which records the position it is
+    // taken at for capture groups.
+    struct Edge {
+        int fromState;
+        char symbol;
+        int16_t tag;
+        int toState;
+    };
+
+    // An edge on every byte from low to high, so character classes take one edge per range instead of per byte
+    struct RangeEdge {
+        int fromState;
+        unsigned char low;
+        unsigned char high;
+        int toState;
+    };
 
+    // A position in the arena. Everything added between two marks can be copied as a unit.
+    struct Mark {
+        int state;
+        size_t edge;
+        size_t rangeEdge;
+    };
+
+    int stateCount = 0;
+    std::vector<Edge> edges;
+    std::vector<RangeEdge> rangeEdges;
+
+    int addState() {
+        return stateCount++;
+    }
+
+    void addEdge(int fromState, char symbol, int toState) {
+        edges.push_back({fromState, symbol, NO_TAG, toState});
+    }
+
+    void addTagEdge(int fromState, int tag, int toState) {
+        edges.push_back({fromState, EPSILON, static_cast<int16_t>(tag), toState});
+    }
+
+    void addRangeEdge(int fromState, unsigned char low, unsigned char high, int toState) {
+        rangeEdges.push_back({fromState, low, high, toState});
+    }
+
+    [[nodiscard]] Mark mark() const {
+        return {stateCount, edges.size(), rangeEdges.size()};
+    }
+
+    // Adds a copy of the states and edges added between from and to. Returns the offset of the copied state ids.
+    int copy(const Mark& from, const Mark& to) {
+        int offset = stateCount - from.state;
+        stateCount += to.state - from.state;
+        for (size_t i = from.edge; i < to.edge; ++i) {
+            Edge edge = edges[i];
+            edges.push_back({edge.fromState + offset, edge.symbol, edge.tag, edge.toState + offset});
+        }
+        for (size_t i = from.rangeEdge; i < to.rangeEdge; ++i) {
+            RangeEdge edge = rangeEdges[i];
+            rangeEdges.push_back({edge.fromState + offset, edge.low, edge.high, edge.toState + offset});
+        }
+        return offset;
+    }
+};
+
+// A handle to a partially built automaton inside an NFAArena
 struct NFAFragment {
     int startState;
-    std::set<int> acceptStates;
-    std::map<std::pair<int, char>, std::set<int>> transitions;
+    std::vector<int> acceptStates;
 
     explicit NFAFragment(int start) : startState(start) {}
 };
@@ -33,6 +103,7 @@ protected:
     std::set<char> alphabet;
     int startState;
     std::set<int> acceptStates;
+    std::map<int, int> acceptRules; // Rule of each accept state, for automata built from several rules
 
 public:
     FiniteAutomaton() : startState(0) {}
@@ -46,6 +117,12 @@ public:
         }
     }
 
+    // Mark a state as accepting on behalf of a rule. Lower rules take priority when states get merged.
+    void setAcceptRule(int state, int rule) {
+        addState(state, true);
+        acceptRules[state] = rule;
+    }
+
     // Add a symbol to the alphabet
     virtual void addSymbol(char symbol) {
         alphabet.insert(symbol);
@@ -61,7 +138,7 @@ public:
 
     virtual void displayTransitionTable() const = 0;
 
-    [[nodiscard]] std::set<int> getStates() const {
+    [[nodiscard]] const std::set<int>& getStates() const {
         return states;
     }
     [[nodiscard]] int getStartState() const {
@@ -72,6 +149,19 @@ public:
         return acceptStates;
     }
 
+    // The rule an accept state belongs to. Accept states without a rule belong to rule 0, other states to NO_RULE.
+    [[nodiscard]] int getAcceptRule(int state) const {
+        auto it = acceptRules.find(state);
+        if (it != acceptRules.end()) {
+            return it->second;
+        }
+        return acceptStates.find(state) != acceptStates.end() ? 0 : NO_RULE;
+    }
+
+    [[nodiscard]] const std::map<int, int>& getAcceptRules() const {
+        return acceptRules;
+    }
+
     [[nodiscard]] const std::set<char>& getAlphabet() const{
         return alphabet;
     }
@@ -86,14 +176,15 @@ private:
 public:
     DFA() : FiniteAutomaton() {}
 
+    // Transitions added in key order, as the construction algorithms do, are appended in constant time
     void addTransition(int fromState, char symbol, int toState) {
         states.insert(fromState);
         states.insert(toState);
         alphabet.insert(symbol);
-        transitionTable[{fromState, symbol}] = toState;
+        transitionTable.insert_or_assign(transitionTable.end(), {fromState, symbol}, toState);
     }
 
-    [[nodiscard]] const std::map<std::pair<int, char>, int> getTransitionTable() const {
+    [[nodiscard]] const std::map<std::pair<int, char>, int>& getTransitionTable() const {
         return transitionTable;
     }
 
@@ -127,8 +218,17 @@ public:
 };
 
 class NFA : public FiniteAutomaton {
+public:
+    // A transition on every byte from low to high
+    struct RangeTransition {
+        unsigned char low;
+        unsigned char high;
+        int toState;
+    };
+
 private:
     std::map<std::pair<int, char>, std::set<int>> transitionTable;
+    std::map<int, std::vector<RangeTransition>> rangeTransitions;
 
 
 public:
@@ -137,21 +237,22 @@ public:
         alphabet.insert(EPSILON);
     }
 
-    explicit NFA(const NFAFragment& fragment) : FiniteAutomaton() {
+    NFA(const NFAArena& arena, const NFAFragment& fragment) : FiniteAutomaton() {
         alphabet.insert(EPSILON);
 
-        // Copy transitions from fragment
-        for (auto &transition : fragment.transitions) {
-            auto &fromState = transition.first.first;
-            auto &symbol = transition.first.second;
-            for (auto &toState : transition.second) {
-                addTransition(fromState, symbol, toState);
-            }
+        for (int state = 0; state < arena.stateCount; ++state) {
+            addState(state);
+        }
+        for (const auto& edge : arena.edges) {
+            addTransition(edge.fromState, edge.symbol, edge.toState);
+        }
+        for (const auto& edge : arena.rangeEdges) {
+            addRangeTransition(edge.fromState, edge.low, edge.high, edge.toState);
         }
 
         // Set start and accept states
         startState = fragment.startState;
-        acceptStates = fragment.acceptStates;
+        acceptStates.insert(fragment.acceptStates.begin(), fragment.acceptStates.end());
     }
     [[nodiscard]] const std::map<std::pair<int, char>, std::set<int>>& getTransitionTable() const {
         return transitionTable;
@@ -166,6 +267,36 @@ public:
         transitionTable[{fromState, symbol}].insert(toState);
     }
 
+    // Range transitions live apart from the per-symbol table, and are never epsilon transitions even if low is 0
+    void addRangeTransition(int fromState, unsigned char low, unsigned char high, int toState) {
+        states.insert(fromState);
+        states.insert(toState);
+        for (int byte = low; byte <= high; ++byte) {
+            alphabet.insert(static_cast<char>(byte));
+        }
+        rangeTransitions[fromState].push_back({low, high, toState});
+    }
+
+    [[nodiscard]] const std::map<int, std::vector<RangeTransition>>& getRangeTransitions() const {
+        return rangeTransitions;
+    }
+
+    // Every state reachable from state on byte, through a per-symbol or range transition
+    [[nodiscard]] std::set<int> move(int state, unsigned char byte) const {
+        std::set<int> targets;
+        auto it = transitionTable.find({state, static_cast<char>(byte)});
+        if (it != transitionTable.end() && static_cast<char>(byte) != EPSILON) {
+            targets = it->second;
+        }
+        auto ranges = rangeTransitions.find(state);
+        if (ranges != rangeTransitions.end()) {
+            for (const auto& range : ranges->second) {
+                if (range.low <= byte && byte <= range.high) targets.insert(range.toState);
+            }
+        }
+        return targets;
+    }
+
     std::set<int> epsilonClosure(int state) const {
         std::set<int> closure = {state};
         std::queue<int> queue;
@@ -236,6 +367,13 @@ public:
 
             std::cout << (acceptStates.find(state) != acceptStates.end() ? "Yes" : "No") << std::endl;
         }
+
+        for (const auto& [state, ranges] : rangeTransitions) {
+            for (const auto& range : ranges) {
+                std::cout << state << " [" << static_cast<int>(range.low) << "-" << static_cast<int>(range.high)
+                          << "] " << range.toState << std::endl;
+            }
+        }
     }
 };
 
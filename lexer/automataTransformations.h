@@ -7,261 +7,380 @@
 
 
 #include <algorithm>
+#include <array>
+#include <climits>
+#include <limits>
+#include <unordered_map>
 #include "automata.h"
+#include "byteClasses.h"
+#include "constructionBudget.h"
+#include "frozenNFA.h"
+#include "stats.h"
+#include "subsetConstruction.h"
 
 class AutomataTransformations {
 public:
-    // This uses the subset construction algorithm to convert an NFA to a DFA
-    static DFA nfa_to_dfa(const NFA& nfa) {
-        DFA dfa;
-        std::map<std::set<int>, int> stateMapping;  // Maps NFA state sets to DFA states
-        std::queue<std::set<int>> stateQueue;
+    // This uses the subset construction algorithm to convert an NFA to a DFA. Epsilon closures and per-class moves
+    // are precomputed by SubsetConstruction, and DFA states are interned by their sorted NFA state set. An NFA is
+    // frozen first, so building a FrozenNFA directly saves the conversion. Throws ConstructionBudgetExceeded if the
+    // DFA outgrows the budget; HybridDFA determinizes only as much as fits instead.
+    static DFA nfa_to_dfa(const NFA& nfa, const ConstructionBudget& budget = {}) {
+        return nfa_to_dfa(FrozenNFA(nfa), budget);
+    }
 
-        if (nfa.getStates().empty()) {
+    static DFA nfa_to_dfa(const FrozenNFA& nfa, const ConstructionBudget& budget = {}) {
+        Stats::PhaseTimer timer(&Stats::Construction::subsetConstruction);
+        DFA dfa;
+        if (nfa.empty()) {
             return dfa;
         }
-
-        // Compute epsilon closure of start state
-        std::set<int> startState = nfa.epsilonClosure(nfa.getStartState());
-
-        // Assign the first DFA state
-        int nextDFAState = 0;
-        stateMapping[startState] = nextDFAState;
-        dfa.setStartState(nextDFAState);
-        dfa.addState(nextDFAState,
-                // Check if the start state set contains any accept states
-                     std::any_of(startState.begin(), startState.end(),
-                                 [&nfa](int state) {
-                                     return nfa.getAcceptState().find(state) != nfa.getAcceptState().end();
-                                 })
-        );
-        stateQueue.push(startState);
-        nextDFAState++;
-
-        while (!stateQueue.empty()) {
-            std::set<int> currentStateSet = stateQueue.front();
-            stateQueue.pop();
-            int currentDFAState = stateMapping[currentStateSet];
-
-            // Iterate through non-epsilon alphabet symbols
-            for (char symbol : nfa.getAlphabet()) {
-                if (symbol == EPSILON) continue;
-
-                // Compute next state set
-                std::set<int> nextStateSet;
-                for (int state : currentStateSet) {
-                    auto transitions = nfa.getTransitionTable().find({state, symbol});
-                    if (transitions != nfa.getTransitionTable().end()) {
-                        for (int targetState : transitions->second) {
-                            // Compute epsilon closure for each target state
-                            std::set<int> closure = nfa.epsilonClosure(targetState);
-                            nextStateSet.insert(closure.begin(), closure.end());
-                        }
-                    }
+        BudgetMeter meter(budget);
+
+        SubsetConstruction subsets(nfa);
+        std::unordered_map<std::vector<int>, int, StateSetHash> stateMapping;  // Maps NFA state sets to DFA states
+        std::vector<const std::vector<int>*> stateSets;  // DFA states in creation order, doubling as the BFS queue
+
+        // With rule tags, a DFA state accepts for the first rule any of its NFA states accepts
+        const bool tagged = nfa.hasAcceptRules();
+        auto internState = [&](std::vector<int>&& stateSet) {
+            auto [it, inserted] = stateMapping.try_emplace(std::move(stateSet), static_cast<int>(stateSets.size()));
+            Stats::add(&Stats::Construction::subsetLookups);
+            Stats::add(&Stats::Construction::subsetHits, inserted ? 0 : 1);
+            if (inserted) {
+                meter.addState(it->first);
+                int rule = subsets.ruleOf(it->first);
+                if (tagged && rule != NO_RULE) {
+                    dfa.setAcceptRule(it->second, rule);
+                } else {
+                    dfa.addState(it->second, rule != NO_RULE);
                 }
+                stateSets.push_back(&it->first);
+            }
+            return it->second;
+        };
 
-                // If next state set is not empty
-                if (!nextStateSet.empty()) {
-                    // Check if this state set is already mapped
-                    auto mappingIt = stateMapping.find(nextStateSet);
-                    int nextDFAStateIndex;
-
-                    if (mappingIt == stateMapping.end()) {
-                        // Create a new DFA state
-                        nextDFAStateIndex = nextDFAState;
-                        stateMapping[nextStateSet] = nextDFAStateIndex;
-
-                        // Check if the new state set contains any accept states
-                        bool isAcceptState = std::any_of(nextStateSet.begin(), nextStateSet.end(),
-                                                         [&nfa](int state) {
-                                                             return nfa.getAcceptState().find(state) != nfa.getAcceptState().end();
-                                                         });
-
-                        dfa.addState(nextDFAStateIndex, isAcceptState);
-                        stateQueue.push(nextStateSet);
-                        nextDFAState++;
-                    } else {
-                        // Use existing mapped state
-                        nextDFAStateIndex = mappingIt->second;
-                    }
+        dfa.setStartState(internState(std::vector<int>(subsets.startSet())));
+
+        std::vector<std::vector<int>> successors(subsets.getClassCount());
+        std::vector<int> classTargets(subsets.getClassCount());
+        for (size_t current = 0; current < stateSets.size(); ++current) {
+            if (!meter.expand()) {
+                throw ConstructionBudgetExceeded(meter.finish());
+            }
+            subsets.moveAll(*stateSets[current], successors);
 
-                    // Add transition to the DFA
-                    dfa.addTransition(currentDFAState, symbol, nextDFAStateIndex);
+            for (int symbolClass = 0; symbolClass < subsets.getClassCount(); ++symbolClass) {
+                classTargets[symbolClass] = -1;
+                if (successors[symbolClass].empty()) continue;
+
+                classTargets[symbolClass] = internState(std::move(successors[symbolClass]));
+                successors[symbolClass].clear();
+            }
+
+            // Symbol order keeps the transition table appends in key order
+            size_t transitions = 0;
+            for (int symbol = CHAR_MIN; symbol <= CHAR_MAX; ++symbol) {
+                int target = classTargets[subsets.classOf(static_cast<unsigned char>(symbol))];
+                if (target >= 0) {
+                    dfa.addTransition(static_cast<int>(current), static_cast<char>(symbol), target);
+                    transitions++;
                 }
             }
+            meter.addTransitions(transitions, DFA_TRANSITION_BYTES);
         }
 
+        Stats::set(&Stats::Construction::dfaStates, stateSets.size());
         return dfa;
     }
 
-    // Minimize a DFA using Hopcroft's algorithm
+    // Minimize a DFA using Hopcroft's algorithm. Accept states of different rules are never merged. Missing
+    // transitions are treated as going to an implicit sink state, which is dropped again from the result together
+    // with every state equivalent to it. Unreachable states are dropped as well. Runs in O(n * k * log n) for n states
+    // and k byte classes.
     static DFA minimize_dfa(const DFA& originalDfa) {
+        Stats::PhaseTimer timer(&Stats::Construction::minimization);
+        if (originalDfa.getStates().empty()) {
+            return {};
+        }
+
+        // Step 1: Number the states densely and flatten the transitions into an array with one column per byte class.
+        // The transition table is ordered by source state, so one sequential pass over it fills every row.
         const auto& transitionTable = originalDfa.getTransitionTable();
+        ByteClasses byteClasses = ByteClasses::fromDFA(originalDfa);
+
+        std::vector<int> originalStates(originalDfa.getStates().begin(), originalDfa.getStates().end());
+        auto indexOf = [&originalStates](int state) {
+            return static_cast<int>(std::lower_bound(originalStates.begin(), originalStates.end(), state) - originalStates.begin());
+        };
+
+        const int symbolCount = byteClasses.getClassCount();
+        const int sink = static_cast<int>(originalStates.size());
+        const int stateCount = sink + 1;
+        std::vector<int> delta(static_cast<size_t>(stateCount) * symbolCount, sink);
+        int from = 0;
+        for (const auto& [key, toState] : transitionTable) {
+            while (originalStates[from] != key.first) from++;
+            delta[static_cast<size_t>(from) * symbolCount + byteClasses.classOf(static_cast<unsigned char>(key.second))] = indexOf(toState);
+        }
 
-        // Step 1: Partition states into accept and non-accept states
-        std::vector<std::set<int>> partition;
-        std::set<int> acceptStates, nonAcceptStates;
+        const int start = indexOf(originalDfa.getStartState());
+        std::vector<bool> reachable(stateCount, false);
+        {
+            std::vector<int> stack = {start};
+            reachable[start] = true;
+            while (!stack.empty()) {
+                int state = stack.back();
+                stack.pop_back();
+                for (int symbol = 0; symbol < symbolCount; ++symbol) {
+                    int target = delta[static_cast<size_t>(state) * symbolCount + symbol];
+                    if (!reachable[target]) {
+                        reachable[target] = true;
+                        stack.push_back(target);
+                    }
+                }
+            }
+        }
 
-        // Separate states into accept and non-accept groups
-        for (auto& state: originalDfa.getStates()) {
-            if (originalDfa.getAcceptState().find(state) != originalDfa.getAcceptState().end()) {
-                acceptStates.insert(state);
-            } else {
-                nonAcceptStates.insert(state);
+        // Step 2: Index the transitions backwards, so a splitter can find its predecessors per symbol
+        std::vector<int> inverseStart(static_cast<size_t>(symbolCount) * stateCount + 1, 0);
+        for (int state = 0; state < stateCount; ++state) {
+            for (int symbol = 0; symbol < symbolCount; ++symbol) {
+                inverseStart[static_cast<size_t>(symbol) * stateCount + delta[static_cast<size_t>(state) * symbolCount + symbol] + 1]++;
+            }
+        }
+        for (size_t i = 1; i < inverseStart.size(); ++i) {
+            inverseStart[i] += inverseStart[i - 1];
+        }
+        std::vector<int> inverseSources(inverseStart.back());
+        {
+            std::vector<int> fill(inverseStart.begin(), inverseStart.end() - 1);
+            for (int state = 0; state < stateCount; ++state) {
+                for (int symbol = 0; symbol < symbolCount; ++symbol) {
+                    int target = delta[static_cast<size_t>(state) * symbolCount + symbol];
+                    inverseSources[fill[static_cast<size_t>(symbol) * stateCount + target]++] = state;
+                }
             }
         }
 
-        // Only add non-empty sets to the partition
-        if (!acceptStates.empty()) partition.push_back(acceptStates);
-        if (!nonAcceptStates.empty()) partition.push_back(nonAcceptStates);
-
-        // Step 2: Iteratively refine the partition
-        bool partitionChanged;
-        do {
-            partitionChanged = false;
-            std::vector<std::set<int>> newPartition;
-
-            for (const auto &group: partition) {
-                // If group has only one state, keep it as is
-                if (group.size() <= 1) {
-                    newPartition.push_back(group);
-                    continue;
+        // Step 3: Start with one block per accept rule and one for the non-accept states. Blocks are ranges of the
+        // elements array, with the states marked during a round kept at the front of their block.
+        std::vector<int> elements(stateCount), location(stateCount), blockOf(stateCount);
+        std::vector<int> blockStart, blockEnd, markedCount;
+        {
+            std::map<int, std::vector<int>> statesByRule;
+            for (int state = 0; state < stateCount; ++state) {
+                statesByRule[state == sink ? NO_RULE : originalDfa.getAcceptRule(originalStates[state])].push_back(state);
+            }
+            int position = 0;
+            for (const auto& [rule, group] : statesByRule) {
+                blockStart.push_back(position);
+                for (int state : group) {
+                    elements[position] = state;
+                    location[state] = position;
+                    blockOf[state] = static_cast<int>(blockEnd.size());
+                    position++;
                 }
+                blockEnd.push_back(position);
+                markedCount.push_back(0);
+            }
+        }
 
-                // Try to split the current group
-                std::vector<std::set<int>> splitGroups;
-                splitGroups.push_back({*group.begin()});
-
-                for (int state: group) {
-                    bool foundGroup = false;
-                    for (auto &potentialGroup: splitGroups) {
-                        // Check if the current state is equivalent to the first state in this group
-                        if (are_states_equivalent(originalDfa, *potentialGroup.begin(), state, partition)) {
-                            potentialGroup.insert(state);
-                            foundGroup = true;
-                            break;
-                        }
-                    }
+        // Every block but the largest starts out as a splitter for every symbol
+        std::vector<std::pair<int, int>> worklist;
+        int largestBlock = 0;
+        for (int block = 1; block < static_cast<int>(blockStart.size()); ++block) {
+            if (blockEnd[block] - blockStart[block] > blockEnd[largestBlock] - blockStart[largestBlock]) {
+                largestBlock = block;
+            }
+        }
+        for (int block = 0; block < static_cast<int>(blockStart.size()); ++block) {
+            if (block == largestBlock) continue;
+            for (int symbol = 0; symbol < symbolCount; ++symbol) {
+                worklist.emplace_back(block, symbol);
+            }
+        }
 
-                    // If no equivalent group found, create a new group
-                    if (!foundGroup) {
-                        splitGroups.push_back({state});
-                        partitionChanged = true;
+        // Step 4: Refine the partition until no splitter is left
+        std::vector<int> splitter;
+        std::vector<int> touchedBlocks;
+        while (!worklist.empty()) {
+            auto [splitterBlock, symbol] = worklist.back();
+            worklist.pop_back();
+            Stats::add(&Stats::Construction::refinementIterations);
+
+            // Marking below reorders elements inside blocks, so take a copy of the splitter first
+            splitter.assign(elements.begin() + blockStart[splitterBlock], elements.begin() + blockEnd[splitterBlock]);
+
+            for (int target : splitter) {
+                size_t inverseIndex = static_cast<size_t>(symbol) * stateCount + target;
+                for (int i = inverseStart[inverseIndex]; i < inverseStart[inverseIndex + 1]; ++i) {
+                    int source = inverseSources[i];
+                    int block = blockOf[source];
+                    int markedPosition = blockStart[block] + markedCount[block];
+                    if (location[source] < markedPosition) continue; // Already marked
+
+                    if (markedCount[block] == 0) {
+                        touchedBlocks.push_back(block);
                     }
+                    int displaced = elements[markedPosition];
+                    std::swap(elements[location[source]], elements[markedPosition]);
+                    location[displaced] = location[source];
+                    location[source] = markedPosition;
+                    markedCount[block]++;
                 }
-
-                // Add split groups to new partition
-                newPartition.insert(
-                        newPartition.end(),
-                        splitGroups.begin(),
-                        splitGroups.end()
-                );
             }
 
-            // Update partition
-            partition = newPartition;
-        } while (partitionChanged);
-
-        // Step 3: Create the minimized DFA
-        DFA minimizedDfa;
-        std::map<int, int> stateMapping;
-
-        // Assign new state numbers and map original states to minimized states
-        int newStateIndex = 0;
-        for (const auto &group: partition) {
-            // Find a representative state for the group
-            int representativeState = *group.begin();
+            for (int block : touchedBlocks) {
+                int marked = markedCount[block];
+                int size = blockEnd[block] - blockStart[block];
+                markedCount[block] = 0;
+                if (marked == size) continue;
+
+                // The smaller half becomes the new block, so each state changes block O(log n) times
+                int newBlock = static_cast<int>(blockStart.size());
+                int splitPosition = blockStart[block] + marked;
+                if (marked <= size - marked) {
+                    blockStart.push_back(blockStart[block]);
+                    blockEnd.push_back(splitPosition);
+                    blockStart[block] = splitPosition;
+                } else {
+                    blockStart.push_back(splitPosition);
+                    blockEnd.push_back(blockEnd[block]);
+                    blockEnd[block] = splitPosition;
+                }
+                markedCount.push_back(0);
+                for (int i = blockStart[newBlock]; i < blockEnd[newBlock]; ++i) {
+                    blockOf[elements[i]] = newBlock;
+                }
 
-            // Map all states in the group to the new state index
-            for (int state: group) {
-                stateMapping[state] = newStateIndex;
+                // Whether or not the old block is still pending, adding the smaller half for every symbol suffices
+                for (int splitSymbol = 0; splitSymbol < symbolCount; ++splitSymbol) {
+                    worklist.emplace_back(newBlock, splitSymbol);
+                }
             }
+            touchedBlocks.clear();
+        }
 
-            // Add the new state to the minimized DFA
-            minimizedDfa.addState(newStateIndex,
-                                  originalDfa.getAcceptState().find(representativeState) != originalDfa.getAcceptState().end()
-            );
+        // Step 5: Create the minimized DFA, leaving out the block that contains the sink. Blocks made up of
+        // unreachable states only are left out too; any other block only leads to blocks with reachable states.
+        DFA minimizedDfa;
+        for (char symbol : originalDfa.getAlphabet()) {
+            minimizedDfa.addSymbol(symbol);
+        }
 
-            // Set start state if the group contains the original start state
-            if (group.find(originalDfa.getStartState()) != group.end()) {
-                minimizedDfa.setStartState(newStateIndex);
+        const int blockCount = static_cast<int>(blockStart.size());
+        const int sinkBlock = blockOf[sink];
+        std::vector<int> blockToState(blockCount, -1);
+        std::vector<int> representatives(blockCount, -1);
+        for (int state = 0; state < sink; ++state) {
+            if (reachable[state] && blockOf[state] != sinkBlock) {
+                representatives[blockOf[state]] = state;
             }
+        }
 
+        int newStateIndex = 0;
+        for (int block = 0; block < blockCount; ++block) {
+            if (representatives[block] < 0) continue;
+            blockToState[block] = newStateIndex;
+            int representativeState = originalStates[representatives[block]];
+            if (originalDfa.getAcceptRules().find(representativeState) != originalDfa.getAcceptRules().end()) {
+                minimizedDfa.setAcceptRule(newStateIndex, originalDfa.getAcceptRule(representativeState));
+            } else {
+                minimizedDfa.addState(newStateIndex,
+                                      originalDfa.getAcceptState().find(representativeState) != originalDfa.getAcceptState().end()
+                );
+            }
             newStateIndex++;
         }
+        Stats::set(&Stats::Construction::minimizedStates, static_cast<size_t>(newStateIndex));
 
-        // Step 4: Add transitions to the minimized DFA
-        for (const auto &group: partition) {
-            int fromState = stateMapping[*group.begin()];
-
-            // Use the first state in the group to check transitions
-            int representativeState = *group.begin();
-
-            // Check transitions for each symbol
-            for (char symbol: originalDfa.getAlphabet()) {
-                // Find the transition for the representative state
-                auto transition = transitionTable.find({representativeState, symbol});
-                if (transition != originalDfa.getTransitionTable().end()) {
-                    // Map the destination state to its new minimized state
-                    int originalDestState = transition->second;
-                    int destState = stateMapping[originalDestState];
-
-                    // Add the transition to the minimized DFA
-                    minimizedDfa.addTransition(fromState, symbol, destState);
-                }
+        if (blockOf[start] == sinkBlock) {
+            // The DFA accepts nothing, keep a lone start state
+            minimizedDfa.setStartState(0);
+            return minimizedDfa;
+        }
+        minimizedDfa.setStartState(blockToState[blockOf[start]]);
+
+        // Step 6: Add transitions using one representative per block
+        for (int block = 0; block < blockCount; ++block) {
+            if (representatives[block] < 0) continue;
+            for (int symbol = CHAR_MIN; symbol <= CHAR_MAX; ++symbol) {
+                int symbolClass = byteClasses.classOf(static_cast<unsigned char>(symbol));
+                int destBlock = blockOf[delta[static_cast<size_t>(representatives[block]) * symbolCount + symbolClass]];
+                if (destBlock == sinkBlock) continue;
+                minimizedDfa.addTransition(blockToState[block], static_cast<char>(symbol), blockToState[destBlock]);
             }
         }
 
         return minimizedDfa;
     }
 
-    private:
-    // Check if two states are equivalent in the current partition
-    static bool are_states_equivalent(const DFA& dfa, int state1, int state2,
-                                      const std::vector<std::set<int>>& partition) {
-        const auto& transitionTable = dfa.getTransitionTable();
-
-        // States must be in the same accept/non-accept group
-        bool state1Accept = dfa.getAcceptState().find(state1) != dfa.getAcceptState().end();
-        bool state2Accept = dfa.getAcceptState().find(state2) != dfa.getAcceptState().end();
-        if (state1Accept != state2Accept) return false;
-
-        // Check transitions for each symbol
-        for (char symbol : dfa.getAlphabet()) {
-            // Find where each state transitions for this symbol
-            auto transition1 = transitionTable.find({state1, symbol});
-            auto transition2 = transitionTable.find({state2, symbol});
-
-            // If transitions are different
-            if (transition1 == transitionTable.end() ||
-                transition2 == transitionTable.end()) {
-                // If both lack a transition, they're equivalent
-                if (transition1 == transitionTable.end() &&
-                    transition2 == transitionTable.end())
-                    continue;
-                return false;
-            }
+    // The NFA for the reversed language. Every edge is turned around, a new start state has epsilon edges to the old
+    // accept states, and the old start state is the only accept state.
+    static NFA reverse_nfa(const NFA& nfa) {
+        NFA reversed;
+        if (nfa.getStates().empty()) {
+            return reversed;
+        }
 
-            // Find the groups of the destination states
-            int dest1 = transition1->second;
-            int dest2 = transition2->second;
+        for (int state : nfa.getStates()) {
+            reversed.addState(state);
+        }
+        for (const auto& [key, targets] : nfa.getTransitionTable()) {
+            for (int target : targets) {
+                reversed.addTransition(target, key.second, key.first);
+            }
+        }
+        for (const auto& [state, ranges] : nfa.getRangeTransitions()) {
+            for (const auto& range : ranges) {
+                reversed.addRangeTransition(range.toState, range.low, range.high, state);
+            }
+        }
 
-            // Check if destination states are in the same partition group
-            bool dest1InSameGroup = false;
-            bool dest2InSameGroup = false;
+        int start = *nfa.getStates().rbegin() + 1;
+        reversed.setStartState(start);
+        for (int state : nfa.getAcceptState()) {
+            reversed.addTransition(start, EPSILON, state);
+        }
+        reversed.addState(nfa.getStartState(), true);
+        return reversed;
+    }
 
-            for (const auto& group : partition) {
-                bool dest1Found = group.find(dest1) != group.end();
-                bool dest2Found = group.find(dest2) != group.end();
+    // The NFA for .* followed by the language of nfa, which accepts every input that ends in a match. The new start
+    // state loops on every byte but EPSILON, so a NUL byte in the input never continues the loop.
+    static NFA unanchored_nfa(const NFA& nfa) {
+        NFA unanchored;
+        if (nfa.getStates().empty()) {
+            return unanchored;
+        }
 
-                // If destinations are in different groups, states are not equivalent
-                if (dest1Found != dest2Found) {
-                    return false;
-                }
+        for (int state : nfa.getStates()) {
+            unanchored.addState(state);
+        }
+        for (const auto& [key, targets] : nfa.getTransitionTable()) {
+            for (int target : targets) {
+                unanchored.addTransition(key.first, key.second, target);
             }
         }
-        return true;
+        for (const auto& [state, ranges] : nfa.getRangeTransitions()) {
+            for (const auto& range : ranges) {
+                unanchored.addRangeTransition(state, range.low, range.high, range.toState);
+            }
+        }
+        for (int state : nfa.getAcceptState()) {
+            unanchored.addState(state, true);
+        }
+
+        int start = *nfa.getStates().rbegin() + 1;
+        unanchored.setStartState(start);
+        unanchored.addRangeTransition(start, 1, 255, start);
+        unanchored.addTransition(start, EPSILON, nfa.getStartState());
+        return unanchored;
     }
+
+private:
+    // A node of the map DFA keeps its transitions in: the key, the target and the tree links
+    static constexpr size_t DFA_TRANSITION_BYTES = sizeof(std::pair<int, char>) + sizeof(int) + 4 * sizeof(void*);
 };
 
 
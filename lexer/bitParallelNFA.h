@@ -0,0 +1,170 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_BITPARALLELNFA_H
+#define SYPHON_BITPARALLELNFA_H
+
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+#include "automata.h"
+#include "frozenNFA.h"
+
+// Simulates a small NFA with one machine word as its state set. Every byte edge of the NFA becomes a position of the
+// Glushkov automaton, which is entered on the bytes of its edge only and is active once its edge has been taken. A
+// step is then
+//
+//     active' = follow(active) & positionsOn[byte]
+//
+// where follow(active) is the union of the positions reachable from the active ones. Shift-And covers the case where
+// every position follows the one before it. For the general case follow is looked up in one table of 256 words per
+// eight positions, after Navarro and Raffinot, so a step takes a few lookups for up to MAX_POSITIONS positions.
+class BitParallelNFA {
+public:
+    static constexpr size_t NO_MATCH = std::string_view::npos;
+    static constexpr size_t MAX_POSITIONS = 64;
+
+    BitParallelNFA() = default;
+
+    explicit BitParallelNFA(const FrozenNFA& nfa) {
+        if (!fits(nfa)) {
+            throw std::runtime_error("Invalid bit-parallel NFA: more than 64 positions");
+        }
+        if (nfa.empty()) {
+            return;
+        }
+
+        std::vector<uint32_t> positionTargets;
+        std::vector<int> positionOfEdgeStart(nfa.getStateCount() + 1);
+        for (int state = 0; state < nfa.getStateCount(); ++state) {
+            positionOfEdgeStart[state] = static_cast<int>(positionTargets.size());
+            for (const auto& edge : nfa.getEdges(state)) {
+                uint64_t bit = uint64_t{1} << positionTargets.size();
+                for (int byte = edge.low; byte <= edge.high; ++byte) {
+                    positionsOn[byte] |= bit;
+                }
+                positionTargets.push_back(edge.target);
+            }
+        }
+        positionOfEdgeStart[nfa.getStateCount()] = static_cast<int>(positionTargets.size());
+        positionCount = positionTargets.size();
+
+        // The positions that can be entered from a state, and whether it accepts, through its epsilon closure
+        std::vector<int> seen(nfa.getStateCount(), -1);
+        std::vector<int> stack;
+        int search = 0;
+        auto closure = [&](int from, uint64_t& entered, bool& accept) {
+            entered = 0;
+            accept = false;
+            search++;
+            seen[from] = search;
+            stack.push_back(from);
+            while (!stack.empty()) {
+                int state = stack.back();
+                stack.pop_back();
+                accept |= nfa.isAccept(state);
+                for (int position = positionOfEdgeStart[state]; position < positionOfEdgeStart[state + 1]; ++position) {
+                    entered |= uint64_t{1} << position;
+                }
+                for (uint32_t target : nfa.getEpsilonTargets(state)) {
+                    if (seen[target] != search) {
+                        seen[target] = search;
+                        stack.push_back(static_cast<int>(target));
+                    }
+                }
+            }
+        };
+
+        closure(nfa.getStartState(), initial, startAccepts);
+        std::vector<uint64_t> follow(positionCount);
+        for (size_t position = 0; position < positionCount; ++position) {
+            bool accept;
+            closure(static_cast<int>(positionTargets[position]), follow[position], accept);
+            if (accept) {
+                finalPositions |= uint64_t{1} << position;
+            }
+        }
+
+        // Each table entry is the follow set of one byte of the state word, built from the entry without its
+        // lowest bit
+        size_t chunkCount = (positionCount + 7) / 8;
+        followTables.assign(chunkCount * 256, 0);
+        for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+            uint64_t* table = followTables.data() + chunk * 256;
+            for (unsigned bits = 1; bits < 256; ++bits) {
+                size_t position = chunk * 8 + static_cast<size_t>(std::countr_zero(bits));
+                table[bits] = table[bits & (bits - 1)] | (position < positionCount ? follow[position] : 0);
+            }
+        }
+        valid = true;
+    }
+
+    explicit BitParallelNFA(const NFA& nfa) : BitParallelNFA(FrozenNFA(nfa)) {}
+
+    // True if every byte edge of the NFA fits a bit of the state word
+    static bool fits(const FrozenNFA& nfa) {
+        return nfa.getEdgeCount() <= MAX_POSITIONS;
+    }
+
+    // Returns true if the whole input is accepted
+    [[nodiscard]] bool match(std::string_view input) const {
+        return scan(input, false) == input.size();
+    }
+
+    // Returns the length of the longest accepted prefix of the input, or NO_MATCH if no prefix is accepted
+    [[nodiscard]] size_t longestPrefix(std::string_view input) const {
+        return scan(input, true);
+    }
+
+    [[nodiscard]] size_t getPositionCount() const {
+        return positionCount;
+    }
+
+private:
+    bool valid = false;
+    size_t positionCount = 0;
+    bool startAccepts = false;
+    uint64_t initial = 0;
+    uint64_t finalPositions = 0;
+    std::array<uint64_t, 256> positionsOn{};
+    std::vector<uint64_t> followTables;  // 256 follow sets per eight positions
+
+    [[nodiscard]] uint64_t followOf(uint64_t active) const {
+        uint64_t result = 0;
+        const uint64_t* table = followTables.data();
+        for (; active != 0; active >>= 8, table += 256) {
+            result |= table[active & 0xFF];
+        }
+        return result;
+    }
+
+    [[nodiscard]] size_t scan(std::string_view input, bool prefix) const {
+        if (!valid) {
+            return NO_MATCH;
+        }
+
+        size_t lastAccept = startAccepts ? 0 : NO_MATCH;
+        uint64_t active = initial;
+        for (size_t i = 0; i < input.size(); ++i) {
+            active &= positionsOn[static_cast<unsigned char>(input[i])];
+            if (active == 0) break;
+            if (active & finalPositions) {
+                lastAccept = i + 1;
+            }
+            active = followOf(active);
+        }
+
+        if (!prefix) {
+            return lastAccept == input.size() ? lastAccept : NO_MATCH;
+        }
+        return lastAccept;
+    }
+};
+
+
+#endif //SYPHON_BITPARALLELNFA_H
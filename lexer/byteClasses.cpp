@@ -0,0 +1,5 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#include "byteClasses.h"
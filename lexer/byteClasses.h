@@ -0,0 +1,169 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_BYTECLASSES_H
+#define SYPHON_BYTECLASSES_H
+
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "automata.h"
+#include "frozenNFA.h"
+
+// A partition of all 256 byte values into classes of bytes that no transition tells apart. Automata built over the
+// classes step on classOf(byte) instead of the byte, which shrinks tables and the work done per symbol.
+class ByteClasses {
+public:
+    ByteClasses() {
+        classes.fill(0);
+        classSizes.fill(0);
+        classSizes[0] = 256;
+    }
+
+    // Classes of bytes that lead every NFA state to the same set of states. Splitting by the bytes that lead to each
+    // target on its own is enough: two bytes that no target tells apart lead to the same set of targets.
+    static ByteClasses fromNFA(const FrozenNFA& nfa) {
+        ByteClasses byteClasses;
+        std::array<bool, 256> covered{};
+        std::vector<unsigned char> bytes;
+        for (int state = 0; state < nfa.getStateCount(); ++state) {
+            auto edges = nfa.getEdges(state);
+            // Edges are sorted by target, so the edges to one target form a run
+            for (size_t runStart = 0; runStart < edges.size();) {
+                size_t runEnd = runStart;
+                bytes.clear();
+                for (; runEnd < edges.size() && edges[runEnd].target == edges[runStart].target; ++runEnd) {
+                    for (int byte = edges[runEnd].low; byte <= edges[runEnd].high; ++byte) {
+                        if (!covered[byte]) {
+                            covered[byte] = true;
+                            bytes.push_back(static_cast<unsigned char>(byte));
+                        }
+                    }
+                }
+                byteClasses.split(bytes);
+                for (unsigned char byte : bytes) {
+                    covered[byte] = false;
+                }
+                runStart = runEnd;
+            }
+        }
+        return byteClasses;
+    }
+
+    static ByteClasses fromNFA(const NFA& nfa) {
+        return fromNFA(FrozenNFA(nfa));
+    }
+
+    // Classes of bytes that lead every DFA state to the same state
+    static ByteClasses fromDFA(const DFA& dfa) {
+        ByteClasses byteClasses;
+        std::vector<std::pair<int, unsigned char>> edges;
+        const auto& transitionTable = dfa.getTransitionTable();
+
+        auto it = transitionTable.begin();
+        while (it != transitionTable.end()) {
+            int state = it->first.first;
+            edges.clear();
+            for (; it != transitionTable.end() && it->first.first == state; ++it) {
+                edges.emplace_back(it->second, static_cast<unsigned char>(it->first.second));
+            }
+            std::sort(edges.begin(), edges.end());
+            byteClasses.splitGroups(edges, [](const auto& a, const auto& b) { return a.first == b.first; });
+        }
+        return byteClasses;
+    }
+
+    // Rebuilds the classes from a table as returned by getTable()
+    static ByteClasses fromTable(const uint8_t* table) {
+        ByteClasses byteClasses;
+        byteClasses.classSizes.fill(0);
+        byteClasses.classCount = 0;
+        for (int byte = 0; byte < 256; ++byte) {
+            byteClasses.classes[byte] = table[byte];
+            byteClasses.classSizes[table[byte]]++;
+            byteClasses.classCount = std::max(byteClasses.classCount, table[byte] + 1);
+        }
+        return byteClasses;
+    }
+
+    // Splits every class the given bytes only partly cover into the covered and the uncovered part
+    void split(const std::vector<unsigned char>& bytes) {
+        std::array<uint16_t, 256> counts{};
+        std::array<int, 256> newClass{};
+        std::array<uint8_t, 256> touched{};
+        int touchedCount = 0;
+
+        for (unsigned char byte : bytes) {
+            if (counts[classes[byte]]++ == 0) {
+                touched[touchedCount++] = classes[byte];
+            }
+        }
+        for (int i = 0; i < touchedCount; ++i) {
+            int byteClass = touched[i];
+            newClass[byteClass] = counts[byteClass] < classSizes[byteClass] ? classCount++ : -1;
+        }
+        for (unsigned char byte : bytes) {
+            int oldClass = classes[byte];
+            if (newClass[oldClass] >= 0) {
+                classes[byte] = static_cast<uint8_t>(newClass[oldClass]);
+                classSizes[oldClass]--;
+                classSizes[newClass[oldClass]]++;
+            }
+        }
+    }
+
+    [[nodiscard]] int classOf(unsigned char byte) const {
+        return classes[byte];
+    }
+
+    [[nodiscard]] int getClassCount() const {
+        return classCount;
+    }
+
+    // The lowest byte in a class
+    [[nodiscard]] unsigned char representative(int byteClass) const {
+        for (int byte = 0; byte < 256; ++byte) {
+            if (classes[byte] == byteClass) return static_cast<unsigned char>(byte);
+        }
+        return 0;
+    }
+
+    [[nodiscard]] std::vector<unsigned char> members(int byteClass) const {
+        std::vector<unsigned char> bytes;
+        for (int byte = 0; byte < 256; ++byte) {
+            if (classes[byte] == byteClass) bytes.push_back(static_cast<unsigned char>(byte));
+        }
+        return bytes;
+    }
+
+    [[nodiscard]] const std::array<uint8_t, 256>& getTable() const {
+        return classes;
+    }
+
+private:
+    std::array<uint8_t, 256> classes{};
+    std::array<uint16_t, 256> classSizes{};
+    int classCount = 1;
+
+    // Splits by every run of edges that sameGroup considers equal, edges being (target, byte) pairs
+    template<typename Edge, typename Same>
+    void splitGroups(const std::vector<Edge>& edges, Same sameGroup) {
+        std::vector<unsigned char> group;
+        for (size_t groupStart = 0; groupStart < edges.size();) {
+            size_t groupEnd = groupStart;
+            group.clear();
+            while (groupEnd < edges.size() && sameGroup(edges[groupEnd], edges[groupStart])) {
+                group.push_back(edges[groupEnd].second);
+                groupEnd++;
+            }
+            split(group);
+            groupStart = groupEnd;
+        }
+    }
+};
+
+
+#endif //SYPHON_BYTECLASSES_H
@@ -0,0 +1,376 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_CODEGENERATOR_H
+#define SYPHON_CODEGENERATOR_H
+
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "compiledDFA.h"
+#include "keywordTable.h"
+
+// C++ source for a scanner generated from a compiled DFA, as a header and a source file that includes it
+struct GeneratedLexer {
+    std::string header;
+    std::string source;
+};
+
+// Emits a standalone C++ scanner for a compiled DFA, so a lexer can be compiled into a program with no automaton
+// built at runtime. The generated code only depends on the standard library. It declares, in its own namespace:
+//
+//     size_t longestPrefix(std::string_view input, int& tokenId);
+//     bool match(std::string_view input);
+//     template<typename F> void forEachToken(std::string_view input, F&& onToken);
+//
+// with the same semantics as the CompiledDFA and Lexer functions of the same names.
+//
+// The direct-coded style turns every state into a label and a switch over the next byte, in the manner of re2c. The
+// table-driven style emits the class map and transition table as constant arrays along with the matching loop.
+//
+// Given the keyword table of a Lexer, either style also emits the table's words, seeds and token ids, and
+// longestPrefix looks up every token the DFA matches, as Lexer does for the rules the keywords were taken from.
+class CodeGenerator {
+public:
+    enum class Style { DirectCoded, TableDriven };
+
+    struct Options {
+        // Namespace of the generated scanner
+        std::string name = "lexer";
+        Style style = Style::DirectCoded;
+        // How the source includes the header, name + ".h" if empty
+        std::string headerName;
+        // If given, an enum with one named constant per token id
+        std::vector<std::string> tokenNames;
+        // The values of the named constants, if not the token ids given to generate, as when keywords were taken out
+        std::vector<int> tokenNameIds;
+        // If given and not empty, the keywords kept out of the DFA, see Lexer
+        const KeywordTable* keywords = nullptr;
+    };
+
+    // tokenIds holds the token id of every rule the DFA accepts for. Without them, the rule number is the token id.
+    static GeneratedLexer generate(const CompiledDFA& dfa, const std::vector<int>& tokenIds, const Options& options) {
+        checkIdentifier(options.name);
+        for (const auto& tokenName : options.tokenNames) {
+            checkIdentifier(tokenName);
+        }
+        const std::vector<int>& nameIds = options.tokenNameIds.empty() ? tokenIds : options.tokenNameIds;
+        if (!options.tokenNames.empty() && options.tokenNames.size() != nameIds.size()) {
+            throw std::runtime_error("Cannot generate lexer: expected one token name per token id");
+        }
+
+        GeneratedLexer generated;
+        generated.header = generateHeader(nameIds, options);
+        std::ostringstream source;
+        source << "// Generated by Syphon. Do not edit.\n\n"
+               << "#include \"" << (options.headerName.empty() ? options.name + ".h" : options.headerName) << "\"\n\n"
+               << "#include <cstdint>\n"
+               << "#include <cstring>\n\n"
+               << "namespace " << options.name << " {\n\n";
+        const bool keywords = options.keywords && !options.keywords->empty();
+        const char* signature = keywords ? "static size_t dfaLongestPrefix(std::string_view input, int& tokenId)"
+                                         : "size_t longestPrefix(std::string_view input, int& tokenId)";
+        if (options.style == Style::DirectCoded) {
+            generateDirectCoded(source, dfa, tokenIds, signature);
+        } else {
+            generateTableDriven(source, dfa, tokenIds, signature);
+        }
+        if (keywords) {
+            generateKeywordTable(source, *options.keywords);
+        }
+        source << "}  // namespace " << options.name << "\n";
+        generated.source = source.str();
+        return generated;
+    }
+
+private:
+    static void checkIdentifier(const std::string& name) {
+        bool valid = !name.empty() && !std::isdigit(static_cast<unsigned char>(name[0])) &&
+                     std::all_of(name.begin(), name.end(), [](char c) {
+                         return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+                     });
+        if (!valid) throw std::runtime_error("Cannot generate lexer: '" + name + "' is not a C++ identifier");
+    }
+
+    static int tokenIdOf(const CompiledDFA& dfa, uint32_t state, const std::vector<int>& tokenIds) {
+        int rule = dfa.getAcceptRule(state);
+        if (rule == NO_RULE) rule = 0;
+        return static_cast<size_t>(rule) < tokenIds.size() ? tokenIds[rule] : rule;
+    }
+
+    static std::string generateHeader(const std::vector<int>& tokenIds, const Options& options) {
+        std::string guard = "SYPHON_GENERATED_" + options.name + "_H";
+        std::transform(guard.begin(), guard.end(), guard.begin(), [](char c) {
+            return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        });
+
+        std::ostringstream header;
+        header << "// Generated by Syphon. Do not edit.\n\n"
+               << "#ifndef " << guard << "\n"
+               << "#define " << guard << "\n\n"
+               << "#include <cstddef>\n"
+               << "#include <string_view>\n\n"
+               << "namespace " << options.name << " {\n\n";
+        if (!options.tokenNames.empty()) {
+            header << "enum TokenId : int {\n";
+            for (size_t i = 0; i < options.tokenNames.size(); ++i) {
+                header << "    " << options.tokenNames[i] << " = " << tokenIds[i] << ",\n";
+            }
+            header << "};\n\n";
+        }
+        header << "constexpr int INVALID_TOKEN = -1;\n"
+               << "constexpr size_t NO_MATCH = std::string_view::npos;\n\n"
+               << "struct Token {\n"
+               << "    int tokenId;\n"
+               << "    size_t offset;\n"
+               << "    size_t length;\n"
+               << "};\n\n"
+               << "// Returns the length of the longest accepted prefix of the input and its token id, or NO_MATCH\n"
+               << "size_t longestPrefix(std::string_view input, int& tokenId);\n\n"
+               << "// Returns true if the whole input is accepted\n"
+               << "inline bool match(std::string_view input) {\n"
+               << "    int tokenId;\n"
+               << "    return longestPrefix(input, tokenId) == input.size();\n"
+               << "}\n\n"
+               << "// Calls onToken for every token by maximal munch. Unmatched bytes come out one at a time as INVALID_TOKEN.\n"
+               << "template<typename F>\n"
+               << "void forEachToken(std::string_view input, F&& onToken) {\n"
+               << "    size_t offset = 0;\n"
+               << "    while (offset < input.size()) {\n"
+               << "        int tokenId;\n"
+               << "        size_t length = longestPrefix(input.substr(offset), tokenId);\n"
+               << "        if (length == NO_MATCH) {\n"
+               << "            onToken(Token{INVALID_TOKEN, offset, 1});\n"
+               << "            offset++;\n"
+               << "            continue;\n"
+               << "        }\n"
+               << "        onToken(Token{tokenId, offset, length});\n"
+               << "        offset += length;\n"
+               << "    }\n"
+               << "}\n\n"
+               << "}  // namespace " << options.name << "\n\n"
+               << "#endif  // " << guard << "\n";
+        return header.str();
+    }
+
+    static std::string byteLiteral(int byte) {
+        if (std::isalnum(byte) || (std::ispunct(byte) && byte != '\'' && byte != '\\')) {
+            return std::string("'") + static_cast<char>(byte) + "'";
+        }
+        return std::to_string(byte);
+    }
+
+    // Every state is a label. Entering a state records an accept, then the next byte picks the state to jump to,
+    // and every byte that leads to the dead state ends the scan.
+    static void generateDirectCoded(std::ostringstream& out, const CompiledDFA& dfa, const std::vector<int>& tokenIds,
+                                    const char* signature) {
+        // Only states reachable from the start get a label, in breadth-first order
+        std::vector<uint32_t> order;
+        std::vector<bool> reached(dfa.getStateCount(), false);
+        if (dfa.getStartState() != CompiledDFA::DEAD_STATE) {
+            order.push_back(dfa.getStartState());
+            reached[dfa.getStartState()] = true;
+        }
+        for (size_t i = 0; i < order.size(); ++i) {
+            for (int byte = 0; byte < 256; ++byte) {
+                uint32_t target = dfa.getTransition(order[i], static_cast<unsigned char>(byte));
+                if (target != CompiledDFA::DEAD_STATE && !reached[target]) {
+                    reached[target] = true;
+                    order.push_back(target);
+                }
+            }
+        }
+
+        out << signature << " {\n"
+            << "    [[maybe_unused]] const unsigned char* const begin = reinterpret_cast<const unsigned char*>(input.data());\n"
+            << "    [[maybe_unused]] const unsigned char* const end = begin + input.size();\n"
+            << "    [[maybe_unused]] const unsigned char* p = begin;\n"
+            << "    size_t longest = NO_MATCH;\n"
+            << "    tokenId = INVALID_TOKEN;\n";
+        if (order.empty()) {
+            out << "    return longest;\n"
+                << "}\n\n";
+            return;
+        }
+        out << "    goto state" << order[0] << ";\n";
+
+        std::vector<std::pair<uint32_t, int>> edges;
+        for (uint32_t state : order) {
+            out << "\nstate" << state << ":\n";
+            if (dfa.isAccept(state)) {
+                out << "    longest = static_cast<size_t>(p - begin);\n"
+                    << "    tokenId = " << tokenIdOf(dfa, state, tokenIds) << ";\n";
+            }
+
+            edges.clear();
+            for (int byte = 0; byte < 256; ++byte) {
+                uint32_t target = dfa.getTransition(state, static_cast<unsigned char>(byte));
+                if (target != CompiledDFA::DEAD_STATE) edges.emplace_back(target, byte);
+            }
+            if (edges.empty()) {
+                out << "    return longest;\n";
+                continue;
+            }
+
+            // One case list per target, so every target has a single goto
+            std::sort(edges.begin(), edges.end());
+            out << "    if (p == end) return longest;\n"
+                << "    switch (*p++) {\n";
+            for (size_t i = 0; i < edges.size();) {
+                uint32_t target = edges[i].first;
+                out << "        ";
+                for (int column = 0; i < edges.size() && edges[i].first == target; ++i, ++column) {
+                    out << "case " << byteLiteral(edges[i].second) << ":" << (column % 8 == 7 ? "\n        " : " ");
+                }
+                out << "goto state" << target << ";\n";
+            }
+            out << "        default: return longest;\n"
+                << "    }\n";
+        }
+        out << "}\n\n";
+    }
+
+    // The class map, transitions and accept table as constant arrays, stepped through by a loop like CompiledDFA's
+    static void generateTableDriven(std::ostringstream& out, const CompiledDFA& dfa, const std::vector<int>& tokenIds,
+                                    const char* signature) {
+        const size_t stateCount = dfa.getStateCount();
+        const size_t columnCount = dfa.getColumnCount();
+        const char* stateType = stateCount <= 0x100 ? "uint8_t" : stateCount <= 0x10000 ? "uint16_t" : "uint32_t";
+
+        auto writeArray = [&out](size_t count, auto valueAt) {
+            for (size_t i = 0; i < count; ++i) {
+                out << (i % 16 == 0 ? "\n    " : " ") << valueAt(i) << ",";
+            }
+            out << "\n};\n\n";
+        };
+
+        out << "namespace {\n\n"
+            << "constexpr size_t COLUMN_COUNT = " << columnCount << ";\n\n"
+            << "const uint8_t classes[256] = {";
+        writeArray(256, [&dfa](size_t byte) { return dfa.getByteClasses().classOf(static_cast<unsigned char>(byte)); });
+
+        // Row 0 is the dead state
+        out << "const " << stateType << " transitions[" << stateCount * columnCount << "] = {";
+        std::vector<uint32_t> targets(columnCount, CompiledDFA::DEAD_STATE);
+        std::vector<uint32_t> table;
+        table.reserve(stateCount * columnCount);
+        for (uint32_t state = 0; state < stateCount; ++state) {
+            for (int byte = 0; byte < 256; ++byte) {
+                targets[dfa.getByteClasses().classOf(static_cast<unsigned char>(byte))] =
+                        dfa.getTransition(state, static_cast<unsigned char>(byte));
+            }
+            table.insert(table.end(), targets.begin(), targets.end());
+        }
+        writeArray(table.size(), [&table](size_t i) { return table[i]; });
+
+        out << "// Whether every state accepts, and the token id it accepts for\n"
+            << "const bool accepting[" << stateCount << "] = {";
+        writeArray(stateCount, [&dfa](size_t state) { return dfa.isAccept(state) ? "true" : "false"; });
+        out << "const int tokenIds[" << stateCount << "] = {";
+        writeArray(stateCount, [&](size_t state) {
+            return dfa.isAccept(state) ? tokenIdOf(dfa, state, tokenIds) : -1;
+        });
+        out << "}  // namespace\n\n";
+
+        out << signature << " {\n"
+            << "    uint32_t state = " << dfa.getStartState() << ";\n"
+            << "    size_t longest = accepting[state] ? 0 : NO_MATCH;\n"
+            << "    tokenId = accepting[state] ? tokenIds[state] : INVALID_TOKEN;\n"
+            << "    for (size_t i = 0; i < input.size(); ++i) {\n"
+            << "        state = transitions[state * COLUMN_COUNT + classes[static_cast<unsigned char>(input[i])]];\n"
+            << "        if (state == 0) {\n"
+            << "            break;\n"
+            << "        }\n"
+            << "        if (accepting[state]) {\n"
+            << "            longest = i + 1;\n"
+            << "            tokenId = tokenIds[state];\n"
+            << "        }\n"
+            << "    }\n"
+            << "    return longest;\n"
+            << "}\n\n";
+    }
+
+    // The words as one string literal, every byte that is not a letter, digit or underscore in octal
+    static std::string stringLiteral(std::string_view text) {
+        std::string literal = "\"";
+        for (char c : text) {
+            auto byte = static_cast<unsigned char>(c);
+            if (std::isalnum(byte) || byte == '_') {
+                literal += c;
+            } else {
+                literal += '\\';
+                literal += static_cast<char>('0' + (byte >> 6));
+                literal += static_cast<char>('0' + ((byte >> 3) & 7));
+                literal += static_cast<char>('0' + (byte & 7));
+            }
+        }
+        return literal + "\"";
+    }
+
+    // The keyword table as constant arrays and its lookup, which hashes and places words as KeywordTable does. Any
+    // token can be looked up: a keyword's word only ever reaches the rule it was taken out for.
+    static void generateKeywordTable(std::ostringstream& out, const KeywordTable& keywords) {
+        auto writeArray = [&out](size_t count, auto valueAt) {
+            for (size_t i = 0; i < count; ++i) {
+                out << (i % 16 == 0 ? "\n    " : " ") << valueAt(i) << ",";
+            }
+            out << "\n};\n\n";
+        };
+
+        std::string text;
+        std::vector<uint32_t> offsets = {0};
+        for (size_t slot = 0; slot < keywords.size(); ++slot) {
+            text += keywords.getWord(slot);
+            offsets.push_back(static_cast<uint32_t>(text.size()));
+        }
+        const auto& seeds = keywords.getSeeds();
+
+        out << "namespace {\n\n"
+            << "constexpr size_t KEYWORD_COUNT = " << keywords.size() << ";\n"
+            << "constexpr size_t KEYWORD_MIN_LENGTH = " << keywords.getMinLength() << ";\n"
+            << "constexpr size_t KEYWORD_MAX_LENGTH = " << keywords.getMaxLength() << ";\n\n"
+            << "const char keywordText[] = " << stringLiteral(text) << ";\n\n"
+            << "const uint32_t keywordOffsets[" << offsets.size() << "] = {";
+        writeArray(offsets.size(), [&offsets](size_t i) { return offsets[i]; });
+        out << "const int keywordTokenIds[" << keywords.size() << "] = {";
+        writeArray(keywords.size(), [&keywords](size_t slot) { return keywords.getTokenId(slot); });
+        out << "const uint32_t keywordSeeds[" << seeds.size() << "] = {";
+        writeArray(seeds.size(), [&seeds](size_t bucket) { return seeds[bucket]; });
+
+        out << "// The slot of a keyword, by a minimal perfect hash: FNV-1a, then the seed of the word's bucket mixed in\n"
+            << "size_t keywordSlot(std::string_view word) {\n"
+            << "    uint64_t hash = 0xcbf29ce484222325u;\n"
+            << "    for (char c : word) {\n"
+            << "        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3u;\n"
+            << "    }\n"
+            << "    uint64_t mixed = hash + (static_cast<uint64_t>(keywordSeeds[hash % " << seeds.size()
+            << "]) + 1) * 0x9e3779b97f4a7c15u;\n"
+            << "    mixed = (mixed ^ (mixed >> 30)) * 0xbf58476d1ce4e5b9u;\n"
+            << "    mixed = (mixed ^ (mixed >> 27)) * 0x94d049bb133111ebu;\n"
+            << "    mixed ^= mixed >> 31;\n"
+            << "    return static_cast<size_t>(mixed % KEYWORD_COUNT);\n"
+            << "}\n\n"
+            << "}  // namespace\n\n";
+
+        out << "size_t longestPrefix(std::string_view input, int& tokenId) {\n"
+            << "    size_t length = dfaLongestPrefix(input, tokenId);\n"
+            << "    if (length == NO_MATCH || length < KEYWORD_MIN_LENGTH || length > KEYWORD_MAX_LENGTH) {\n"
+            << "        return length;\n"
+            << "    }\n"
+            << "    size_t slot = keywordSlot(input.substr(0, length));\n"
+            << "    if (keywordOffsets[slot + 1] - keywordOffsets[slot] == length &&\n"
+            << "        std::memcmp(keywordText + keywordOffsets[slot], input.data(), length) == 0) {\n"
+            << "        tokenId = keywordTokenIds[slot];\n"
+            << "    }\n"
+            << "    return length;\n"
+            << "}\n\n";
+    }
+};
+
+
+#endif //SYPHON_CODEGENERATOR_H
@@ -0,0 +1,466 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_COMPILEDDFA_H
+#define SYPHON_COMPILEDDFA_H
+
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+#include "automata.h"
+#include "byteClasses.h"
+#include "stats.h"
+
+// A frozen, matching-only form of a DFA. Transitions live in one contiguous
+// states x byte classes table, where every input byte is mapped to its class up front.
+// Row 0 is a dead state that loops to itself, so a missing transition never
+// needs a lookup miss check in the matching loop. State ids in the table take
+// 1, 2 or 4 bytes, the fewest that number every state, so small DFAs keep their
+// table in fewer cache lines. DFALayout picks an order of the states to go with it.
+//
+// For DFAs whose dense table is too large, the COMB encoding compresses it by row
+// displacement, as flex does. Every state keeps a default target, the most common
+// one in its row, and only the transitions that differ from it are stored. These
+// are packed into one array of (owner, target) entries, each row at an offset where
+// its entries fall into free slots, so rows interleave like the teeth of combs. A
+// step looks up entry base[state] + class and takes its target if the state owns
+// it, else the default: one more load and compare than the dense table. Entries
+// hold state ids as narrow as the dense table's, and free ones belong to the dead
+// state, whose row has no exceptions and always steps to itself.
+class CompiledDFA {
+public:
+    static constexpr uint32_t DEAD_STATE = 0;
+    static constexpr size_t NO_MATCH = std::string_view::npos;
+
+    enum class Encoding {
+        DENSE,
+        COMB,
+    };
+
+    CompiledDFA() : transitionStorage(1, DEAD_STATE), acceptStorage(1, 0), ruleStorage(1, NO_RULE) {
+        bindStorage();
+    }
+
+    explicit CompiledDFA(const DFA& dfa, Encoding encoding = Encoding::DENSE) : CompiledDFA() {
+        if (dfa.getStates().empty()) {
+            return;
+        }
+
+        // One column per byte class, so bytes the DFA never tells apart share a column
+        byteClasses = ByteClasses::fromDFA(dfa);
+        columnCount = byteClasses.getClassCount();
+
+        // Renumber the DFA states densely, leaving row 0 for the dead state
+        std::map<int, uint32_t> stateIndex;
+        uint32_t nextIndex = 1;
+        for (int state : dfa.getStates()) {
+            stateIndex[state] = nextIndex++;
+        }
+
+        stateCount = nextIndex;
+        std::vector<uint32_t> table(stateCount * columnCount, DEAD_STATE);
+        acceptStorage.assign((stateCount + 63) / 64, 0);
+
+        for (const auto& [key, toState] : dfa.getTransitionTable()) {
+            uint32_t from = stateIndex[key.first];
+            table[from * columnCount + byteClasses.classOf(static_cast<unsigned char>(key.second))] = stateIndex[toState];
+        }
+        storeTransitions(table, encoding);
+
+        ruleStorage.assign(stateCount, NO_RULE);
+        for (int state : dfa.getAcceptState()) {
+            uint32_t index = stateIndex[state];
+            acceptStorage[index / 64] |= uint64_t{1} << (index % 64);
+            ruleStorage[index] = dfa.getAcceptRule(state);
+        }
+
+        startState = stateIndex[dfa.getStartState()];
+        bindStorage();
+    }
+
+    // Copies own their tables, unless the tables live in a mapped file that both copies then share
+    CompiledDFA(const CompiledDFA& other) {
+        *this = other;
+    }
+
+    CompiledDFA& operator=(const CompiledDFA& other) {
+        if (this != &other) {
+            byteClasses = other.byteClasses;
+            columnCount = other.columnCount;
+            stateCount = other.stateCount;
+            stateWidth = other.stateWidth;
+            encoding = other.encoding;
+            startState = other.startState;
+            transitionStorage = other.transitionStorage;
+            combRows = other.combRows;
+            combStorage = other.combStorage;
+            acceptStorage = other.acceptStorage;
+            ruleStorage = other.ruleStorage;
+            backing = other.backing;
+            transitions = other.transitions;
+            acceptBits = other.acceptBits;
+            acceptRules = other.acceptRules;
+            if (!backing) {
+                bindStorage();
+            }
+        }
+        return *this;
+    }
+
+    // Moving a vector keeps its buffer, so the table pointers stay valid
+    CompiledDFA(CompiledDFA&&) noexcept = default;
+    CompiledDFA& operator=(CompiledDFA&&) noexcept = default;
+
+    // Returns true if the whole input is accepted
+    [[nodiscard]] bool match(std::string_view input) const {
+        return withTable([&](const auto& table) { return matchWith(table, input); });
+    }
+
+    // Returns the length of the longest accepted prefix of the input, or NO_MATCH if no prefix is accepted
+    [[nodiscard]] size_t longestPrefix(std::string_view input) const {
+        uint32_t lastAccept;
+        return longestPrefixOf(input, lastAccept);
+    }
+
+    // Like longestPrefix, also reporting the rule of the accept state the longest prefix ends in
+    [[nodiscard]] size_t longestPrefix(std::string_view input, int& rule) const {
+        uint32_t lastAccept;
+        size_t longest = longestPrefixOf(input, lastAccept);
+        rule = acceptRules[lastAccept];
+        return longest;
+    }
+
+    [[nodiscard]] bool isAccept(uint32_t state) const {
+        return (acceptBits[state / 64] >> (state % 64)) & 1;
+    }
+
+    // The rule an accept state belongs to, or NO_RULE
+    [[nodiscard]] int getAcceptRule(uint32_t state) const {
+        return acceptRules[state];
+    }
+
+    [[nodiscard]] uint32_t getStartState() const {
+        return startState;
+    }
+
+    // Number of rows in the table, including the dead state
+    [[nodiscard]] size_t getStateCount() const {
+        return stateCount;
+    }
+
+    // True if the tables are read straight from a mapped file rather than owned
+    [[nodiscard]] bool isMapped() const {
+        return backing != nullptr;
+    }
+
+    // Number of columns, one per byte class
+    [[nodiscard]] size_t getColumnCount() const {
+        return columnCount;
+    }
+
+    [[nodiscard]] const ByteClasses& getByteClasses() const {
+        return byteClasses;
+    }
+
+    [[nodiscard]] uint32_t getTransition(uint32_t state, unsigned char symbol) const {
+        uint8_t symbolClass = byteClasses.classOf(symbol);
+        return withTable([&](const auto& table) { return table.next(state, symbolClass); });
+    }
+
+    // Bytes per state id in the transition table
+    [[nodiscard]] size_t getStateWidth() const {
+        return stateWidth;
+    }
+
+    [[nodiscard]] Encoding getEncoding() const {
+        return encoding;
+    }
+
+    // Bytes held by the tables matching reads, whether owned or mapped
+    [[nodiscard]] size_t getMemoryUsage() const {
+        size_t transitionBytes = encoding == Encoding::COMB
+                                 ? combRows.size() * sizeof(CombRow) + combStorage.size()
+                                 : stateCount * columnCount * stateWidth;
+        return 256 + transitionBytes + (stateCount + 63) / 64 * sizeof(uint64_t) + stateCount * sizeof(int32_t);
+    }
+
+    // A copy with its transitions in the given encoding, which owns its tables even if this DFA is mapped
+    [[nodiscard]] CompiledDFA withEncoding(Encoding newEncoding) const {
+        std::vector<uint32_t> order(stateCount);
+        for (uint32_t state = 0; state < stateCount; ++state) {
+            order[state] = state;
+        }
+        return renumbered(order, newEncoding);
+    }
+
+    // The fewest bytes that hold the id of every one of stateCount states, counting the dead state
+    static size_t stateWidthFor(size_t stateCount) {
+        return stateCount <= 0x100 ? 1 : stateCount <= 0x10000 ? 2 : 4;
+    }
+
+    // A copy with the states renumbered, state order[i] becoming state i. order holds every state once and starts with
+    // the dead state. The copy owns its tables, even if this DFA is mapped.
+    [[nodiscard]] CompiledDFA renumbered(const std::vector<uint32_t>& order) const {
+        return renumbered(order, encoding);
+    }
+
+private:
+    friend class DFAFile;
+
+    // A row of the COMB encoding, whose entries start at base
+    struct CombRow {
+        uint32_t base;
+        uint32_t defaultTarget;
+    };
+
+    template<typename StateId>
+    struct DenseTable {
+        const unsigned char* cells;
+        size_t columnCount;
+
+        [[nodiscard]] uint32_t next(uint32_t state, uint8_t symbolClass) const {
+            return reinterpret_cast<const StateId*>(cells)[state * columnCount + symbolClass];
+        }
+    };
+
+    // Entries are (owner, target) pairs of state ids
+    template<typename StateId>
+    struct CombTable {
+        const CombRow* rows;
+        const StateId* entries;
+
+        [[nodiscard]] uint32_t next(uint32_t state, uint8_t symbolClass) const {
+            const StateId* entry = entries + 2 * (rows[state].base + symbolClass);
+            return entry[0] == state ? entry[1] : rows[state].defaultTarget;
+        }
+    };
+
+    ByteClasses byteClasses;
+    size_t columnCount = 1;
+    size_t stateCount = 1;
+    size_t stateWidth = 1;
+    Encoding encoding = Encoding::DENSE;
+    uint32_t startState = DEAD_STATE;
+
+    // Owned tables, left empty when the tables live in a mapped file. Dense transitions are state ids of stateWidth
+    // bytes, left empty in the COMB encoding, whose tables are always owned and hold ids of the same width.
+    std::vector<unsigned char> transitionStorage;
+    std::vector<CombRow> combRows;
+    std::vector<unsigned char> combStorage;
+    std::vector<uint64_t> acceptStorage;
+    std::vector<int32_t> ruleStorage;
+    // Keeps a mapped file alive for as long as the tables point into it
+    std::shared_ptr<const void> backing;
+
+    // The tables matching reads from, pointing into either the storage vectors or the mapped file
+    const unsigned char* transitions = nullptr;
+    const uint64_t* acceptBits = nullptr;
+    const int32_t* acceptRules = nullptr;
+
+    // Renumbers as the public overload does, storing the copy's transitions in newEncoding
+    [[nodiscard]] CompiledDFA renumbered(const std::vector<uint32_t>& order, Encoding newEncoding) const {
+        if (order.size() != stateCount || order[0] != DEAD_STATE) {
+            throw std::runtime_error("Invalid state order: expected every state once, starting with the dead state");
+        }
+        std::vector<uint32_t> newIndex(stateCount, UINT32_MAX);
+        for (uint32_t index = 0; index < stateCount; ++index) {
+            if (order[index] >= stateCount || newIndex[order[index]] != UINT32_MAX) {
+                throw std::runtime_error("Invalid state order: expected every state once, starting with the dead state");
+            }
+            newIndex[order[index]] = index;
+        }
+
+        CompiledDFA result;
+        result.byteClasses = byteClasses;
+        result.columnCount = columnCount;
+        result.stateCount = stateCount;
+        result.startState = newIndex[startState];
+        std::vector<uint32_t> table(stateCount * columnCount);
+        result.acceptStorage.assign((stateCount + 63) / 64, 0);
+        result.ruleStorage.assign(stateCount, NO_RULE);
+        std::vector<unsigned char> symbols(columnCount);
+        for (int byte = 0; byte < 256; ++byte) {
+            symbols[byteClasses.classOf(static_cast<unsigned char>(byte))] = static_cast<unsigned char>(byte);
+        }
+        for (uint32_t index = 0; index < stateCount; ++index) {
+            uint32_t state = order[index];
+            for (size_t column = 0; column < columnCount; ++column) {
+                table[index * columnCount + column] = newIndex[getTransition(state, symbols[column])];
+            }
+            if (isAccept(state)) {
+                result.acceptStorage[index / 64] |= uint64_t{1} << (index % 64);
+            }
+            result.ruleStorage[index] = acceptRules[state];
+        }
+        result.storeTransitions(table, newEncoding);
+        result.bindStorage();
+        return result;
+    }
+
+    // Calls visitor with the table in its encoding and state id width, so every matching loop is compiled for each
+    template<typename Visitor>
+    auto withTable(Visitor&& visitor) const -> decltype(visitor(DenseTable<uint8_t>{})) {
+        if (encoding == Encoding::COMB) {
+            switch (stateWidth) {
+                case 1: return visitor(combTable<uint8_t>());
+                case 2: return visitor(combTable<uint16_t>());
+                default: return visitor(combTable<uint32_t>());
+            }
+        }
+        switch (stateWidth) {
+            case 1: return visitor(DenseTable<uint8_t>{transitions, columnCount});
+            case 2: return visitor(DenseTable<uint16_t>{transitions, columnCount});
+            default: return visitor(DenseTable<uint32_t>{transitions, columnCount});
+        }
+    }
+
+    template<typename StateId>
+    [[nodiscard]] CombTable<StateId> combTable() const {
+        return {combRows.data(), reinterpret_cast<const StateId*>(combStorage.data())};
+    }
+
+    void bindStorage() {
+        transitions = transitionStorage.data();
+        acceptBits = acceptStorage.data();
+        acceptRules = ruleStorage.data();
+    }
+
+    // Stores a dense table of state ids in an encoding
+    void storeTransitions(const std::vector<uint32_t>& table, Encoding newEncoding) {
+        encoding = newEncoding;
+        stateWidth = stateWidthFor(stateCount);
+        if (encoding == Encoding::COMB) {
+            transitionStorage.clear();
+            storeComb(table);
+            return;
+        }
+        combRows.clear();
+        combStorage.clear();
+        transitionStorage = narrowed(table);
+    }
+
+    // State ids of stateWidth bytes each
+    [[nodiscard]] std::vector<unsigned char> narrowed(const std::vector<uint32_t>& ids) const {
+        std::vector<unsigned char> storage(ids.size() * stateWidth, 0);
+        switch (stateWidth) {
+            case 1: std::copy(ids.begin(), ids.end(), storage.begin()); break;
+            case 2: std::copy(ids.begin(), ids.end(), reinterpret_cast<uint16_t*>(storage.data())); break;
+            default: std::copy(ids.begin(), ids.end(), reinterpret_cast<uint32_t*>(storage.data()));
+        }
+        return storage;
+    }
+
+    // Packs the exceptions of every row into the comb, the rows with the most exceptions first, each at the lowest base
+    // where all of them land in free entries. The dead state has no exceptions, so it owns no entry.
+    void storeComb(const std::vector<uint32_t>& table) {
+        combRows.assign(stateCount, {0, DEAD_STATE});
+        std::vector<std::vector<uint8_t>> exceptions(stateCount);
+        std::vector<uint32_t> row;
+        for (uint32_t state = 0; state < stateCount; ++state) {
+            row.assign(table.begin() + state * columnCount, table.begin() + (state + 1) * columnCount);
+            std::sort(row.begin(), row.end());
+            size_t bestRun = 0;
+            for (size_t i = 0, j; i < row.size(); i = j) {
+                for (j = i; j < row.size() && row[j] == row[i]; ++j) {}
+                if (j - i > bestRun) {
+                    bestRun = j - i;
+                    combRows[state].defaultTarget = row[i];
+                }
+            }
+            for (size_t column = 0; column < columnCount; ++column) {
+                if (table[state * columnCount + column] != combRows[state].defaultTarget) {
+                    exceptions[state].push_back(static_cast<uint8_t>(column));
+                }
+            }
+        }
+
+        std::vector<uint32_t> order(stateCount);
+        for (uint32_t state = 0; state < stateCount; ++state) {
+            order[state] = state;
+        }
+        std::stable_sort(order.begin(), order.end(), [&exceptions](uint32_t a, uint32_t b) {
+            return exceptions[a].size() > exceptions[b].size();
+        });
+
+        // Every base leaves room for a whole row, so a lookup never runs off the end. Entries are built wide, as
+        // (owner, target) pairs, and narrowed at the end.
+        std::vector<uint32_t> entries(2 * columnCount, DEAD_STATE);
+        size_t firstFree = 0;
+        for (uint32_t state : order) {
+            const auto& columns = exceptions[state];
+            if (columns.empty()) break;
+            while (firstFree < entries.size() / 2 && entries[2 * firstFree] != DEAD_STATE) firstFree++;
+
+            size_t base = firstFree >= columns[0] ? firstFree - columns[0] : 0;
+            for (;; ++base) {
+                if (2 * (base + columnCount) > entries.size()) {
+                    entries.resize(2 * (base + columnCount), DEAD_STATE);
+                }
+                bool fits = std::all_of(columns.begin(), columns.end(), [&](uint8_t column) {
+                    return entries[2 * (base + column)] == DEAD_STATE;
+                });
+                if (fits) break;
+            }
+            combRows[state].base = static_cast<uint32_t>(base);
+            for (uint8_t column : columns) {
+                entries[2 * (base + column)] = state;
+                entries[2 * (base + column) + 1] = table[state * columnCount + column];
+            }
+        }
+        combStorage = narrowed(entries);
+    }
+
+    [[nodiscard]] size_t longestPrefixOf(std::string_view input, uint32_t& lastAccept) const {
+        return withTable([&](const auto& table) { return longestPrefixWith(table, input, lastAccept); });
+    }
+
+    template<typename Table>
+    [[nodiscard]] bool matchWith(const Table& table, std::string_view input) const {
+        const uint8_t* classes = byteClasses.getTable().data();
+        uint32_t state = startState;
+        Stats::scan(state);
+
+        for (unsigned char c : input) {
+            state = table.next(state, classes[c]);
+            if (state == DEAD_STATE) {
+                Stats::deadStateExit();
+                return false;
+            }
+            Stats::visit(state);
+        }
+        return isAccept(state);
+    }
+
+    // The longest accepted prefix, with lastAccept the state it ends in, or the dead state if there is none
+    template<typename Table>
+    [[nodiscard]] size_t longestPrefixWith(const Table& table, std::string_view input, uint32_t& lastAccept) const {
+        const uint8_t* classes = byteClasses.getTable().data();
+        uint32_t state = startState;
+        lastAccept = isAccept(state) ? state : DEAD_STATE;
+        size_t longest = isAccept(state) ? 0 : NO_MATCH;
+        Stats::scan(state);
+
+        for (size_t i = 0; i < input.size(); ++i) {
+            state = table.next(state, classes[static_cast<unsigned char>(input[i])]);
+            if (state == DEAD_STATE) {
+                Stats::deadStateExit();
+                break;
+            }
+            Stats::visit(state);
+            if (isAccept(state)) {
+                lastAccept = state;
+                longest = i + 1;
+            }
+        }
+        return longest;
+    }
+};
+
+
+#endif //SYPHON_COMPILEDDFA_H
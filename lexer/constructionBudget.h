@@ -0,0 +1,129 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_CONSTRUCTIONBUDGET_H
+#define SYPHON_CONSTRUCTIONBUDGET_H
+
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Limits on determinizing an NFA, whose DFA can have exponentially many states, as (a|b)*a(a|b){30} does. Bytes are
+// estimated from the state sets interned and the transitions built, which is what grows with the state count.
+struct ConstructionBudget {
+    size_t maxStates = SIZE_MAX;
+    size_t maxBytes = SIZE_MAX;
+    std::chrono::steady_clock::duration timeout = std::chrono::steady_clock::duration::max();
+};
+
+// How far a construction got, and which limit it ran into, if any
+struct ConstructionReport {
+    enum class Limit {
+        NONE,
+        STATES,
+        BYTES,
+        TIME,
+    };
+
+    Limit exceeded = Limit::NONE;
+    size_t states = 0;          // DFA states found
+    size_t expandedStates = 0;  // DFA states whose transitions were built
+    size_t bytes = 0;
+    double seconds = 0;
+
+    [[nodiscard]] std::string toString() const {
+        static const char* const limits[] = {"within budget", "exceeded the state budget",
+                                             "exceeded the memory budget", "exceeded the time budget"};
+        char seconds[32];
+        std::snprintf(seconds, sizeof(seconds), "%.3g", this->seconds);
+        return std::string(limits[static_cast<int>(exceeded)]) + " after " + std::to_string(states) + " states (" +
+               std::to_string(expandedStates) + " expanded), " + std::to_string(bytes) + " bytes and " + seconds + " s";
+    }
+};
+
+// Thrown by a construction that runs out of budget, after freeing what it built
+class ConstructionBudgetExceeded : public std::runtime_error {
+public:
+    explicit ConstructionBudgetExceeded(const ConstructionReport& report)
+            : std::runtime_error("Invalid DFA construction: " + report.toString()), report(report) {}
+
+    [[nodiscard]] const ConstructionReport& getReport() const {
+        return report;
+    }
+
+private:
+    ConstructionReport report;
+};
+
+// Keeps the account of a breadth-first subset construction against its budget. The construction reports every state
+// set it interns and every row of transitions it builds, and asks expand before expanding the next state. All of them
+// may be called from several threads at once, as ParallelConstruction does.
+class BudgetMeter {
+public:
+    explicit BudgetMeter(const ConstructionBudget& budget)
+            : budget(budget), startTime(std::chrono::steady_clock::now()) {}
+
+    void addState(const std::vector<int>& stateSet) {
+        // The set is stored once as the map key, plus the map node and the pointer in the queue
+        states.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(stateSet.size() * sizeof(int) + sizeof(std::vector<int>) + 5 * sizeof(void*),
+                        std::memory_order_relaxed);
+    }
+
+    void addTransitions(size_t count, size_t bytesPerTransition) {
+        bytes.fetch_add(count * bytesPerTransition, std::memory_order_relaxed);
+    }
+
+    // True if the budget allows expanding another state, counting it as expanded. Once false, stays false.
+    [[nodiscard]] bool expand() {
+        using Limit = ConstructionReport::Limit;
+        if (isExceeded()) return false;
+        Limit limit = Limit::NONE;
+        if (states.load(std::memory_order_relaxed) > budget.maxStates) {
+            limit = Limit::STATES;
+        } else if (bytes.load(std::memory_order_relaxed) > budget.maxBytes) {
+            limit = Limit::BYTES;
+        } else if (budget.timeout != std::chrono::steady_clock::duration::max() &&
+                   std::chrono::steady_clock::now() - startTime >= budget.timeout) {
+            limit = Limit::TIME;
+        } else {
+            expandedStates.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        Limit none = Limit::NONE;
+        exceeded.compare_exchange_strong(none, limit);
+        return false;
+    }
+
+    // True once expand has turned a state down
+    [[nodiscard]] bool isExceeded() const {
+        return exceeded.load() != ConstructionReport::Limit::NONE;
+    }
+
+    [[nodiscard]] ConstructionReport finish() const {
+        ConstructionReport report;
+        report.exceeded = exceeded.load();
+        report.states = states.load();
+        report.expandedStates = expandedStates.load();
+        report.bytes = bytes.load();
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        return report;
+    }
+
+private:
+    ConstructionBudget budget;
+    std::chrono::steady_clock::time_point startTime;
+    std::atomic<size_t> states{0};
+    std::atomic<size_t> expandedStates{0};
+    std::atomic<size_t> bytes{0};
+    std::atomic<ConstructionReport::Limit> exceeded{ConstructionReport::Limit::NONE};
+};
+
+
+#endif //SYPHON_CONSTRUCTIONBUDGET_H
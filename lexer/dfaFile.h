@@ -0,0 +1,214 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_DFAFILE_H
+#define SYPHON_DFAFILE_H
+
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "compiledDFA.h"
+#include "mappedFile.h"
+
+// Header of a compiled DFA file. The layout is:
+//
+//   header        DFAFileHeader
+//   class table   256 x uint8, the byte class of every byte
+//   transitions   stateCount x classCount state ids, row 0 being the dead state. An id takes
+//                 CompiledDFA::stateWidthFor(stateCount) bytes, as uint8, uint16 or uint32.
+//   accept bits   ceil(stateCount / 64) x uint64
+//   accept rules  stateCount x int32, NO_RULE for states that accept nothing
+//   token ids     ruleCount x int32, the token id of every rule, possibly none
+//
+// Every section starts on an 8-byte boundary, at an offset from the start of the file, so a mapping of the file can
+// be used in place wherever it lands. Values are stored in the byte order of the host that wrote the file.
+struct DFAFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint64_t stateCount;
+    uint32_t classCount;
+    uint32_t startState;
+    uint64_t ruleCount;
+    uint64_t classTableOffset;
+    uint64_t transitionsOffset;
+    uint64_t acceptBitsOffset;
+    uint64_t acceptRulesOffset;
+    uint64_t tokenIdsOffset;
+    uint64_t fileSize;
+};
+
+// Writes compiled DFAs to disk and maps them back for matching without parsing or copying the tables
+class DFAFile {
+public:
+    static constexpr char MAGIC[8] = {'S', 'Y', 'P', 'H', 'D', 'F', 'A', '\0'};
+    static constexpr uint32_t VERSION = 2;
+    static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    static void write(const std::string& path, const CompiledDFA& dfa, const std::vector<int>& tokenIds = {}) {
+        // Files hold dense tables only, which the mapping matches from in place
+        if (dfa.getEncoding() != CompiledDFA::Encoding::DENSE) {
+            write(path, dfa.withEncoding(CompiledDFA::Encoding::DENSE), tokenIds);
+            return;
+        }
+        DFAFileHeader header = layout(dfa.stateCount, dfa.columnCount, tokenIds.size());
+        header.startState = dfa.startState;
+
+        std::vector<unsigned char> contents(header.fileSize, 0);
+        std::memcpy(contents.data(), &header, sizeof(header));
+        std::memcpy(contents.data() + header.classTableOffset, dfa.byteClasses.getTable().data(), 256);
+        std::memcpy(contents.data() + header.transitionsOffset, dfa.transitions,
+                    dfa.stateCount * dfa.columnCount * dfa.stateWidth);
+        std::memcpy(contents.data() + header.acceptBitsOffset, dfa.acceptBits,
+                    acceptWords(dfa.stateCount) * sizeof(uint64_t));
+        std::memcpy(contents.data() + header.acceptRulesOffset, dfa.acceptRules, dfa.stateCount * sizeof(int32_t));
+        for (size_t rule = 0; rule < tokenIds.size(); ++rule) {
+            auto tokenId = static_cast<int32_t>(tokenIds[rule]);
+            std::memcpy(contents.data() + header.tokenIdsOffset + rule * sizeof(int32_t), &tokenId, sizeof(tokenId));
+        }
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+        if (!file) throw std::runtime_error("Cannot write " + path);
+    }
+
+    // Maps a file written by write. The returned DFA matches straight from the mapping and keeps it alive. The token
+    // ids stored with the DFA are copied into tokenIds if given, in which case the file must hold a lexer: a token id
+    // for every accept rule, and a start state that does not accept.
+    static CompiledDFA map(const std::string& path, std::vector<int>* tokenIds = nullptr) {
+        std::shared_ptr<const MappedFile> file = MappedFile::open(path);
+        const unsigned char* data = file->getData();
+
+        if (file->getSize() < sizeof(DFAFileHeader)) throw std::runtime_error("Invalid DFA file: " + path + " is truncated");
+        DFAFileHeader header{};
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+            throw std::runtime_error("Invalid DFA file: " + path + " is not a DFA file");
+        }
+        if (header.version != VERSION) {
+            throw std::runtime_error("Invalid DFA file: " + path + " has version " + std::to_string(header.version) +
+                                     ", expected " + std::to_string(VERSION));
+        }
+        if (header.byteOrderMark != BYTE_ORDER_MARK) {
+            throw std::runtime_error("Invalid DFA file: " + path + " was written with a different byte order");
+        }
+        if (header.stateCount == 0 || header.stateCount > file->getSize() || header.ruleCount > file->getSize() ||
+            header.classCount == 0 || header.classCount > 256 || header.startState >= header.stateCount) {
+            throw std::runtime_error("Invalid DFA file: " + path + " has an inconsistent header");
+        }
+
+        // The offsets must be exactly the ones write produces, which also bounds every section by the file size
+        DFAFileHeader expected = layout(header.stateCount, header.classCount, header.ruleCount);
+        if (header.classTableOffset != expected.classTableOffset ||
+            header.transitionsOffset != expected.transitionsOffset ||
+            header.acceptBitsOffset != expected.acceptBitsOffset ||
+            header.acceptRulesOffset != expected.acceptRulesOffset ||
+            header.tokenIdsOffset != expected.tokenIdsOffset ||
+            header.fileSize != expected.fileSize || file->getSize() != header.fileSize) {
+            throw std::runtime_error("Invalid DFA file: " + path + " has an inconsistent layout");
+        }
+        for (int byte = 0; byte < 256; ++byte) {
+            if (data[header.classTableOffset + byte] >= header.classCount) {
+                throw std::runtime_error("Invalid DFA file: " + path + " has an invalid class table");
+            }
+        }
+
+        checkTables(path, data, header, tokenIds != nullptr);
+
+        CompiledDFA dfa;
+        dfa.byteClasses = ByteClasses::fromTable(data + header.classTableOffset);
+        dfa.columnCount = header.classCount;
+        dfa.stateCount = header.stateCount;
+        dfa.stateWidth = CompiledDFA::stateWidthFor(header.stateCount);
+        dfa.startState = header.startState;
+        dfa.transitionStorage.clear();
+        dfa.acceptStorage.clear();
+        dfa.ruleStorage.clear();
+        dfa.transitions = data + header.transitionsOffset;
+        dfa.acceptBits = reinterpret_cast<const uint64_t*>(data + header.acceptBitsOffset);
+        dfa.acceptRules = reinterpret_cast<const int32_t*>(data + header.acceptRulesOffset);
+        dfa.backing = file;
+
+        if (tokenIds) {
+            const auto* storedIds = reinterpret_cast<const int32_t*>(data + header.tokenIdsOffset);
+            tokenIds->assign(storedIds, storedIds + header.ruleCount);
+        }
+        return dfa;
+    }
+
+private:
+    // Matching trusts the tables, so every state id and accept rule in them is checked once here. Rules are bounded by
+    // the token ids when the file has any, or when it is mapped for them.
+    static void checkTables(const std::string& path, const unsigned char* data, const DFAFileHeader& header,
+                            bool forLexer) {
+        const size_t stateWidth = CompiledDFA::stateWidthFor(header.stateCount);
+        const unsigned char* transitions = data + header.transitionsOffset;
+        for (size_t i = 0; i < header.stateCount * header.classCount; ++i) {
+            uint32_t target;
+            if (stateWidth == 1) {
+                target = transitions[i];
+            } else if (stateWidth == 2) {
+                uint16_t narrow;
+                std::memcpy(&narrow, transitions + i * 2, sizeof(narrow));
+                target = narrow;
+            } else {
+                std::memcpy(&target, transitions + i * 4, sizeof(target));
+            }
+            if (target >= header.stateCount) {
+                throw std::runtime_error("Invalid DFA file: " + path + " has a transition to state " +
+                                         std::to_string(target) + " of " + std::to_string(header.stateCount));
+            }
+        }
+
+        const bool boundedRules = forLexer || header.ruleCount > 0;
+        for (size_t state = 0; state < header.stateCount; ++state) {
+            uint64_t acceptWord;
+            int32_t rule;
+            std::memcpy(&acceptWord, data + header.acceptBitsOffset + state / 64 * sizeof(uint64_t), sizeof(acceptWord));
+            std::memcpy(&rule, data + header.acceptRulesOffset + state * sizeof(int32_t), sizeof(rule));
+            bool accepting = (acceptWord >> (state % 64)) & 1;
+            if ((accepting && rule < 0) || (rule < 0 && rule != NO_RULE) ||
+                (boundedRules && rule >= 0 && static_cast<uint64_t>(rule) >= header.ruleCount)) {
+                throw std::runtime_error("Invalid DFA file: " + path + " has an invalid accept rule " +
+                                         std::to_string(rule) + " in state " + std::to_string(state));
+            }
+            if (forLexer && accepting && state == header.startState) {
+                throw std::runtime_error("Invalid DFA file: " + path + " has an accepting start state");
+            }
+        }
+    }
+
+    static size_t acceptWords(size_t stateCount) {
+        return (stateCount + 63) / 64;
+    }
+
+    static uint64_t align(uint64_t offset) {
+        return (offset + 7) & ~uint64_t{7};
+    }
+
+    // Places every section after the header
+    static DFAFileHeader layout(uint64_t stateCount, uint32_t classCount, uint64_t ruleCount) {
+        DFAFileHeader header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.byteOrderMark = BYTE_ORDER_MARK;
+        header.stateCount = stateCount;
+        header.classCount = classCount;
+        header.ruleCount = ruleCount;
+        header.classTableOffset = align(sizeof(DFAFileHeader));
+        header.transitionsOffset = align(header.classTableOffset + 256);
+        header.acceptBitsOffset = align(header.transitionsOffset +
+                                        stateCount * classCount * CompiledDFA::stateWidthFor(stateCount));
+        header.acceptRulesOffset = align(header.acceptBitsOffset + acceptWords(stateCount) * sizeof(uint64_t));
+        header.tokenIdsOffset = align(header.acceptRulesOffset + stateCount * sizeof(int32_t));
+        header.fileSize = align(header.tokenIdsOffset + ruleCount * sizeof(int32_t));
+        return header;
+    }
+};
+
+
+#endif //SYPHON_DFAFILE_H
@@ -0,0 +1,91 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_DFALAYOUT_H
+#define SYPHON_DFALAYOUT_H
+
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "compiledDFA.h"
+
+// Orders the states of a CompiledDFA so the rows matching reads together sit together in the transition table.
+// minimize_dfa numbers states in partition order, which scatters the states a scan walks through over the whole
+// table. Every order keeps the dead state as state 0 and goes to CompiledDFA::renumbered.
+class DFALayout {
+public:
+    // The states reachable from the start in breadth-first order, so the states near the start, which every token
+    // passes through, come first. Unreachable states go last.
+    static std::vector<uint32_t> breadthFirst(const CompiledDFA& dfa) {
+        std::vector<uint32_t> order = {CompiledDFA::DEAD_STATE};
+        std::vector<bool> placed(dfa.getStateCount(), false);
+        placed[CompiledDFA::DEAD_STATE] = true;
+        std::vector<unsigned char> symbols = classSymbols(dfa);
+
+        auto visitFrom = [&](uint32_t root) {
+            if (placed[root]) return;
+            placed[root] = true;
+            size_t first = order.size();
+            order.push_back(root);
+            for (size_t i = first; i < order.size(); ++i) {
+                for (unsigned char symbol : symbols) {
+                    uint32_t target = dfa.getTransition(order[i], symbol);
+                    if (!placed[target]) {
+                        placed[target] = true;
+                        order.push_back(target);
+                    }
+                }
+            }
+        };
+        visitFrom(dfa.getStartState());
+        for (uint32_t state = 1; state < dfa.getStateCount(); ++state) {
+            visitFrom(state);
+        }
+        return order;
+    }
+
+    // The states a profile visited first, then the rest, both in breadth-first order. The hot rows share cache lines
+    // and keep the order a scan walks them in, and the cold ones stay out of the way. visits is indexed by state, as
+    // Stats::Matching::stateVisits or countVisits give it, and may be short.
+    static std::vector<uint32_t> byProfile(const CompiledDFA& dfa, const std::vector<uint64_t>& visits) {
+        std::vector<uint32_t> order = breadthFirst(dfa);
+        std::stable_partition(order.begin() + 1, order.end(),
+                              [&visits](uint32_t state) { return state < visits.size() && visits[state] > 0; });
+        return order;
+    }
+
+    // A visit profile from tokenizing a sample as Lexer does: longest match after longest match, skipping a byte
+    // where nothing matches. Counts the same transitions Stats::Matching does, without a build with SYPHON_STATS.
+    static std::vector<uint64_t> countVisits(const CompiledDFA& dfa, std::string_view sample) {
+        std::vector<uint64_t> visits(dfa.getStateCount(), 0);
+        for (size_t offset = 0; offset < sample.size();) {
+            uint32_t state = dfa.getStartState();
+            size_t longest = 0;
+            visits[state]++;
+            for (size_t i = offset; i < sample.size(); ++i) {
+                state = dfa.getTransition(state, static_cast<unsigned char>(sample[i]));
+                if (state == CompiledDFA::DEAD_STATE) break;
+                visits[state]++;
+                if (dfa.isAccept(state)) longest = i + 1 - offset;
+            }
+            offset += std::max<size_t>(longest, 1);
+        }
+        return visits;
+    }
+
+private:
+    // One byte of every byte class
+    static std::vector<unsigned char> classSymbols(const CompiledDFA& dfa) {
+        std::vector<unsigned char> symbols(dfa.getColumnCount());
+        for (int byte = 255; byte >= 0; --byte) {
+            symbols[dfa.getByteClasses().classOf(static_cast<unsigned char>(byte))] = static_cast<unsigned char>(byte);
+        }
+        return symbols;
+    }
+};
+
+
+#endif //SYPHON_DFALAYOUT_H
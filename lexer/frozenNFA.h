@@ -0,0 +1,243 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_FROZENNFA_H
+#define SYPHON_FROZENNFA_H
+
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+#include "automata.h"
+
+// An immutable NFA in flat arrays, for the algorithms that only read an NFA. States are numbered densely from 0. The
+// byte edges of all states sit in one array in compressed sparse row form, the edges of state s being those from
+// edgeStart[s] to edgeStart[s + 1], with a byte edge standing for a whole range of bytes. Epsilon edges are kept
+// apart the same way, in the order they were added, which is the order of preference between the paths they start.
+// An epsilon edge may carry a tag for capture groups. Accept states are a bitset, so a state costs a few bytes instead
+// of the tree nodes of NFA.
+class FrozenNFA {
+public:
+    // An edge on every byte from low to high. A state's edges are sorted by target, then by range.
+    struct Edge {
+        uint32_t target;
+        unsigned char low;
+        unsigned char high;
+
+        auto operator<=>(const Edge& other) const = default;
+    };
+
+    FrozenNFA() = default;
+
+    // Renumbers the states of an NFA in increasing order. An NFA has no tags and keeps its epsilon edges sorted by target.
+    explicit FrozenNFA(const NFA& nfa) {
+        std::vector<int> ids(nfa.getStates().begin(), nfa.getStates().end());
+        if (ids.empty()) {
+            return;
+        }
+        auto indexOf = [&ids](int state) {
+            return static_cast<uint32_t>(std::lower_bound(ids.begin(), ids.end(), state) - ids.begin());
+        };
+
+        std::vector<std::pair<uint32_t, Edge>> edges;
+        std::vector<std::pair<uint32_t, EpsilonEdge>> epsilons;
+        for (const auto& [key, targets] : nfa.getTransitionTable()) {
+            uint32_t from = indexOf(key.first);
+            auto byte = static_cast<unsigned char>(key.second);
+            for (int target : targets) {
+                if (key.second == EPSILON) {
+                    epsilons.push_back({from, {indexOf(target), NO_TAG}});
+                } else {
+                    edges.push_back({from, {indexOf(target), byte, byte}});
+                }
+            }
+        }
+        for (const auto& [state, ranges] : nfa.getRangeTransitions()) {
+            for (const auto& range : ranges) {
+                edges.push_back({indexOf(state), {indexOf(range.toState), range.low, range.high}});
+            }
+        }
+
+        std::vector<std::pair<uint32_t, int>> accepts;
+        for (int state : nfa.getAcceptState()) {
+            accepts.emplace_back(indexOf(state), nfa.getAcceptRule(state));
+        }
+        build(static_cast<uint32_t>(ids.size()), indexOf(nfa.getStartState()), edges, epsilons, accepts,
+              !nfa.getAcceptRules().empty());
+    }
+
+    // Freezes an NFA straight from Thompson construction, whose state ids are dense already. acceptRules tags accept
+    // states with rules, in addition to the untagged accept states of the fragment.
+    FrozenNFA(const NFAArena& arena, const NFAFragment& fragment,
+              const std::vector<std::pair<int, int>>& acceptRules = {}) {
+        if (arena.stateCount == 0) {
+            return;
+        }
+
+        std::vector<std::pair<uint32_t, Edge>> edges;
+        std::vector<std::pair<uint32_t, EpsilonEdge>> epsilons;
+        edges.reserve(arena.edges.size() + arena.rangeEdges.size());
+        for (const auto& edge : arena.edges) {
+            auto from = static_cast<uint32_t>(edge.fromState);
+            auto to = static_cast<uint32_t>(edge.toState);
+            if (edge.symbol == EPSILON) {
+                epsilons.push_back({from, {to, edge.tag}});
+            } else {
+                auto byte = static_cast<unsigned char>(edge.symbol);
+                edges.push_back({from, {to, byte, byte}});
+            }
+        }
+        for (const auto& edge : arena.rangeEdges) {
+            edges.push_back({static_cast<uint32_t>(edge.fromState),
+                             {static_cast<uint32_t>(edge.toState), edge.low, edge.high}});
+        }
+
+        std::vector<std::pair<uint32_t, int>> accepts;
+        for (int state : fragment.acceptStates) {
+            accepts.emplace_back(static_cast<uint32_t>(state), 0);
+        }
+        for (auto [state, rule] : acceptRules) {
+            accepts.emplace_back(static_cast<uint32_t>(state), rule);
+        }
+        build(static_cast<uint32_t>(arena.stateCount), static_cast<uint32_t>(fragment.startState), edges, epsilons,
+              accepts, !acceptRules.empty());
+    }
+
+    [[nodiscard]] bool empty() const {
+        return stateCount == 0;
+    }
+
+    [[nodiscard]] int getStateCount() const {
+        return static_cast<int>(stateCount);
+    }
+
+    [[nodiscard]] int getStartState() const {
+        return static_cast<int>(startState);
+    }
+
+    [[nodiscard]] std::span<const Edge> getEdges(int state) const {
+        return {edges.data() + edgeStart[state], edges.data() + edgeStart[state + 1]};
+    }
+
+    [[nodiscard]] std::span<const uint32_t> getEpsilonTargets(int state) const {
+        return {epsilonTargets.data() + epsilonStart[state], epsilonTargets.data() + epsilonStart[state + 1]};
+    }
+
+    // The tag of every epsilon edge of a state, in the order of getEpsilonTargets, or NO_TAG
+    [[nodiscard]] std::span<const int16_t> getEpsilonTags(int state) const {
+        if (epsilonTags.empty()) return {};
+        return {epsilonTags.data() + epsilonStart[state], epsilonTags.data() + epsilonStart[state + 1]};
+    }
+
+    [[nodiscard]] bool hasTags() const {
+        return !epsilonTags.empty();
+    }
+
+    [[nodiscard]] size_t getEdgeCount() const {
+        return edges.size();
+    }
+
+    [[nodiscard]] size_t getEpsilonCount() const {
+        return epsilonTargets.size();
+    }
+
+    [[nodiscard]] bool isAccept(int state) const {
+        return (acceptBits[state / 64] >> (state % 64)) & 1;
+    }
+
+    // As FiniteAutomaton::getAcceptRule: rule 0 for accept states without a rule, NO_RULE for other states
+    [[nodiscard]] int getAcceptRule(int state) const {
+        if (!isAccept(state)) return NO_RULE;
+        return acceptRules.empty() ? 0 : acceptRules[state];
+    }
+
+    // True if accept states were tagged with rules, as by RegexToNFA::fromRules
+    [[nodiscard]] bool hasAcceptRules() const {
+        return !acceptRules.empty();
+    }
+
+    // Bytes held by the arrays
+    [[nodiscard]] size_t getMemoryUsage() const {
+        return edgeStart.size() * sizeof(uint32_t) + edges.size() * sizeof(Edge) +
+               epsilonStart.size() * sizeof(uint32_t) + epsilonTargets.size() * sizeof(uint32_t) +
+               epsilonTags.size() * sizeof(int16_t) + acceptBits.size() * sizeof(uint64_t) +
+               acceptRules.size() * sizeof(int);
+    }
+
+private:
+    uint32_t stateCount = 0;
+    uint32_t startState = 0;
+    std::vector<uint32_t> edgeStart;
+    std::vector<Edge> edges;
+    std::vector<uint32_t> epsilonStart;
+    std::vector<uint32_t> epsilonTargets;
+    std::vector<int16_t> epsilonTags;  // Only if some epsilon edge has a tag
+    std::vector<uint64_t> acceptBits;
+    std::vector<int> acceptRules;  // Rule of every state, only if accept states were tagged
+
+    struct EpsilonEdge {
+        uint32_t target;
+        int16_t tag;
+    };
+
+    void build(uint32_t states, uint32_t start, std::vector<std::pair<uint32_t, Edge>>& edgeList,
+               std::vector<std::pair<uint32_t, EpsilonEdge>>& epsilonList,
+               const std::vector<std::pair<uint32_t, int>>& accepts, bool tagged) {
+        stateCount = states;
+        startState = start;
+
+        std::sort(edgeList.begin(), edgeList.end());
+        edgeList.erase(std::unique(edgeList.begin(), edgeList.end()), edgeList.end());
+        edgeStart = rowStarts(edgeList);
+        edges.reserve(edgeList.size());
+        for (const auto& entry : edgeList) {
+            edges.push_back(entry.second);
+        }
+
+        std::stable_sort(epsilonList.begin(), epsilonList.end(),
+                         [](const auto& a, const auto& b) { return a.first < b.first; });
+        epsilonStart = rowStarts(epsilonList);
+        epsilonTargets.reserve(epsilonList.size());
+        bool anyTag = false;
+        for (const auto& entry : epsilonList) {
+            epsilonTargets.push_back(entry.second.target);
+            anyTag |= entry.second.tag != NO_TAG;
+        }
+        if (anyTag) {
+            epsilonTags.reserve(epsilonList.size());
+            for (const auto& entry : epsilonList) {
+                epsilonTags.push_back(entry.second.tag);
+            }
+        }
+
+        acceptBits.assign((stateCount + 63) / 64, 0);
+        if (tagged) {
+            acceptRules.assign(stateCount, NO_RULE);
+        }
+        for (auto [state, rule] : accepts) {
+            acceptBits[state / 64] |= uint64_t{1} << (state % 64);
+            if (tagged && (acceptRules[state] == NO_RULE || rule < acceptRules[state])) {
+                acceptRules[state] = rule;
+            }
+        }
+    }
+
+    // Offsets of every state's row in a list sorted by state, with a final offset past the end
+    template<typename T>
+    [[nodiscard]] std::vector<uint32_t> rowStarts(const std::vector<std::pair<uint32_t, T>>& list) const {
+        std::vector<uint32_t> starts(stateCount + 1, 0);
+        for (const auto& entry : list) {
+            starts[entry.first + 1]++;
+        }
+        for (uint32_t state = 0; state < stateCount; ++state) {
+            starts[state + 1] += starts[state];
+        }
+        return starts;
+    }
+};
+
+
+#endif //SYPHON_FROZENNFA_H
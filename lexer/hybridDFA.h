@@ -0,0 +1,152 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_HYBRIDDFA_H
+#define SYPHON_HYBRIDDFA_H
+
+
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "automata.h"
+#include "constructionBudget.h"
+#include "frozenNFA.h"
+#include "stats.h"
+#include "subsetConstruction.h"
+
+// A DFA determinized as far as a ConstructionBudget allows, with the NFA simulated beyond. Construction is breadth
+// first, so the states near the start, which every scan passes through, are determinized first. States found once the
+// budget has run out are not expanded but kept as frontier states with their NFA state set, and a scan reaching one
+// continues by stepping NFA state sets, as LazyDFA does once its cache thrashes. Within budget there is no frontier
+// and the result is a complete, if unminimized, DFA.
+//
+// Matching reuses scratch sets, so a HybridDFA must not be shared between threads.
+class HybridDFA {
+public:
+    static constexpr size_t NO_MATCH = std::string_view::npos;
+
+    HybridDFA(const NFA& nfa, const ConstructionBudget& budget) : HybridDFA(FrozenNFA(nfa), budget) {}
+
+    HybridDFA(const FrozenNFA& nfa, const ConstructionBudget& budget)
+            : subsets(nfa), classCount(subsets.getClassCount()) {
+        Stats::PhaseTimer timer(&Stats::Construction::subsetConstruction);
+        BudgetMeter meter(budget);
+        if (subsets.empty()) {
+            report = meter.finish();
+            return;
+        }
+
+        std::unordered_map<std::vector<int>, int, StateSetHash> stateIndex;
+        std::vector<const std::vector<int>*> stateSets;  // In creation order, doubling as the BFS queue
+        auto internState = [&](std::vector<int>&& stateSet) {
+            auto [it, inserted] = stateIndex.try_emplace(std::move(stateSet), static_cast<int>(stateSets.size()));
+            if (inserted) {
+                meter.addState(it->first);
+                stateSets.push_back(&it->first);
+                accept.push_back(subsets.containsAccept(it->first));
+            }
+            return it->second;
+        };
+
+        internState(std::vector<int>(subsets.startSet()));
+        std::vector<std::vector<int>> successors(classCount);
+        size_t current = 0;
+        for (; current < stateSets.size() && meter.expand(); ++current) {
+            subsets.moveAll(*stateSets[current], successors);
+            transitions.resize(transitions.size() + classCount, DEAD);
+            for (int symbolClass = 0; symbolClass < classCount; ++symbolClass) {
+                if (successors[symbolClass].empty()) continue;
+                transitions[current * classCount + symbolClass] = internState(std::move(successors[symbolClass]));
+                successors[symbolClass].clear();
+            }
+            meter.addTransitions(classCount, sizeof(int));
+        }
+
+        expandedCount = current;
+        for (; current < stateSets.size(); ++current) {
+            frontierSets.push_back(*stateSets[current]);
+        }
+        report = meter.finish();
+    }
+
+    // Returns true if the whole input is accepted
+    bool match(std::string_view input) {
+        return scan(input, false) == input.size();
+    }
+
+    // Returns the length of the longest accepted prefix of the input, or NO_MATCH if no prefix is accepted
+    size_t longestPrefix(std::string_view input) {
+        return scan(input, true);
+    }
+
+    // True if the budget sufficed to determinize the whole NFA
+    [[nodiscard]] bool isComplete() const {
+        return frontierSets.empty();
+    }
+
+    // Number of determinized states
+    [[nodiscard]] size_t getStateCount() const {
+        return expandedCount;
+    }
+
+    // Number of states left to NFA simulation
+    [[nodiscard]] size_t getFrontierCount() const {
+        return frontierSets.size();
+    }
+
+    [[nodiscard]] const ConstructionReport& getReport() const {
+        return report;
+    }
+
+private:
+    static constexpr int DEAD = -1;
+
+    SubsetConstruction subsets;
+    int classCount;
+    size_t expandedCount = 0;
+    std::vector<int> transitions;              // Expanded states x classes. Targets past them are frontier states.
+    std::vector<bool> accept;                  // Of every state, frontier states included
+    std::vector<std::vector<int>> frontierSets;
+    ConstructionReport report;
+
+    std::vector<int> current;
+    std::vector<int> scratch;
+
+    // Scans the input from the start state. With longest set, returns the longest accepted prefix, otherwise
+    // returns input.size() if the whole input is accepted and NO_MATCH if not.
+    size_t scan(std::string_view input, bool longest) {
+        if (subsets.empty()) {
+            return NO_MATCH;
+        }
+
+        size_t state = 0;
+        size_t lastAccept = accept[state] ? 0 : NO_MATCH;
+        size_t i = 0;
+        for (; i < input.size() && state < expandedCount; ++i) {
+            int next = transitions[state * classCount + subsets.classOf(static_cast<unsigned char>(input[i]))];
+            if (next == DEAD) {
+                return longest ? lastAccept : NO_MATCH;
+            }
+            state = static_cast<size_t>(next);
+            if (accept[state]) {
+                lastAccept = i + 1;
+            }
+        }
+
+        if (state >= expandedCount) {
+            current = frontierSets[state - expandedCount];
+            for (; i < input.size() && !current.empty(); ++i) {
+                subsets.move(current, subsets.classOf(static_cast<unsigned char>(input[i])), scratch);
+                current.swap(scratch);
+                if (subsets.containsAccept(current)) {
+                    lastAccept = i + 1;
+                }
+            }
+        }
+        return longest || lastAccept == input.size() ? lastAccept : NO_MATCH;
+    }
+};
+
+
+#endif //SYPHON_HYBRIDDFA_H
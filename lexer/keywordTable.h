@@ -0,0 +1,177 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_KEYWORDTABLE_H
+#define SYPHON_KEYWORDTABLE_H
+
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// A fixed set of words with a token id each, looked up by a minimal perfect hash: every word has a slot of its own
+// among exactly as many slots as there are words, so a lookup hashes once, picks one slot and compares one word with
+// memcmp. The hash is built by hash and displace: words are hashed into buckets of about four, then, largest bucket
+// first, every bucket searches for a seed that places all its words in free slots.
+//
+// Lexer uses it to take keywords out of the DFA when an identifier rule matches them anyway, and classifies the
+// identifiers it matches by looking them up. CodeGenerator emits the same table and lookup.
+class KeywordTable {
+public:
+    static constexpr int NO_KEYWORD = -1;
+
+    struct Keyword {
+        std::string word;
+        int tokenId;
+    };
+
+    KeywordTable() = default;
+
+    // Duplicate words keep the token id they are given first
+    explicit KeywordTable(const std::vector<Keyword>& keywords) {
+        std::vector<const Keyword*> unique;
+        std::vector<uint64_t> hashes;
+        std::unordered_map<uint64_t, const Keyword*> byHash;
+        for (const auto& keyword : keywords) {
+            uint64_t hash = hashOf(keyword.word);
+            auto [it, inserted] = byHash.try_emplace(hash, &keyword);
+            if (!inserted) {
+                if (it->second->word == keyword.word) continue;
+                throw std::runtime_error("Invalid keyword table: '" + it->second->word + "' and '" + keyword.word +
+                                         "' hash the same");
+            }
+            unique.push_back(&keyword);
+            hashes.push_back(hash);
+        }
+        if (unique.empty()) return;
+
+        const size_t count = unique.size();
+        const size_t bucketCount = (count + 3) / 4;
+        std::vector<std::vector<size_t>> buckets(bucketCount);
+        for (size_t i = 0; i < count; ++i) {
+            buckets[hashes[i] % bucketCount].push_back(i);
+        }
+        std::vector<size_t> order(bucketCount);
+        for (size_t i = 0; i < bucketCount; ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&buckets](size_t a, size_t b) {
+            return buckets[a].size() > buckets[b].size();
+        });
+
+        seeds.assign(bucketCount, 0);
+        std::vector<size_t> slotOf(count, SIZE_MAX);  // Keyword in every slot
+        std::vector<size_t> placed;
+        for (size_t bucket : order) {
+            if (buckets[bucket].empty()) break;
+            for (uint32_t seed = 0;; ++seed) {
+                if (seed == UINT32_MAX) throw std::runtime_error("Invalid keyword table: no perfect hash found");
+                placed.clear();
+                for (size_t keyword : buckets[bucket]) {
+                    size_t slot = slotFor(hashes[keyword], seed, count);
+                    if (slotOf[slot] != SIZE_MAX) break;
+                    slotOf[slot] = keyword;
+                    placed.push_back(slot);
+                }
+                if (placed.size() == buckets[bucket].size()) {
+                    seeds[bucket] = seed;
+                    break;
+                }
+                for (size_t slot : placed) slotOf[slot] = SIZE_MAX;
+            }
+        }
+
+        minLength = SIZE_MAX;
+        offsets.push_back(0);
+        for (size_t slot = 0; slot < count; ++slot) {
+            const Keyword& keyword = *unique[slotOf[slot]];
+            text += keyword.word;
+            offsets.push_back(static_cast<uint32_t>(text.size()));
+            tokenIds.push_back(keyword.tokenId);
+            minLength = std::min(minLength, keyword.word.size());
+            maxLength = std::max(maxLength, keyword.word.size());
+        }
+    }
+
+    // The token id of the word, or NO_KEYWORD if it is not in the table
+    [[nodiscard]] int find(std::string_view word) const {
+        if (word.size() < minLength || word.size() > maxLength) return NO_KEYWORD;
+        uint64_t hash = hashOf(word);
+        size_t slot = slotFor(hash, seeds[hash % seeds.size()], tokenIds.size());
+        uint32_t begin = offsets[slot];
+        if (offsets[slot + 1] - begin != word.size() ||
+            std::memcmp(text.data() + begin, word.data(), word.size()) != 0) {
+            return NO_KEYWORD;
+        }
+        return tokenIds[slot];
+    }
+
+    [[nodiscard]] size_t size() const {
+        return tokenIds.size();
+    }
+
+    [[nodiscard]] bool empty() const {
+        return tokenIds.empty();
+    }
+
+    // The word in a slot, and its token id
+    [[nodiscard]] std::string_view getWord(size_t slot) const {
+        return std::string_view(text).substr(offsets[slot], offsets[slot + 1] - offsets[slot]);
+    }
+
+    [[nodiscard]] int getTokenId(size_t slot) const {
+        return tokenIds[slot];
+    }
+
+    // The seed of every bucket, a word's bucket being its hash modulo their count
+    [[nodiscard]] const std::vector<uint32_t>& getSeeds() const {
+        return seeds;
+    }
+
+    [[nodiscard]] size_t getMinLength() const {
+        return minLength;
+    }
+
+    [[nodiscard]] size_t getMaxLength() const {
+        return maxLength;
+    }
+
+    // Bytes of the words, their offsets, token ids and seeds
+    [[nodiscard]] size_t getMemoryUsage() const {
+        return text.size() + offsets.size() * sizeof(uint32_t) + tokenIds.size() * sizeof(int) +
+               seeds.size() * sizeof(uint32_t);
+    }
+
+    // FNV-1a over the word. CodeGenerator emits the same two functions.
+    [[nodiscard]] static uint64_t hashOf(std::string_view word) {
+        uint64_t hash = 0xcbf29ce484222325;
+        for (char c : word) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+        }
+        return hash;
+    }
+
+    // The slot of a word with the given hash under the seed of its bucket, by the splitmix64 finalizer
+    [[nodiscard]] static size_t slotFor(uint64_t hash, uint32_t seed, size_t slotCount) {
+        uint64_t mixed = hash + (static_cast<uint64_t>(seed) + 1) * 0x9e3779b97f4a7c15;
+        mixed = (mixed ^ (mixed >> 30)) * 0xbf58476d1ce4e5b9;
+        mixed = (mixed ^ (mixed >> 27)) * 0x94d049bb133111eb;
+        mixed ^= mixed >> 31;
+        return static_cast<size_t>(mixed % slotCount);
+    }
+
+private:
+    std::string text;               // The words in slot order
+    std::vector<uint32_t> offsets;  // Of every word in text, and of its end
+    std::vector<int> tokenIds;
+    std::vector<uint32_t> seeds;
+    size_t minLength = 1;
+    size_t maxLength = 0;           // Below minLength while empty, so every lookup fails early
+};
+
+
+#endif //SYPHON_KEYWORDTABLE_H
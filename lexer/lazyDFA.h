@@ -0,0 +1,196 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_LAZYDFA_H
+#define SYPHON_LAZYDFA_H
+
+
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "automata.h"
+#include "frozenNFA.h"
+#include "subsetConstruction.h"
+
+// A DFA that is determinized while it scans. Each DFA state is computed from the NFA the first time a scan needs it
+// and cached, up to a memory budget. When the budget runs out the whole cache is cleared and rebuilt from the
+// current state. If that happens again before enough input has been scanned to pay for the states built in between,
+// the cache is thrashing and the rest of the scan steps through NFA state sets directly.
+//
+// Matching mutates the cache, so a LazyDFA must not be shared between threads.
+class LazyDFA {
+public:
+    static constexpr size_t NO_MATCH = std::string_view::npos;
+    static constexpr size_t DEFAULT_CACHE_BUDGET = 1 << 20;
+
+    explicit LazyDFA(const NFA& nfa, size_t cacheBudget = DEFAULT_CACHE_BUDGET)
+            : subsets(nfa), classCount(subsets.getClassCount()), cacheBudget(cacheBudget) {}
+
+    explicit LazyDFA(const FrozenNFA& nfa, size_t cacheBudget = DEFAULT_CACHE_BUDGET)
+            : subsets(nfa), classCount(subsets.getClassCount()), cacheBudget(cacheBudget) {}
+
+    // Returns true if the whole input is accepted
+    bool match(std::string_view input) {
+        return scan(input, false) == input.size();
+    }
+
+    // Returns the length of the longest accepted prefix of the input, or NO_MATCH if no prefix is accepted
+    size_t longestPrefix(std::string_view input) {
+        return scan(input, true);
+    }
+
+    [[nodiscard]] size_t getCachedStateCount() const {
+        return states.size();
+    }
+
+    [[nodiscard]] size_t getCacheBytes() const {
+        return cacheBytes;
+    }
+
+    [[nodiscard]] size_t getCacheClears() const {
+        return cacheClears;
+    }
+
+    // Number of scans that gave up on the cache and finished by NFA simulation
+    [[nodiscard]] size_t getFallbackCount() const {
+        return fallbacks;
+    }
+
+private:
+    static constexpr int UNKNOWN = -2;
+    static constexpr int DEAD = -1;
+    static constexpr int FALLBACK = -3;
+    // Bytes that must be scanned per cached state between two clears for the cache to be worth keeping
+    static constexpr size_t MIN_BYTES_PER_STATE = 10;
+
+    struct CachedState {
+        const std::vector<int>* stateSet;
+        bool accept;
+    };
+
+    SubsetConstruction subsets;
+    int classCount;
+    size_t cacheBudget;
+
+    std::unordered_map<std::vector<int>, int, StateSetHash> stateIndex;
+    std::vector<CachedState> states;
+    std::vector<int> transitions;  // states x classes, UNKNOWN until computed
+    int startState = UNKNOWN;
+    size_t cacheBytes = 0;
+    size_t cacheClears = 0;
+    size_t fallbacks = 0;
+
+    // Position of the last cache clear within the current scan
+    size_t lastClear = NO_MATCH;
+    std::vector<int> scratch;
+    std::vector<int> fallbackSet;
+
+    // Scans the input from the start state. With longest set, returns the longest accepted prefix, otherwise
+    // returns input.size() if the whole input is accepted and NO_MATCH if not.
+    size_t scan(std::string_view input, bool longest) {
+        if (subsets.empty()) {
+            return NO_MATCH;
+        }
+        lastClear = NO_MATCH;
+        if (startState == UNKNOWN) {
+            startState = addState(subsets.startSet());
+        }
+
+        int state = startState;
+        size_t lastAccept = states[state].accept ? 0 : NO_MATCH;
+        for (size_t i = 0; i < input.size(); ++i) {
+            int symbolClass = subsets.classOf(static_cast<unsigned char>(input[i]));
+            int next = transitions[static_cast<size_t>(state) * classCount + symbolClass];
+            if (next == UNKNOWN) {
+                next = computeTransition(state, symbolClass, i);
+            }
+            if (next == DEAD) {
+                return longest ? lastAccept : NO_MATCH;
+            }
+            if (next == FALLBACK) {
+                fallbacks++;
+                return simulate(input, i + 1, longest, lastAccept);
+            }
+
+            state = next;
+            if (states[state].accept) {
+                lastAccept = i + 1;
+            }
+        }
+        return longest || lastAccept == input.size() ? lastAccept : NO_MATCH;
+    }
+
+    // Determinizes the transition of state on symbolClass, clearing the cache if it is full. Returns the target
+    // state, DEAD, or FALLBACK with the target set left in fallbackSet.
+    int computeTransition(int state, int symbolClass, size_t position) {
+        subsets.move(*states[state].stateSet, symbolClass, scratch);
+        if (scratch.empty()) {
+            return transitions[static_cast<size_t>(state) * classCount + symbolClass] = DEAD;
+        }
+
+        auto it = stateIndex.find(scratch);
+        if (it != stateIndex.end()) {
+            return transitions[static_cast<size_t>(state) * classCount + symbolClass] = it->second;
+        }
+
+        if (cacheBytes + stateCost(scratch) > cacheBudget) {
+            bool thrashing = lastClear != NO_MATCH && position - lastClear < MIN_BYTES_PER_STATE * states.size();
+            clearCache();
+            lastClear = position;
+            if (thrashing) {
+                fallbackSet.swap(scratch);
+                return FALLBACK;
+            }
+            // The source state is gone now, so the transition is not recorded
+            return addState(scratch);
+        }
+
+        int target = addState(scratch);
+        transitions[static_cast<size_t>(state) * classCount + symbolClass] = target;
+        return target;
+    }
+
+    // Continues a scan from fallbackSet at position by stepping NFA state sets, without caching anything
+    size_t simulate(std::string_view input, size_t position, bool longest, size_t lastAccept) {
+        if (subsets.containsAccept(fallbackSet)) {
+            lastAccept = position;
+        }
+        for (size_t i = position; i < input.size() && !fallbackSet.empty(); ++i) {
+            int symbolClass = subsets.classOf(static_cast<unsigned char>(input[i]));
+            subsets.move(fallbackSet, symbolClass, scratch);
+            fallbackSet.swap(scratch);
+            if (subsets.containsAccept(fallbackSet)) {
+                lastAccept = i + 1;
+            }
+        }
+        return longest || lastAccept == input.size() ? lastAccept : NO_MATCH;
+    }
+
+    [[nodiscard]] size_t stateCost(const std::vector<int>& stateSet) const {
+        // The set is stored once as the map key, plus the map node, the cached state and a row of transitions
+        return stateSet.size() * sizeof(int) + sizeof(std::vector<int>) + 4 * sizeof(void*) +
+               sizeof(CachedState) + classCount * sizeof(int);
+    }
+
+    int addState(const std::vector<int>& stateSet) {
+        int id = static_cast<int>(states.size());
+        auto it = stateIndex.emplace(stateSet, id).first;
+        states.push_back({&it->first, subsets.containsAccept(stateSet)});
+        transitions.resize(transitions.size() + classCount, UNKNOWN);
+        cacheBytes += stateCost(stateSet);
+        return id;
+    }
+
+    void clearCache() {
+        stateIndex.clear();
+        states.clear();
+        transitions.clear();
+        cacheBytes = 0;
+        startState = UNKNOWN;
+        cacheClears++;
+    }
+};
+
+
+#endif //SYPHON_LAZYDFA_H
@@ -0,0 +1,334 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_LEXER_H
+#define SYPHON_LEXER_H
+
+
+#include <algorithm>
+#include <cctype>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "automataTransformations.h"
+#include "compiledDFA.h"
+#include "dfaLayout.h"
+#include "dfaFile.h"
+#include "keywordTable.h"
+#include "parallelConstruction.h"
+#include "parallelScan.h"
+#include "regexToNFA.h"
+#include "taggedDFA.h"
+
+struct Token {
+    int tokenId;
+    size_t offset;
+    size_t length;
+
+    bool operator==(const Token& other) const = default;
+};
+
+// Compiles a token specification into one minimized DFA, with every accept state tagged by the rule it accepts for.
+// Input is split by maximal munch: the longest match wins, and among rules matching the same longest prefix the one
+// listed first wins.
+class Lexer {
+public:
+    static constexpr int INVALID_TOKEN = -1;
+
+    struct Rule {
+        int tokenId;
+        std::string regex;
+    };
+
+    // The DFA's transitions are stored in the given encoding, see CompiledDFA. Throws ConstructionBudgetExceeded if
+    // determinizing the rules outgrows the budget. With threadCount other than 1, the DFA is built by
+    // ParallelConstruction, which gives the same lexer.
+    //
+    // With keywordTable set, rules that are a word or an alternation of words, such as "(if|else|while)", are kept
+    // out of the DFA if a later rule, typically the identifier rule, matches all of their words. Their words go into a
+    // KeywordTable instead, and a token of such a later rule whose lexeme is a keyword gets the keyword's token id.
+    // Tokens come out the same, from a DFA that no longer has a path per keyword. The DFA's rules are then the rules
+    // left in it, in order.
+    explicit Lexer(const std::vector<Rule>& rules, CompiledDFA::Encoding encoding = CompiledDFA::Encoding::DENSE,
+                   const ConstructionBudget& budget = {}, unsigned threadCount = 1, bool keywordTable = false) {
+        if (rules.empty()) throw std::runtime_error("Invalid lexer: no rules");
+
+        std::vector<std::vector<std::string>> words(rules.size());
+        std::vector<bool> inDFA(rules.size(), true);
+        if (keywordTable) {
+            for (size_t i = 0; i < rules.size(); ++i) {
+                words[i] = keywordsOf(rules[i].regex);
+                inDFA[i] = words[i].empty();
+            }
+            if (std::none_of(inDFA.begin(), inDFA.end(), [](bool kept) { return kept; })) {
+                inDFA.assign(rules.size(), true);
+            }
+        }
+        std::vector<size_t> specRules = build(rules, inDFA, encoding, budget, threadCount);
+
+        if (keywordTable) {
+            // A rule with a word no rule in the DFA matches whole goes back into the DFA. That only adds matches, so
+            // the words of the other rules are still matched after the rebuild.
+            bool rebuild = false;
+            for (size_t i = 0; i < rules.size(); ++i) {
+                if (inDFA[i]) continue;
+                for (const auto& word : words[i]) {
+                    int rule;
+                    if (dfa.longestPrefix(word, rule) != word.size()) {
+                        inDFA[i] = true;
+                        rebuild = true;
+                        break;
+                    }
+                }
+            }
+            if (rebuild) specRules = build(rules, inDFA, encoding, budget, threadCount);
+
+            // A keyword is the token only where its rule comes before the rule the DFA matches it with. Where it comes
+            // after, maximal munch never picked it to begin with.
+            std::vector<KeywordTable::Keyword> found;
+            keywordCarriers.assign(tokenIds.size(), false);
+            for (size_t i = 0; i < rules.size(); ++i) {
+                if (inDFA[i]) continue;
+                for (const auto& word : words[i]) {
+                    int rule;
+                    (void) dfa.longestPrefix(word, rule);
+                    if (specRules[rule] < i) continue;
+                    found.push_back({word, rules[i].tokenId});
+                    keywordCarriers[rule] = true;
+                }
+            }
+            keywords = KeywordTable(found);
+        }
+
+        if (dfa.isAccept(dfa.getStartState())) {
+            const auto& emptyRule = rules[specRules[dfa.getAcceptRule(dfa.getStartState())]];
+            throw std::runtime_error("Invalid lexer rule: '" + emptyRule.regex + "' matches the empty string");
+        }
+    }
+
+    // A lexer over an already compiled DFA, with the token id of every rule the DFA accepts for
+    Lexer(CompiledDFA dfa, std::vector<int> tokenIds) : tokenIds(std::move(tokenIds)), dfa(std::move(dfa)) {}
+
+    // Maps a lexer written by save. Matching reads the tables straight from the mapped file.
+    static Lexer load(const std::string& path) {
+        std::vector<int> tokenIds;
+        CompiledDFA dfa = DFAFile::map(path, &tokenIds);
+        return {std::move(dfa), std::move(tokenIds)};
+    }
+
+    // Writes the DFA and token ids. DFA files have no room for a keyword table, so a lexer with one cannot be saved.
+    void save(const std::string& path) const {
+        if (!keywords.empty()) throw std::runtime_error("Invalid lexer: a keyword table cannot be saved to a DFA file");
+        DFAFile::write(path, dfa, tokenIds);
+    }
+
+    // Renumbers the states of the DFA in an order from DFALayout, such as DFALayout::byProfile of the visits while
+    // lexing a sample. Tokens come out the same.
+    void reorderStates(const std::vector<uint32_t>& order) {
+        dfa = dfa.renumbered(order);
+    }
+
+    // Calls onToken for every token in the input. Bytes no rule matches come out one at a time as INVALID_TOKEN.
+    template<typename F>
+    void forEachToken(std::string_view input, F&& onToken) const {
+        lexFrom(input, 0, input.size(), onToken);
+    }
+
+    // Calls onToken(token, captures) for every token, with the spans of the capture groups of the token's rule as
+    // offsets into the input. A TaggedDFA finds each token and its captures in the same scan. Needs a lexer built from
+    // rules with capture groups, and is not available to a loaded lexer.
+    template<typename F>
+    void forEachTokenWithCaptures(std::string_view input, F&& onToken) const {
+        if (!taggedDFA) throw std::runtime_error("Invalid lexer: no rule has capture groups");
+
+        std::vector<Capture> captures;
+        TaggedDFA::Registers registers;
+        for (size_t offset = 0; offset < input.size();) {
+            int rule;
+            size_t length = taggedDFA->longestPrefix(input.substr(offset), rule, captures, registers);
+            Token token = length == TaggedDFA::NO_MATCH ? Token{INVALID_TOKEN, offset, 1}
+                                                        : Token{getTokenId(rule, input.substr(offset, length)),
+                                                                offset, length};
+            for (auto& capture : captures) {
+                if (capture.offset != Capture::UNSET) capture.offset += offset;
+            }
+            onToken(token, captures);
+            offset += token.length;
+        }
+    }
+
+    [[nodiscard]] std::vector<Token> tokenize(std::string_view input) const {
+        std::vector<Token> tokens;
+        forEachToken(input, [&tokens](const Token& token) { tokens.push_back(token); });
+        return tokens;
+    }
+
+    // Tokenizes like tokenize, splitting the input into chunks lexed on separate threads. Every chunk after the first
+    // is lexed speculatively, as if a token started right at its beginning. The chunks are then stitched in order:
+    // where the real token stream enters a chunk, it is lexed sequentially until it reaches a token start the
+    // speculative stream also has. From there both streams are the same, so the rest of the chunk is taken as is.
+    [[nodiscard]] std::vector<Token> tokenizeParallel(std::string_view input, unsigned threadCount = 0,
+                                                      size_t minChunkSize = ParallelScan::DEFAULT_MIN_CHUNK_SIZE) const {
+        std::vector<size_t> bounds = ParallelScan::chunkBounds(input.size(), threadCount, minChunkSize);
+        const size_t chunkCount = bounds.size() - 1;
+
+        // Tokens starting within each chunk, and the offset after the last of them
+        std::vector<std::vector<Token>> chunkTokens(chunkCount);
+        std::vector<size_t> chunkEnds(chunkCount);
+        ParallelScan::forEachChunk(bounds, [&](size_t chunk) {
+            auto& tokens = chunkTokens[chunk];
+            chunkEnds[chunk] = lexFrom(input, bounds[chunk], bounds[chunk + 1],
+                                       [&tokens](const Token& token) { tokens.push_back(token); });
+        });
+
+        size_t speculatedCount = 0;
+        for (const auto& speculated : chunkTokens) {
+            speculatedCount += speculated.size();
+        }
+        std::vector<Token> tokens = std::move(chunkTokens[0]);
+        tokens.reserve(speculatedCount);
+        size_t offset = chunkEnds[0];
+        for (size_t chunk = 1; chunk < chunkCount; ++chunk) {
+            const auto& speculated = chunkTokens[chunk];
+            while (offset < bounds[chunk + 1]) {
+                auto it = std::lower_bound(speculated.begin(), speculated.end(), offset,
+                                           [](const Token& token, size_t at) { return token.offset < at; });
+                if (it != speculated.end() && it->offset == offset) {
+                    tokens.insert(tokens.end(), it, speculated.end());
+                    offset = chunkEnds[chunk];
+                    break;
+                }
+                tokens.push_back(nextToken(input, offset));
+                offset += tokens.back().length;
+            }
+        }
+        return tokens;
+    }
+    [[nodiscard]] const CompiledDFA& getDFA() const {
+        return dfa;
+    }
+
+    // The automaton forEachTokenWithCaptures runs on, or nullptr if no rule has capture groups
+    [[nodiscard]] const TaggedDFA* getTaggedDFA() const {
+        return taggedDFA ? &*taggedDFA : nullptr;
+    }
+
+    // The token id of every rule the DFA accepts for
+    [[nodiscard]] const std::vector<int>& getTokenIds() const {
+        return tokenIds;
+    }
+
+    // The token id of a rule the DFA accepts for. Without a keyword table, the DFA's rules are those of the
+    // specification.
+    [[nodiscard]] int getTokenId(int rule) const {
+        return tokenIds[rule];
+    }
+
+    // The token id of a token the DFA matched with the given rule, which is a keyword's if the lexeme is one
+    [[nodiscard]] int getTokenId(int rule, std::string_view lexeme) const {
+        if (!keywordCarriers.empty() && keywordCarriers[rule]) {
+            int keyword = keywords.find(lexeme);
+            if (keyword != KeywordTable::NO_KEYWORD) return keyword;
+        }
+        return tokenIds[rule];
+    }
+
+    // The keywords kept out of the DFA, empty unless the lexer was built with a keyword table
+    [[nodiscard]] const KeywordTable& getKeywordTable() const {
+        return keywords;
+    }
+
+    // True if tokens of the rule are looked up in the keyword table
+    [[nodiscard]] bool isKeywordCarrier(int rule) const {
+        return !keywordCarriers.empty() && keywordCarriers[rule];
+    }
+
+    // The names of a rule's capture groups, in the order forEachTokenWithCaptures reports them
+    [[nodiscard]] const std::vector<std::string>& getCaptureNames(int rule) const {
+        static const std::vector<std::string> none;
+        return taggedDFA ? taggedDFA->getCaptureNames(rule) : none;
+    }
+
+private:
+    std::vector<int> tokenIds;
+    CompiledDFA dfa;
+    std::optional<TaggedDFA> taggedDFA;  // Only if some rule has capture groups
+    KeywordTable keywords;
+    std::vector<bool> keywordCarriers;   // By DFA rule, empty without keywords
+
+    // Compiles the rules marked inDFA into the DFA. Returns the position in the specification of every rule of the DFA.
+    std::vector<size_t> build(const std::vector<Rule>& rules, const std::vector<bool>& inDFA,
+                              CompiledDFA::Encoding encoding, const ConstructionBudget& budget, unsigned threadCount) {
+        std::vector<std::string> regexes;
+        std::vector<size_t> specRules;
+        tokenIds.clear();
+        for (size_t i = 0; i < rules.size(); ++i) {
+            if (!inDFA[i]) continue;
+            regexes.push_back(rules[i].regex);
+            tokenIds.push_back(rules[i].tokenId);
+            specRules.push_back(i);
+        }
+
+        std::vector<std::vector<std::string>> captureNames;
+        FrozenNFA nfa = RegexToNFA::frozenFromRules(regexes, &captureNames);
+        DFA minimized = threadCount == 1
+                        ? AutomataTransformations::minimize_dfa(AutomataTransformations::nfa_to_dfa(nfa, budget))
+                        : ParallelConstruction::minimize_dfa(ParallelConstruction::nfa_to_dfa(nfa, threadCount, budget),
+                                                             threadCount);
+        dfa = CompiledDFA(minimized, encoding);
+        taggedDFA.reset();
+        if (std::any_of(captureNames.begin(), captureNames.end(), [](const auto& names) { return !names.empty(); })) {
+            taggedDFA.emplace(nfa, std::move(captureNames));
+        }
+        return specRules;
+    }
+
+    // The words of a rule that is a word or an alternation of words, optionally in parentheses, or none for any other
+    // rule. Words are made of letters, digits and underscores, which stand for themselves in a regex.
+    static std::vector<std::string> keywordsOf(std::string_view regex) {
+        if (regex.size() >= 2 && regex.front() == '(' && regex.back() == ')') {
+            regex = regex.substr(1, regex.size() - 2);
+        }
+        std::vector<std::string> words(1);
+        for (char c : regex) {
+            if (c == '|') {
+                if (words.back().empty()) return {};
+                words.emplace_back();
+            } else if (std::isalnum(static_cast<unsigned char>(c)) || c == '_') {
+                words.back() += c;
+            } else {
+                return {};
+            }
+        }
+        if (words.back().empty()) return {};
+        return words;
+    }
+
+    // The longest token at offset, or a single byte INVALID_TOKEN if no rule matches there
+    [[nodiscard]] Token nextToken(std::string_view input, size_t offset) const {
+        int rule;
+        size_t length = dfa.longestPrefix(input.substr(offset), rule);
+        if (length == CompiledDFA::NO_MATCH) {
+            return {INVALID_TOKEN, offset, 1};
+        }
+        return {getTokenId(rule, input.substr(offset, length)), offset, length};
+    }
+
+    // Lexes the tokens that start in [offset, limit), the last of which may run past limit. Returns the offset after
+    // the last token.
+    template<typename F>
+    size_t lexFrom(std::string_view input, size_t offset, size_t limit, F&& onToken) const {
+        while (offset < limit) {
+            Token token = nextToken(input, offset);
+            onToken(token);
+            offset += token.length;
+        }
+        return offset;
+    }
+};
+
+
+#endif //SYPHON_LEXER_H
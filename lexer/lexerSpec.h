@@ -0,0 +1,69 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_LEXERSPEC_H
+#define SYPHON_LEXERSPEC_H
+
+
+#include <fstream>
+#include <istream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "lexer.h"
+
+// A token specification as written in a spec file. Every non-empty line that does not start with '#' holds a token
+// name followed by whitespace and the regex for it, which runs to the end of the line less trailing whitespace:
+//
+//     IF      if
+//     IDENT   [a-z_][a-z0-9_]*
+//     SPACE   [ \t\n]+
+//
+// Rules are listed in priority order and numbered from 0, the number being the token id.
+struct LexerSpec {
+    std::vector<std::string> names;
+    std::vector<Lexer::Rule> rules;
+
+    static LexerSpec parse(std::istream& input) {
+        LexerSpec spec;
+        std::string line;
+        int lineNumber = 0;
+
+        while (std::getline(input, line)) {
+            lineNumber++;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+
+            size_t nameStart = line.find_first_not_of(" \t");
+            if (nameStart == std::string::npos || line[nameStart] == '#') continue;
+
+            size_t nameEnd = line.find_first_of(" \t", nameStart);
+            size_t regexStart = nameEnd == std::string::npos ? std::string::npos : line.find_first_not_of(" \t", nameEnd);
+            if (regexStart == std::string::npos) {
+                throw std::runtime_error("Invalid spec: line " + std::to_string(lineNumber) + " has no regex");
+            }
+            size_t regexEnd = line.find_last_not_of(" \t") + 1;
+
+            spec.names.push_back(line.substr(nameStart, nameEnd - nameStart));
+            spec.rules.push_back({static_cast<int>(spec.rules.size()), line.substr(regexStart, regexEnd - regexStart)});
+        }
+
+        if (spec.rules.empty()) throw std::runtime_error("Invalid spec: no rules");
+        return spec;
+    }
+
+    static LexerSpec fromFile(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) throw std::runtime_error("Cannot open " + path);
+        return parse(file);
+    }
+
+    static LexerSpec fromString(const std::string& text) {
+        std::istringstream input(text);
+        return parse(input);
+    }
+};
+
+
+#endif //SYPHON_LEXERSPEC_H
@@ -0,0 +1,135 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_LEXERSTREAM_H
+#define SYPHON_LEXERSTREAM_H
+
+
+#include <string>
+#include <string_view>
+#include "lexer.h"
+
+// A tokenizing session over input that arrives in chunks, such as a file read piece by piece or a socket. Tokens
+// come out exactly as Lexer::tokenize would produce them for the whole input, each as soon as it is final: once the
+// DFA dies past it, which may take bytes from later chunks. Between chunks the session keeps the DFA state and the
+// bytes of the token in progress, so its memory is bounded by the longest scan from a token start, not the input.
+//
+// The lexer must outlive the session.
+class LexerStream {
+public:
+    explicit LexerStream(const Lexer& lexer) : lexer(lexer), dfa(lexer.getDFA()), state(dfa.getStartState()) {}
+
+    // Scans the next chunk of input, calling onToken for every token that is final by its end
+    template<typename F>
+    void feed(std::string_view chunk, F&& onToken) {
+        scan(chunk, false, onToken);
+    }
+
+    // Ends the input, calling onToken for the tokens still in progress. The session can then be fed a new input.
+    template<typename F>
+    void finish(F&& onToken) {
+        scan({}, true, onToken);
+        offset = 0;
+    }
+
+    // Bytes held back for the token in progress
+    [[nodiscard]] size_t getPendingSize() const {
+        return pending.size();
+    }
+
+    // Offset in the input of the token in progress, which is where the next token starts
+    [[nodiscard]] size_t getOffset() const {
+        return offset;
+    }
+
+private:
+    static constexpr size_t NO_ACCEPT = std::string_view::npos;
+
+    const Lexer& lexer;
+    const CompiledDFA& dfa;
+
+    // The token in progress starts at offset, its bytes so far are pending, and the DFA is in state after scanning
+    // the first scanned of them
+    std::string pending;
+    size_t offset = 0;
+    size_t scanned = 0;
+    uint32_t state;
+    size_t lastAccept = NO_ACCEPT;
+    int lastRule = NO_RULE;
+    std::string spanning;  // A keyword candidate split between pending and the chunk
+
+    // Scans pending followed by chunk as one stretch of input. At the end of the input every token in progress is
+    // resolved, otherwise the bytes from the start of the token in progress are kept in pending.
+    template<typename F>
+    void scan(std::string_view chunk, bool atEnd, F&& onToken) {
+        const size_t pendingSize = pending.size();
+        const size_t total = pendingSize + chunk.size();
+        auto byteAt = [&](size_t i) {
+            return static_cast<unsigned char>(i < pendingSize ? pending[i] : chunk[i - pendingSize]);
+        };
+
+        size_t start = 0;
+        size_t position = scanned;
+        while (position < total || (atEnd && start < total)) {
+            if (position < total) {
+                state = dfa.getTransition(state, byteAt(position++));
+                if (state == CompiledDFA::DEAD_STATE) {
+                    start = emit(start, pendingSize, chunk, onToken);
+                    position = start;
+                } else if (dfa.isAccept(state)) {
+                    lastAccept = position - start;
+                    lastRule = dfa.getAcceptRule(state);
+                }
+            } else {
+                // The input ends inside a token, which is as far as its scan gets
+                start = emit(start, pendingSize, chunk, onToken);
+                position = start;
+            }
+        }
+
+        // Only the bytes of the chunk are new, so a long token fed in small chunks costs time linear in its length
+        if (start >= pendingSize) {
+            pending.assign(chunk.substr(start - pendingSize));
+        } else {
+            pending.erase(0, start);
+            pending.append(chunk);
+        }
+        scanned = position - start;
+    }
+
+    // Emits the token starting at start in the scanned stretch, and restarts the DFA after it. Returns where the next
+    // token starts.
+    template<typename F>
+    size_t emit(size_t start, size_t pendingSize, std::string_view chunk, F&& onToken) {
+        size_t length = lastAccept == NO_ACCEPT ? 1 : lastAccept;
+        int tokenId = Lexer::INVALID_TOKEN;
+        if (lastAccept != NO_ACCEPT) {
+            tokenId = lexer.isKeywordCarrier(lastRule)
+                      ? lexer.getTokenId(lastRule, lexeme(start, length, pendingSize, chunk))
+                      : lexer.getTokenId(lastRule);
+        }
+        onToken(Token{tokenId, offset, length});
+        offset += length;
+        state = dfa.getStartState();
+        lastAccept = NO_ACCEPT;
+        lastRule = NO_RULE;
+        return start + length;
+    }
+
+    // The bytes of a token in the scanned stretch, copied only if it spans pending and the chunk
+    std::string_view lexeme(size_t start, size_t length, size_t pendingSize, std::string_view chunk) {
+        if (start + length <= pendingSize) {
+            return std::string_view(pending).substr(start, length);
+        }
+        if (start >= pendingSize) {
+            return chunk.substr(start - pendingSize, length);
+        }
+        spanning.assign(pending, start, pendingSize - start);
+        spanning.append(chunk.substr(0, start + length - pendingSize));
+        return spanning;
+    }
+};
+
+
+#endif //SYPHON_LEXERSTREAM_H
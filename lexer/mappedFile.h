@@ -0,0 +1,94 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_MAPPEDFILE_H
+#define SYPHON_MAPPEDFILE_H
+
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A read-only memory mapping of a whole file, unmapped when the last reference goes away
+class MappedFile {
+public:
+    static std::shared_ptr<const MappedFile> open(const std::string& path) {
+        return std::shared_ptr<const MappedFile>(new MappedFile(path));
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+#else
+        if (data) munmap(const_cast<void*>(data), size);
+#endif
+    }
+
+    [[nodiscard]] const unsigned char* getData() const {
+        return static_cast<const unsigned char*>(data);
+    }
+
+    [[nodiscard]] size_t getSize() const {
+        return size;
+    }
+
+private:
+    const void* data = nullptr;
+    size_t size = 0;
+
+    explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Cannot open " + path);
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            CloseHandle(file);
+            throw std::runtime_error("Cannot read the size of " + path);
+        }
+        size = static_cast<size_t>(fileSize.QuadPart);
+        if (size > 0) {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) {
+                data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+#else
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0) throw std::runtime_error("Cannot open " + path);
+        struct stat info{};
+        if (fstat(file, &info) != 0) {
+            ::close(file);
+            throw std::runtime_error("Cannot read the size of " + path);
+        }
+        size = static_cast<size_t>(info.st_size);
+        if (size > 0) {
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+            data = mapped == MAP_FAILED ? nullptr : mapped;
+        }
+        ::close(file);
+#endif
+        if (size > 0 && !data) throw std::runtime_error("Cannot map " + path);
+    }
+};
+
+
+#endif //SYPHON_MAPPEDFILE_H
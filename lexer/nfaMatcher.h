@@ -0,0 +1,62 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_NFAMATCHER_H
+#define SYPHON_NFAMATCHER_H
+
+
+#include <string_view>
+#include <utility>
+#include "automata.h"
+#include "bitParallelNFA.h"
+#include "frozenNFA.h"
+#include "pikeVM.h"
+
+// Matches with the NFA itself, for patterns whose DFA would be too large to build. Small NFAs run bit-parallel, the
+// rest on a Pike VM. Either way a scan takes O(n * m) time for n input bytes and an NFA of size m, and does not
+// allocate.
+//
+// The Pike VM reuses its thread lists, so an NFAMatcher must not be shared between threads.
+class NFAMatcher {
+public:
+    static constexpr size_t NO_MATCH = std::string_view::npos;
+
+    enum class Engine {
+        BIT_PARALLEL,
+        PIKE_VM,
+    };
+
+    explicit NFAMatcher(const NFA& nfa) : NFAMatcher(FrozenNFA(nfa)) {}
+
+    explicit NFAMatcher(FrozenNFA nfa)
+            : engine(BitParallelNFA::fits(nfa) ? Engine::BIT_PARALLEL : Engine::PIKE_VM) {
+        if (engine == Engine::BIT_PARALLEL) {
+            bitParallel = BitParallelNFA(nfa);
+        } else {
+            pikeVM = PikeVM(std::move(nfa));
+        }
+    }
+
+    // Returns true if the whole input is accepted
+    bool match(std::string_view input) {
+        return engine == Engine::BIT_PARALLEL ? bitParallel.match(input) : pikeVM.match(input);
+    }
+
+    // Returns the length of the longest accepted prefix of the input, or NO_MATCH if no prefix is accepted
+    size_t longestPrefix(std::string_view input) {
+        return engine == Engine::BIT_PARALLEL ? bitParallel.longestPrefix(input) : pikeVM.longestPrefix(input);
+    }
+
+    [[nodiscard]] Engine getEngine() const {
+        return engine;
+    }
+
+private:
+    Engine engine;
+    BitParallelNFA bitParallel;
+    PikeVM pikeVM;
+};
+
+
+#endif //SYPHON_NFAMATCHER_H
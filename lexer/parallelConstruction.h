@@ -0,0 +1,490 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_PARALLELCONSTRUCTION_H
+#define SYPHON_PARALLELCONSTRUCTION_H
+
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <climits>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "automata.h"
+#include "byteClasses.h"
+#include "constructionBudget.h"
+#include "frozenNFA.h"
+#include "stats.h"
+#include "subsetConstruction.h"
+
+// Subset construction and minimization on several threads, for the large rule sets where construction time adds up.
+// Both give the same DFA whatever the thread count. With threadCount 0, they use one thread per hardware thread.
+//
+// nfa_to_dfa expands the DFA level by level. The states of a level are handed out to the threads in batches, and the
+// state sets they reach are interned in a table split into shards with a lock each, so threads rarely wait on each
+// other. New states get provisional ids in the order threads happen to find them, so once the DFA is complete its
+// states are renumbered in breadth-first order, which gives exactly the DFA AutomataTransformations::nfa_to_dfa builds.
+//
+// minimize_dfa refines the partition in rounds, as Moore's algorithm does: every round splits each block by the
+// blocks its states move to, and blocks split independently of each other, so each thread takes its share of the
+// blocks. It takes a round per letter of the longest word needed to tell two states apart, where Hopcroft's algorithm
+// in AutomataTransformations::minimize_dfa takes O(n log n) steps, so DFAs with long chains of states are better
+// minimized on one thread. The result is minimize_dfa's, with the states numbered in breadth-first order.
+class ParallelConstruction {
+public:
+    static DFA nfa_to_dfa(const FrozenNFA& nfa, unsigned threadCount = 0, const ConstructionBudget& budget = {}) {
+        Stats::PhaseTimer timer(&Stats::Construction::subsetConstruction);
+        DFA dfa;
+        if (nfa.empty()) {
+            return dfa;
+        }
+
+        SubsetConstruction subsets(nfa);
+        const int classCount = subsets.getClassCount();
+        StateSetTable table;
+        BudgetMeter meter(budget);
+
+        // By provisional id: the state set, its rule and its row of targets, filled in as the state is expanded
+        std::vector<const std::vector<int>*> stateSets = {&table.intern(std::vector<int>(subsets.startSet())).first->first};
+        std::vector<int> rules = {subsets.ruleOf(subsets.startSet())};
+        std::vector<int> rows(classCount, -1);
+        meter.addState(subsets.startSet());
+
+        struct Found {
+            int id;
+            const std::vector<int>* stateSet;
+            int rule;
+        };
+        struct Worker {
+            std::vector<std::vector<int>> successors;
+            std::vector<Found> found;
+        };
+        threadCount = resolveThreadCount(threadCount);
+        std::vector<Worker> workers(threadCount, {std::vector<std::vector<int>>(classCount), {}});
+        std::vector<int> level = {0};
+        std::atomic<size_t> nextInLevel{0};
+        std::atomic<int> nextId{1};
+
+        // The meter is shared by the threads, so every thread stops within a state of the budget running out
+        auto expandLevel = [&](unsigned thread) {
+            Worker& worker = workers[thread];
+            for (size_t begin; (begin = nextInLevel.fetch_add(BATCH_SIZE)) < level.size();) {
+                for (size_t i = begin; i < std::min(begin + BATCH_SIZE, level.size()); ++i) {
+                    if (!meter.expand()) {
+                        return;
+                    }
+                    int state = level[i];
+                    subsets.moveAll(*stateSets[state], worker.successors);
+                    for (int symbolClass = 0; symbolClass < classCount; ++symbolClass) {
+                        auto& successor = worker.successors[symbolClass];
+                        if (successor.empty()) continue;
+                        auto [stateSet, inserted] = table.intern(std::move(successor), &nextId);
+                        if (inserted) {
+                            worker.found.push_back({stateSet->second, &stateSet->first, subsets.ruleOf(stateSet->first)});
+                            meter.addState(stateSet->first);
+                        }
+                        rows[static_cast<size_t>(state) * classCount + symbolClass] = stateSet->second;
+                        successor.clear();
+                    }
+                    meter.addTransitions(classCount, sizeof(int));
+                }
+            }
+        };
+
+        // Collects the states found into the next level, which is empty once the DFA is complete or over budget
+        auto nextLevel = [&]() {
+            if (meter.isExceeded()) {
+                return false;
+            }
+            size_t levelStart = stateSets.size();
+            auto stateCount = static_cast<size_t>(nextId.load());
+            stateSets.resize(stateCount);
+            rules.resize(stateCount);
+            rows.resize(stateCount * classCount, -1);
+            for (auto& worker : workers) {
+                for (const auto& found : worker.found) {
+                    stateSets[found.id] = found.stateSet;
+                    rules[found.id] = found.rule;
+                }
+                worker.found.clear();
+            }
+
+            level.clear();
+            for (size_t state = levelStart; state < stateCount; ++state) {
+                level.push_back(static_cast<int>(state));
+            }
+            nextInLevel = 0;
+            return !level.empty();
+        };
+
+        runRounds(threadCount, expandLevel, nextLevel);
+        if (meter.isExceeded()) {
+            throw ConstructionBudgetExceeded(meter.finish());
+        }
+
+        // Renumber breadth first, taking the targets of a state in class order, as the sequential construction
+        // numbers its states
+        std::vector<int> order = {0};
+        std::vector<int> canonical(stateSets.size(), -1);
+        canonical[0] = 0;
+        for (size_t index = 0; index < order.size(); ++index) {
+            for (int symbolClass = 0; symbolClass < classCount; ++symbolClass) {
+                int target = rows[static_cast<size_t>(order[index]) * classCount + symbolClass];
+                if (target >= 0 && canonical[target] < 0) {
+                    canonical[target] = static_cast<int>(order.size());
+                    order.push_back(target);
+                }
+            }
+        }
+
+        const bool tagged = nfa.hasAcceptRules();
+        for (int index = 0; index < static_cast<int>(order.size()); ++index) {
+            int rule = rules[order[index]];
+            if (tagged && rule != NO_RULE) {
+                dfa.setAcceptRule(index, rule);
+            } else {
+                dfa.addState(index, rule != NO_RULE);
+            }
+        }
+        dfa.setStartState(0);
+        for (int index = 0; index < static_cast<int>(order.size()); ++index) {
+            const int* row = rows.data() + static_cast<size_t>(order[index]) * classCount;
+            for (int symbol = CHAR_MIN; symbol <= CHAR_MAX; ++symbol) {
+                int target = row[subsets.classOf(static_cast<unsigned char>(symbol))];
+                if (target >= 0) {
+                    dfa.addTransition(index, static_cast<char>(symbol), canonical[target]);
+                }
+            }
+        }
+
+        Stats::set(&Stats::Construction::dfaStates, order.size());
+        return dfa;
+    }
+
+    static DFA nfa_to_dfa(const NFA& nfa, unsigned threadCount = 0, const ConstructionBudget& budget = {}) {
+        return nfa_to_dfa(FrozenNFA(nfa), threadCount, budget);
+    }
+
+    static DFA minimize_dfa(const DFA& originalDfa, unsigned threadCount = 0) {
+        Stats::PhaseTimer timer(&Stats::Construction::minimization);
+        if (originalDfa.getStates().empty()) {
+            return {};
+        }
+
+        // Number the states densely, with one column per byte class and a sink for the missing transitions
+        ByteClasses byteClasses = ByteClasses::fromDFA(originalDfa);
+        const int classCount = byteClasses.getClassCount();
+        std::vector<int> originalStates(originalDfa.getStates().begin(), originalDfa.getStates().end());
+        const int originalSink = static_cast<int>(originalStates.size());
+        std::vector<int> originalDelta(static_cast<size_t>(originalSink + 1) * classCount, originalSink);
+        int from = 0;
+        for (const auto& [key, toState] : originalDfa.getTransitionTable()) {
+            while (originalStates[from] != key.first) from++;
+            auto to = std::lower_bound(originalStates.begin(), originalStates.end(), toState) - originalStates.begin();
+            originalDelta[static_cast<size_t>(from) * classCount + byteClasses.classOf(static_cast<unsigned char>(key.second))] =
+                    static_cast<int>(to);
+        }
+
+        // Keep the reachable states only, in breadth-first order from the start, and the sink after them
+        std::vector<int> reachable = {static_cast<int>(std::lower_bound(originalStates.begin(), originalStates.end(),
+                                                                        originalDfa.getStartState()) -
+                                                       originalStates.begin())};
+        std::vector<int> indexOf(originalSink + 1, -1);
+        indexOf[reachable[0]] = 0;
+        for (size_t i = 0; i < reachable.size(); ++i) {
+            for (int symbolClass = 0; symbolClass < classCount; ++symbolClass) {
+                int target = originalDelta[static_cast<size_t>(reachable[i]) * classCount + symbolClass];
+                if (target != originalSink && indexOf[target] < 0) {
+                    indexOf[target] = static_cast<int>(reachable.size());
+                    reachable.push_back(target);
+                }
+            }
+        }
+        const int sink = static_cast<int>(reachable.size());
+        const int stateCount = sink + 1;
+        indexOf[originalSink] = sink;
+        std::vector<int> delta(static_cast<size_t>(stateCount) * classCount, sink);
+        for (int state = 0; state < sink; ++state) {
+            for (int symbolClass = 0; symbolClass < classCount; ++symbolClass) {
+                delta[static_cast<size_t>(state) * classCount + symbolClass] =
+                        indexOf[originalDelta[static_cast<size_t>(reachable[state]) * classCount + symbolClass]];
+            }
+        }
+
+        // Start with one block per accept rule and one for the non-accept states
+        std::vector<int> blockOf(stateCount);
+        {
+            std::map<int, int> blockOfRule;
+            std::vector<int> ruleOf(stateCount, NO_RULE);
+            for (int state = 0; state < sink; ++state) {
+                ruleOf[state] = originalDfa.getAcceptRule(originalStates[reachable[state]]);
+            }
+            for (int state = 0; state < stateCount; ++state) {
+                blockOfRule.emplace(ruleOf[state], 0);
+            }
+            int block = 0;
+            for (auto& entry : blockOfRule) {
+                entry.second = block++;
+            }
+            for (int state = 0; state < stateCount; ++state) {
+                blockOf[state] = blockOfRule[ruleOf[state]];
+            }
+        }
+
+        // Every round splits each block into sub-blocks of states whose transitions lead to the same blocks. A block
+        // splits on its own, so the threads take blocks in batches. Sub-blocks are numbered by the hash of what sets
+        // them apart, which does not depend on the thread, and the new block ids follow the old ones.
+        std::vector<int> members(stateCount), blockStart, subBlockOf(stateCount), subBlockCount;
+        auto groupByBlock = [&](int blockCount) {
+            blockStart.assign(blockCount + 1, 0);
+            for (int state = 0; state < stateCount; ++state) {
+                blockStart[blockOf[state] + 1]++;
+            }
+            for (int block = 0; block < blockCount; ++block) {
+                blockStart[block + 1] += blockStart[block];
+            }
+            std::vector<int> fill(blockStart.begin(), blockStart.end() - 1);
+            for (int state = 0; state < stateCount; ++state) {
+                members[fill[blockOf[state]]++] = state;
+            }
+            subBlockCount.assign(blockCount, 1);
+        };
+        auto sameTargets = [&](int a, int b) {
+            for (int symbolClass = 0; symbolClass < classCount; ++symbolClass) {
+                if (blockOf[delta[static_cast<size_t>(a) * classCount + symbolClass]] !=
+                    blockOf[delta[static_cast<size_t>(b) * classCount + symbolClass]]) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        int blockCount = *std::max_element(blockOf.begin(), blockOf.end()) + 1;
+        groupByBlock(blockCount);
+        threadCount = resolveThreadCount(threadCount);
+        std::vector<std::vector<std::pair<uint64_t, int>>> scratch(threadCount);
+        std::vector<std::vector<int>> representatives(threadCount);
+        std::atomic<size_t> nextBlock{0};
+        size_t rounds = 0;
+
+        auto splitBlocks = [&](unsigned thread) {
+            auto& hashed = scratch[thread];
+            auto& subBlocks = representatives[thread];
+            for (size_t begin; (begin = nextBlock.fetch_add(BATCH_SIZE)) < static_cast<size_t>(blockCount);) {
+                for (int block = static_cast<int>(begin); block < std::min<int>(static_cast<int>(begin + BATCH_SIZE), blockCount); ++block) {
+                    if (blockStart[block + 1] - blockStart[block] == 1) {
+                        subBlockOf[members[blockStart[block]]] = 0;
+                        continue;
+                    }
+                    hashed.clear();
+                    for (int i = blockStart[block]; i < blockStart[block + 1]; ++i) {
+                        int state = members[i];
+                        uint64_t hash = 1469598103934665603ull;
+                        for (int symbolClass = 0; symbolClass < classCount; ++symbolClass) {
+                            hash ^= static_cast<uint32_t>(blockOf[delta[static_cast<size_t>(state) * classCount + symbolClass]]);
+                            hash *= 1099511628211ull;
+                        }
+                        hashed.emplace_back(hash, state);
+                    }
+                    std::sort(hashed.begin(), hashed.end());
+
+                    // States with the same targets have the same hash, so each sub-block is found within a run of
+                    // equal hashes
+                    subBlocks.clear();
+                    size_t runStart = 0;
+                    for (size_t i = 0; i < hashed.size(); ++i) {
+                        if (hashed[i].first != hashed[runStart].first) runStart = i;
+                        int state = hashed[i].second;
+                        int subBlock = -1;
+                        for (size_t j = runStart; j < i && subBlock < 0; ++j) {
+                            if (sameTargets(state, hashed[j].second)) subBlock = subBlockOf[hashed[j].second];
+                        }
+                        if (subBlock < 0) {
+                            subBlock = static_cast<int>(subBlocks.size());
+                            subBlocks.push_back(state);
+                        }
+                        subBlockOf[state] = subBlock;
+                    }
+                    subBlockCount[block] = static_cast<int>(subBlocks.size());
+                }
+            }
+        };
+
+        // Numbers the sub-blocks as the blocks of the next round, if any block split
+        auto nextRound = [&]() {
+            rounds++;
+            std::vector<int> firstId(blockCount + 1, 0);
+            for (int block = 0; block < blockCount; ++block) {
+                firstId[block + 1] = firstId[block] + subBlockCount[block];
+            }
+            if (firstId[blockCount] == blockCount) {
+                return false;
+            }
+            for (int state = 0; state < stateCount; ++state) {
+                blockOf[state] = firstId[blockOf[state]] + subBlockOf[state];
+            }
+            blockCount = firstId[blockCount];
+            groupByBlock(blockCount);
+            nextBlock = 0;
+            return true;
+        };
+
+        runRounds(threadCount, splitBlocks, nextRound);
+        Stats::add(&Stats::Construction::refinementIterations, rounds);
+
+        // Number the blocks in the order their first states were reached, leaving out the block of the sink, and
+        // take the transitions of that first state
+        DFA minimizedDfa;
+        for (char symbol : originalDfa.getAlphabet()) {
+            minimizedDfa.addSymbol(symbol);
+        }
+        const int sinkBlock = blockOf[sink];
+        if (blockOf[0] == sinkBlock) {
+            // The DFA accepts nothing, keep a lone start state
+            minimizedDfa.addState(0, false);
+            minimizedDfa.setStartState(0);
+            Stats::set(&Stats::Construction::minimizedStates, 1);
+            return minimizedDfa;
+        }
+
+        std::vector<int> newState(blockCount, -1);
+        std::vector<int> representativeStates;
+        for (int state = 0; state < sink; ++state) {
+            if (blockOf[state] != sinkBlock && newState[blockOf[state]] < 0) {
+                newState[blockOf[state]] = static_cast<int>(representativeStates.size());
+                representativeStates.push_back(state);
+            }
+        }
+        for (int index = 0; index < static_cast<int>(representativeStates.size()); ++index) {
+            int representative = originalStates[reachable[representativeStates[index]]];
+            if (originalDfa.getAcceptRules().find(representative) != originalDfa.getAcceptRules().end()) {
+                minimizedDfa.setAcceptRule(index, originalDfa.getAcceptRule(representative));
+            } else {
+                minimizedDfa.addState(index, originalDfa.getAcceptState().find(representative) !=
+                                             originalDfa.getAcceptState().end());
+            }
+        }
+        minimizedDfa.setStartState(0);
+        for (int index = 0; index < static_cast<int>(representativeStates.size()); ++index) {
+            const int* row = delta.data() + static_cast<size_t>(representativeStates[index]) * classCount;
+            for (int symbol = CHAR_MIN; symbol <= CHAR_MAX; ++symbol) {
+                int targetBlock = blockOf[row[byteClasses.classOf(static_cast<unsigned char>(symbol))]];
+                if (targetBlock != sinkBlock) {
+                    minimizedDfa.addTransition(index, static_cast<char>(symbol), newState[targetBlock]);
+                }
+            }
+        }
+
+        Stats::set(&Stats::Construction::minimizedStates, representativeStates.size());
+        return minimizedDfa;
+    }
+
+private:
+    // States or blocks a thread takes at a time
+    static constexpr size_t BATCH_SIZE = 16;
+    static constexpr int SHARD_BITS = 6;
+
+    // Interns state sets under a lock per shard. Map nodes do not move, so the sets can be pointed to.
+    class StateSetTable {
+    public:
+        using Map = std::unordered_map<std::vector<int>, int, StateSetHash>;
+
+        // The entry of a state set, and whether it was new, in which case it takes the next id
+        std::pair<const Map::value_type*, bool> intern(std::vector<int>&& stateSet, std::atomic<int>* nextId = nullptr) {
+            Shard& shard = shards[(StateSetHash()(stateSet) * 0x9E3779B97F4A7C15ull) >> (64 - SHARD_BITS)];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto [it, inserted] = shard.map.try_emplace(std::move(stateSet), 0);
+            if (inserted && nextId) {
+                it->second = nextId->fetch_add(1);
+            }
+            return {&*it, inserted};
+        }
+
+    private:
+        struct Shard {
+            std::mutex mutex;
+            Map map;
+        };
+
+        std::array<Shard, 1 << SHARD_BITS> shards;
+    };
+
+    static unsigned resolveThreadCount(unsigned threadCount) {
+        return threadCount == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threadCount;
+    }
+
+    // Runs work(thread) on threadCount threads, the calling thread being thread 0, round after round. Once every
+    // thread is done with a round, next runs on one of them, and returns whether there is another round.
+    //
+    // If work or next throws, or a thread fails to start, the threads skip their work until the round ends, no other
+    // round starts, and the first exception is rethrown once all threads are joined.
+    template<typename Work, typename Next>
+    static void runRounds(unsigned threadCount, Work& work, Next& next) {
+        // One per thread, and the last for next and for starting the threads
+        std::vector<std::exception_ptr> errors(threadCount + 1);
+        std::atomic<bool> failed{false};
+        bool done = false;
+        std::barrier sync(static_cast<std::ptrdiff_t>(threadCount), [&]() noexcept {
+            try {
+                done = failed || !next();
+            } catch (...) {
+                errors.back() = std::current_exception();
+                done = true;
+            }
+        });
+        auto run = [&](unsigned thread) {
+            while (!done) {
+                if (!failed) {
+                    try {
+                        work(thread);
+                    } catch (...) {
+                        errors[thread] = std::current_exception();
+                        failed = true;
+                    }
+                }
+                sync.arrive_and_wait();
+            }
+        };
+
+        {
+            JoiningThreads workers;
+            try {
+                for (unsigned thread = 1; thread < threadCount; ++thread) {
+                    workers.threads.emplace_back(run, thread);
+                }
+            } catch (...) {
+                // The threads that did not start leave the barrier, so the ones that did see the round end
+                errors.back() = std::current_exception();
+                failed = true;
+                for (size_t thread = workers.threads.size() + 1; thread < threadCount; ++thread) {
+                    sync.arrive_and_drop();
+                }
+            }
+            run(0);
+        }
+        for (const auto& error : errors) {
+            if (error) std::rethrow_exception(error);
+        }
+    }
+
+    // Joins its threads when it goes out of scope
+    struct JoiningThreads {
+        std::vector<std::thread> threads;
+
+        ~JoiningThreads() {
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+    };
+};
+
+
+#endif //SYPHON_PARALLELCONSTRUCTION_H
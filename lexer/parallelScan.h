@@ -0,0 +1,151 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_PARALLELSCAN_H
+#define SYPHON_PARALLELSCAN_H
+
+
+#include <algorithm>
+#include <exception>
+#include <numeric>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "compiledDFA.h"
+
+// Runs a compiled DFA over large inputs on several threads. The input is split into chunks and every chunk is run
+// from all start states at once, which gives a mapping from the state the chunk is entered in to the state it is left
+// in. Runs from different start states soon end up in the same state, and are merged as they do, so the work per
+// chunk is usually not much more than a single run. Composing the mappings chunk by chunk then gives the state the
+// DFA ends in, as if the input had been scanned in one go.
+class ParallelScan {
+public:
+    static constexpr size_t DEFAULT_MIN_CHUNK_SIZE = 1 << 16;
+
+    // Returns true if the whole input is accepted. With threadCount 0, uses one thread per hardware thread.
+    static bool match(const CompiledDFA& dfa, std::string_view input, unsigned threadCount = 0,
+                      size_t minChunkSize = DEFAULT_MIN_CHUNK_SIZE) {
+        std::vector<size_t> bounds = chunkBounds(input.size(), threadCount, minChunkSize);
+        std::vector<std::vector<uint32_t>> mappings(bounds.size() - 1);
+        forEachChunk(bounds, [&](size_t chunk) {
+            mappings[chunk] = stateMapping(dfa, input.substr(bounds[chunk], bounds[chunk + 1] - bounds[chunk]));
+        });
+
+        uint32_t state = dfa.getStartState();
+        for (const auto& mapping : mappings) {
+            state = mapping[state];
+        }
+        return dfa.isAccept(state);
+    }
+
+    // For every state, the state the DFA is in after scanning the input from it
+    static std::vector<uint32_t> stateMapping(const CompiledDFA& dfa, std::string_view input) {
+        // Every start state points at a slot, and slots hold the distinct states the runs are in
+        const size_t stateCount = dfa.getStateCount();
+        std::vector<uint32_t> slots(stateCount);
+        std::iota(slots.begin(), slots.end(), 0);
+        std::vector<uint32_t> slotOf = slots;
+        std::vector<uint32_t> mergedSlot(stateCount, NO_SLOT);
+        std::vector<uint32_t> remap(stateCount);
+
+        for (size_t position = 0; position < input.size();) {
+            size_t end = slots.size() == 1 ? input.size() : std::min(input.size(), position + MERGE_INTERVAL);
+            for (uint32_t& state : slots) {
+                for (size_t i = position; i < end; ++i) {
+                    state = dfa.getTransition(state, static_cast<unsigned char>(input[i]));
+                }
+            }
+            position = end;
+
+            // Merge the slots whose runs have reached the same state
+            size_t merged = 0;
+            for (size_t slot = 0; slot < slots.size(); ++slot) {
+                uint32_t state = slots[slot];
+                if (mergedSlot[state] == NO_SLOT) {
+                    mergedSlot[state] = static_cast<uint32_t>(merged);
+                    slots[merged++] = state;
+                }
+                remap[slot] = mergedSlot[state];
+            }
+            if (merged < slots.size()) {
+                for (uint32_t& slot : slotOf) {
+                    slot = remap[slot];
+                }
+            }
+            slots.resize(merged);
+            for (uint32_t state : slots) {
+                mergedSlot[state] = NO_SLOT;
+            }
+        }
+
+        std::vector<uint32_t> mapping(stateCount);
+        for (size_t state = 0; state < stateCount; ++state) {
+            mapping[state] = slots[slotOf[state]];
+        }
+        return mapping;
+    }
+
+    // Splits [0, size) into at most threadCount chunks of at least minChunkSize bytes. Returns the chunk boundaries,
+    // starting at 0 and ending at size.
+    static std::vector<size_t> chunkBounds(size_t size, unsigned threadCount, size_t minChunkSize) {
+        if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+        size_t chunkCount = std::clamp<size_t>(size / std::max<size_t>(minChunkSize, 1), 1, threadCount);
+
+        std::vector<size_t> bounds(chunkCount + 1);
+        for (size_t chunk = 0; chunk <= chunkCount; ++chunk) {
+            bounds[chunk] = size * chunk / chunkCount;
+        }
+        return bounds;
+    }
+
+    // Calls work(chunk) for every chunk, each on its own thread, with the first chunk on the calling thread. Every
+    // thread is joined before this returns; an exception from work, or from starting a thread, is then rethrown, the
+    // one of the first chunk if several threw.
+    template<typename F>
+    static void forEachChunk(const std::vector<size_t>& bounds, F&& work) {
+        // One per chunk, and the last for starting the threads
+        std::vector<std::exception_ptr> errors(bounds.size());
+        auto run = [&work, &errors](size_t chunk) {
+            try {
+                work(chunk);
+            } catch (...) {
+                errors[chunk] = std::current_exception();
+            }
+        };
+
+        {
+            JoiningThreads workers;
+            try {
+                for (size_t chunk = 1; chunk + 1 < bounds.size(); ++chunk) {
+                    workers.threads.emplace_back(run, chunk);
+                }
+            } catch (...) {
+                errors.back() = std::current_exception();
+            }
+            if (!errors.back()) run(0);
+        }
+        for (const auto& error : errors) {
+            if (error) std::rethrow_exception(error);
+        }
+    }
+
+private:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+    // Bytes scanned between two merges of the runs
+    static constexpr size_t MERGE_INTERVAL = 64;
+
+    // Threads joined when they go out of scope, however that happens
+    struct JoiningThreads {
+        std::vector<std::thread> threads;
+
+        ~JoiningThreads() {
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+    };
+};
+
+
+#endif //SYPHON_PARALLELSCAN_H
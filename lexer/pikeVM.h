@@ -0,0 +1,146 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_PIKEVM_H
+#define SYPHON_PIKEVM_H
+
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "automata.h"
+#include "frozenNFA.h"
+
+// Simulates an NFA directly, stepping the set of live states (threads) over the input as Pike's VM does. Every state
+// enters a step at most once, so a scan takes O(n * m) time for n input bytes and m NFA states and edges, however
+// the NFA would blow up when determinized. The thread lists are sparse sets allocated up front, so matching does not
+// allocate.
+//
+// Matching reuses the thread lists, so a PikeVM must not be shared between threads.
+class PikeVM {
+public:
+    static constexpr size_t NO_MATCH = std::string_view::npos;
+
+    PikeVM() = default;
+
+    explicit PikeVM(const NFA& nfa) : PikeVM(FrozenNFA(nfa)) {}
+
+    explicit PikeVM(FrozenNFA frozen) : nfa(std::move(frozen)), current(nfa.getStateCount()),
+                                        next(nfa.getStateCount()) {
+        stack.reserve(nfa.getStateCount());
+    }
+
+    // Returns true if the whole input is accepted
+    bool match(std::string_view input) {
+        return scan(input, false) == input.size();
+    }
+
+    // Returns the length of the longest accepted prefix of the input, or NO_MATCH if no prefix is accepted
+    size_t longestPrefix(std::string_view input) {
+        return scan(input, true);
+    }
+
+    [[nodiscard]] const FrozenNFA& getNFA() const {
+        return nfa;
+    }
+
+private:
+    // A set of states with constant time insert, membership and clear, iterated in insertion order
+    class SparseSet {
+    public:
+        SparseSet() = default;
+
+        explicit SparseSet(int capacity) : dense(capacity), sparse(capacity) {}
+
+        // False if the state was already in the set
+        bool insert(int state) {
+            if (contains(state)) return false;
+            sparse[state] = size;
+            dense[size++] = state;
+            return true;
+        }
+
+        [[nodiscard]] bool contains(int state) const {
+            return sparse[state] < size && dense[sparse[state]] == state;
+        }
+
+        void clear() {
+            size = 0;
+        }
+
+        [[nodiscard]] bool empty() const {
+            return size == 0;
+        }
+
+        [[nodiscard]] const int* begin() const {
+            return dense.data();
+        }
+
+        [[nodiscard]] const int* end() const {
+            return dense.data() + size;
+        }
+
+    private:
+        std::vector<int> dense;
+        std::vector<uint32_t> sparse;
+        uint32_t size = 0;
+    };
+
+    FrozenNFA nfa;
+    SparseSet current;
+    SparseSet next;
+    std::vector<int> stack;
+
+    // Adds a state and its epsilon closure to threads. Returns true if any state added accepts.
+    bool addThread(SparseSet& threads, int state) {
+        bool accept = false;
+        if (!threads.insert(state)) return false;
+        stack.push_back(state);
+        while (!stack.empty()) {
+            int top = stack.back();
+            stack.pop_back();
+            accept |= nfa.isAccept(top);
+            for (uint32_t target : nfa.getEpsilonTargets(top)) {
+                if (threads.insert(static_cast<int>(target))) {
+                    stack.push_back(static_cast<int>(target));
+                }
+            }
+        }
+        return accept;
+    }
+
+    size_t scan(std::string_view input, bool prefix) {
+        if (nfa.empty()) {
+            return NO_MATCH;
+        }
+
+        current.clear();
+        size_t lastAccept = addThread(current, nfa.getStartState()) ? 0 : NO_MATCH;
+        for (size_t i = 0; i < input.size() && !current.empty(); ++i) {
+            auto byte = static_cast<unsigned char>(input[i]);
+            bool accept = false;
+            next.clear();
+            for (int state : current) {
+                for (const auto& edge : nfa.getEdges(state)) {
+                    if (edge.low <= byte && byte <= edge.high) {
+                        accept |= addThread(next, static_cast<int>(edge.target));
+                    }
+                }
+            }
+            std::swap(current, next);
+            if (accept) {
+                lastAccept = i + 1;
+            }
+        }
+
+        if (!prefix) {
+            return lastAccept == input.size() ? lastAccept : NO_MATCH;
+        }
+        return lastAccept;
+    }
+};
+
+
+#endif //SYPHON_PIKEVM_H
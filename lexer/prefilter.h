@@ -0,0 +1,246 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_PREFILTER_H
+#define SYPHON_PREFILTER_H
+
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "compiledDFA.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define SYPHON_PREFILTER_SSE2 1
+#if defined(__GNUC__) || defined(__clang__)
+#define SYPHON_PREFILTER_AVX2 1
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// Skips the positions of a search that cannot start a match. From the DFA it extracts a small set of literals that
+// every match begins with, walking from the start state until the paths accept, grow too long or branch too much.
+// find() looks for the first bytes of those literals with SIMD compares, 32 bytes at a time with AVX2 or 16 with
+// SSE2, and checks the full literal only at those candidates. When the paths branch too much right from the start,
+// the prefilter falls back to the set of bytes that can start a match, scanned one byte at a time if there are too
+// many of them to compare against in a vector.
+class Prefilter {
+public:
+    static constexpr size_t MAX_LITERALS = 16;
+    static constexpr size_t MAX_LITERAL_LENGTH = 8;
+    // Most first bytes the vectorized scan compares against
+    static constexpr size_t MAX_VECTOR_BYTES = 8;
+
+    // A prefilter that lets every position through
+    Prefilter() = default;
+
+    static Prefilter fromDFA(const CompiledDFA& dfa) {
+        Prefilter prefilter;
+        uint32_t start = dfa.getStartState();
+        // A DFA that accepts the empty string can match anywhere
+        if (start == CompiledDFA::DEAD_STATE || dfa.isAccept(start)) {
+            return prefilter;
+        }
+
+        prefilter.extractLiterals(dfa);
+        for (int byte = 0; byte < 256; ++byte) {
+            if (dfa.getTransition(start, static_cast<unsigned char>(byte)) != CompiledDFA::DEAD_STATE) {
+                prefilter.firstBytes[byte] = true;
+                prefilter.firstByteList.push_back(static_cast<unsigned char>(byte));
+            }
+        }
+        prefilter.active = prefilter.firstByteList.size() < 256;
+        return prefilter;
+    }
+
+    // Returns the first position from on at which a match may start, or input.size() if there is none
+    [[nodiscard]] size_t find(std::string_view input, size_t from = 0) const {
+        if (!active) {
+            return std::min(from, input.size());
+        }
+        while ((from = findFirstByte(input, from)) < input.size()) {
+            if (literals.empty() || literalAt(input, from)) {
+                return from;
+            }
+            from++;
+        }
+        return input.size();
+    }
+
+    // False if no match can start with byte
+    [[nodiscard]] bool mayStartWith(unsigned char byte) const {
+        return !active || firstBytes[byte];
+    }
+
+    // False if the prefilter lets every position through
+    [[nodiscard]] bool isActive() const {
+        return active;
+    }
+
+    // Literals every match starts with, or none if only the first bytes are known
+    [[nodiscard]] const std::vector<std::string>& getLiterals() const {
+        return literals;
+    }
+
+    [[nodiscard]] const std::vector<unsigned char>& getFirstBytes() const {
+        return firstByteList;
+    }
+
+private:
+    bool active = false;
+    std::vector<std::string> literals;
+    // Indices of the literals starting with every byte
+    std::array<std::vector<uint8_t>, 256> literalsByFirstByte;
+    std::array<bool, 256> firstBytes{};
+    std::vector<unsigned char> firstByteList;
+
+    // Expands paths from the start state breadth first. A path ends in a literal once it reaches an accept state or
+    // the length limit, or when following all its branches would exceed the literal limit.
+    void extractLiterals(const CompiledDFA& dfa) {
+        std::vector<std::pair<std::string, uint32_t>> paths = {{"", dfa.getStartState()}};
+        std::vector<std::pair<std::string, uint32_t>> next;
+        std::vector<std::string> found;
+
+        while (!paths.empty()) {
+            next.clear();
+            for (size_t i = 0; i < paths.size(); ++i) {
+                const auto& [prefix, state] = paths[i];
+                if (dfa.isAccept(state) || prefix.size() == MAX_LITERAL_LENGTH) {
+                    found.push_back(prefix);
+                    continue;
+                }
+                size_t successorCount = 0;
+                for (int byte = 0; byte < 256; ++byte) {
+                    successorCount += dfa.getTransition(state, static_cast<unsigned char>(byte)) != CompiledDFA::DEAD_STATE;
+                }
+                // Paths not yet expanded stay one literal each
+                size_t pending = paths.size() - i - 1;
+                if (found.size() + next.size() + pending + successorCount > MAX_LITERALS) {
+                    found.push_back(prefix);
+                    continue;
+                }
+                for (int byte = 0; byte < 256; ++byte) {
+                    uint32_t target = dfa.getTransition(state, static_cast<unsigned char>(byte));
+                    if (target != CompiledDFA::DEAD_STATE) {
+                        next.emplace_back(prefix + static_cast<char>(byte), target);
+                    }
+                }
+            }
+            paths.swap(next);
+        }
+
+        // Literals only help if they go beyond the first byte
+        bool longerThanOneByte = false;
+        for (const auto& literal : found) {
+            if (literal.empty()) return;
+            longerThanOneByte |= literal.size() > 1;
+        }
+        if (!longerThanOneByte) return;
+
+        literals = std::move(found);
+        for (size_t i = 0; i < literals.size(); ++i) {
+            literalsByFirstByte[static_cast<unsigned char>(literals[i][0])].push_back(static_cast<uint8_t>(i));
+        }
+    }
+
+    [[nodiscard]] bool literalAt(std::string_view input, size_t position) const {
+        for (uint8_t index : literalsByFirstByte[static_cast<unsigned char>(input[position])]) {
+            const std::string& literal = literals[index];
+            if (input.size() - position >= literal.size() &&
+                std::memcmp(input.data() + position, literal.data(), literal.size()) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The first position from on holding one of the first bytes, or input.size()
+    [[nodiscard]] size_t findFirstByte(std::string_view input, size_t from) const {
+        if (firstByteList.size() <= MAX_VECTOR_BYTES) {
+#ifdef SYPHON_PREFILTER_AVX2
+            if (hasAVX2()) {
+                return findFirstByteAVX2(input, from);
+            }
+#endif
+#ifdef SYPHON_PREFILTER_SSE2
+            return findFirstByteSSE2(input, from);
+#endif
+        }
+        return findFirstByteScalar(input, from);
+    }
+
+    [[nodiscard]] size_t findFirstByteScalar(std::string_view input, size_t from) const {
+        for (; from < input.size(); ++from) {
+            if (firstBytes[static_cast<unsigned char>(input[from])]) break;
+        }
+        return from;
+    }
+
+#ifdef SYPHON_PREFILTER_SSE2
+    static size_t countTrailingZeros(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<size_t>(__builtin_ctz(mask));
+#else
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#endif
+    }
+
+    [[nodiscard]] size_t findFirstByteSSE2(std::string_view input, size_t from) const {
+        __m128i needles[MAX_VECTOR_BYTES];
+        for (size_t i = 0; i < firstByteList.size(); ++i) {
+            needles[i] = _mm_set1_epi8(static_cast<char>(firstByteList[i]));
+        }
+        for (; from + 16 <= input.size(); from += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.data() + from));
+            __m128i hits = _mm_setzero_si128();
+            for (size_t i = 0; i < firstByteList.size(); ++i) {
+                hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, needles[i]));
+            }
+            auto mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+            if (mask != 0) {
+                return from + countTrailingZeros(mask);
+            }
+        }
+        return findFirstByteScalar(input, from);
+    }
+#endif
+
+#ifdef SYPHON_PREFILTER_AVX2
+    static bool hasAVX2() {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+
+    __attribute__((target("avx2")))
+    [[nodiscard]] size_t findFirstByteAVX2(std::string_view input, size_t from) const {
+        __m256i needles[MAX_VECTOR_BYTES];
+        for (size_t i = 0; i < firstByteList.size(); ++i) {
+            needles[i] = _mm256_set1_epi8(static_cast<char>(firstByteList[i]));
+        }
+        for (; from + 32 <= input.size(); from += 32) {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input.data() + from));
+            __m256i hits = _mm256_setzero_si256();
+            for (size_t i = 0; i < firstByteList.size(); ++i) {
+                hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, needles[i]));
+            }
+            auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+            if (mask != 0) {
+                return from + countTrailingZeros(mask);
+            }
+        }
+        return findFirstByteSSE2(input, from);
+    }
+#endif
+};
+
+
+#endif //SYPHON_PREFILTER_H
@@ -6,136 +6,735 @@
 #define SYPHON_REGEXTONFA_H
 
 
+#include <algorithm>
+#include <bitset>
+#include <cctype>
 #include <stack>
+#include <stdexcept>
+#include <string>
+#include <vector>
 #include "automata.h"
+#include "frozenNFA.h"
+#include "stats.h"
+#include "unicodeTables.h"
+#include "utf8Sequences.h"
 
+// Regexes are built into NFAs by Thompson construction. The syntax:
+//
+//     abc                  bytes other than operators stand for themselves
+//     \* \n \t \r \f \v \xHH an escaped operator, a control byte, a byte in hex
+//     [a-z_] [^0-9]        a class of bytes or of all bytes but those, with ranges and the escapes below
+//     \d \w \s \D \W \S    digits, word bytes and whitespace, and all bytes but those
+//     \p{L} \P{XID_Start}  the code points with a Unicode property, or without it, see UnicodeTables
+//     \u00E9 \u{1F600}     a code point
+//     [α-ω\p{Nd}]          a class of code points, as soon as one of its members is a code point
+//     .                    any byte but newline
+//     ab a|b (a)           concatenation, alternation, grouping
+//     (?<name>a)           a capture group, reported by TaggedDFA, and a group like any other to everything else
+//     a* a+ a?             zero or more, one or more, zero or one
+//     a{m} a{m,} a{m,n}    from m to n repetitions, with m and n at most MAX_REPEAT
+//
+// Byte 0 is the epsilon symbol and never matches. A class takes one edge per run of bytes, and a repetition one copy
+// of its operand per repetition that needs states of its own. Code points match their UTF-8 encoding, compiled by
+// Utf8Compiler into byte range edges, so automata step over bytes and never decode. A capture group puts an epsilon
+// edge tagged 2g before the group and one tagged 2g + 1 after it, g counting groups by their opening parenthesis.
 class RegexToNFA {
 public:
+    static constexpr int MAX_REPEAT = 1000;
+    static constexpr int MAX_CAPTURE_GROUPS = 32;
+
     static NFA fromRegex(const std::string& regex) {
-        std::string postfix = infixToPostfix(regex);
-        return buildNFAFromPostfix(postfix);
+        Stats::PhaseTimer timer(&Stats::Construction::regexToNFA);
+        return fromPostfix(infixToPostfix(regex));
     }
 
-private:
-    static bool isAlpha(char c) {
-        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    // Thompson construction alone, from a regex already converted by infixToPostfix
+    static NFA fromPostfix(const std::string& postfix) {
+        Stats::PhaseTimer timer(&Stats::Construction::regexToNFA);
+        NFAArena arena;
+        NFAFragment fragment = buildFragmentFromPostfix(postfix, arena);
+        recordSize(arena);
+        return {arena, fragment};
     }
 
-    static int precedence(char op) {
-        if (op == '*') return 3;
-        if (op == '.') return 2;
-        if (op == '|') return 1;
-        return 0;
+    // Builds one NFA that accepts the union of all rules. Each accept state is tagged with the index of the rule it
+    // came from, so earlier rules win when a DFA state accepts for several of them.
+    static NFA fromRules(const std::vector<std::string>& regexes) {
+        Stats::PhaseTimer timer(&Stats::Construction::regexToNFA);
+        NFAArena arena;
+        std::vector<std::pair<int, int>> acceptRules;
+        NFAFragment fragment = buildRules(regexes, arena, acceptRules);
+
+        NFA nfa(arena, fragment);
+        for (auto [state, rule] : acceptRules) {
+            nfa.setAcceptRule(state, rule);
+        }
+        return nfa;
+    }
+
+    // As fromRules, but frozen straight from the arena without building an NFA. Only a FrozenNFA built this way keeps
+    // the tags of capture groups and the order of preference between paths. The names of every rule's capture groups
+    // go to captureNames if given.
+    static FrozenNFA frozenFromRules(const std::vector<std::string>& regexes,
+                                     std::vector<std::vector<std::string>>* captureNames = nullptr) {
+        Stats::PhaseTimer timer(&Stats::Construction::regexToNFA);
+        NFAArena arena;
+        std::vector<std::pair<int, int>> acceptRules;
+        NFAFragment fragment = buildRules(regexes, arena, acceptRules, captureNames);
+        return {arena, fragment, acceptRules};
     }
 
-    static std::string infixToPostfix(const std::string& regex) {
+    // Converts a regex to postfix, with '.' standing for the implicit concatenation. Operands come out in a canonical
+    // form: a byte, escaped if it is an operator, or a class as a list of ranges such as [0-9a-z]. Counted repetition
+    // comes out as {m,n}, or {m,} without an upper bound. A tag comes out as its number in angle brackets, so capture
+    // group g becomes <2g>, the group, '.', <2g+1>, '.'. The names of the capture groups go to captureNames if given.
+    static std::string infixToPostfix(const std::string& regex, std::vector<std::string>* captureNames = nullptr) {
         std::string postfix;
         std::stack<char> operators;
+        // The capture group of every open parenthesis, or -1 for a plain group
+        std::stack<int> groups;
+        std::vector<std::string> names;
+        // Whether the last token ends an operand, in which case an operand after it is concatenated to it
+        bool endsOperand = false;
 
-        for (size_t i = 0; i < regex.length(); ++i) {
+        for (size_t i = 0; i < regex.length();) {
             char c = regex[i];
 
-            if (isAlpha(c)) {
-                postfix += c;
-                if (i + 1 < regex.length() && (isAlpha(regex[i + 1]) || regex[i + 1] == '(')) {
-                    postfix += '.';
-                }
-            } else if (c == '(') {
+            if (c == '(') {
+                if (endsOperand) pushOperator('.', postfix, operators);
                 operators.push(c);
+                groups.push(-1);
+                endsOperand = false;
+                i++;
+                if (i < regex.length() && regex[i] == '?') {
+                    i = parseGroupName(regex, i + 1, names);
+                    groups.top() = static_cast<int>(names.size()) - 1;
+                    postfix += '<' + std::to_string(2 * groups.top()) + '>';
+                }
             } else if (c == ')') {
                 while (!operators.empty() && operators.top() != '(') {
                     postfix += operators.top();
                     operators.pop();
                 }
+                if (operators.empty()) throw std::runtime_error("Invalid regex: unbalanced ')'");
                 operators.pop();
-                if (i + 1 < regex.length() && (isAlpha(regex[i + 1]) || regex[i + 1] == '(')) {
-                    postfix += '.';
+                if (groups.top() >= 0) {
+                    postfix += ".<" + std::to_string(2 * groups.top() + 1) + ">.";
                 }
-            } else { // Operators * . |
-                while (!operators.empty() && precedence(operators.top()) >= precedence(c)) {
-                    postfix += operators.top();
-                    operators.pop();
+                groups.pop();
+                endsOperand = true;
+                i++;
+            } else if (c == '|') {
+                pushOperator(c, postfix, operators);
+                endsOperand = false;
+                i++;
+            } else if (c == '*' || c == '+' || c == '?' || c == '{') {
+                // Repetition binds tighter than anything else, so it goes straight to the output
+                if (!endsOperand) throw std::runtime_error(std::string("Invalid regex: nothing to repeat for '") + c + "'");
+                if (c == '{') {
+                    i = appendCounts(regex, i, postfix);
+                } else {
+                    postfix += c;
+                    i++;
                 }
-                operators.push(c);
+            } else {
+                if (endsOperand) pushOperator('.', postfix, operators);
+                Operand operand;
+                i = parseOperand(regex, i, operand);
+                appendOperand(operand, postfix);
+                endsOperand = true;
             }
         }
 
         while (!operators.empty()) {
+            if (operators.top() == '(') throw std::runtime_error("Invalid regex: unbalanced '('");
             postfix += operators.top();
             operators.pop();
         }
 
+        if (captureNames != nullptr) {
+            *captureNames = std::move(names);
+        }
         return postfix;
     }
 
-    static NFA buildNFAFromPostfix(const std::string& postfix) {
-        std::stack<NFAFragment> stack;
-        int stateCounter = 0;
+private:
+    using ByteSet = std::bitset<256>;
 
-        for (char symbol : postfix) {
-            if (isAlpha(symbol)) { // Single character transition
-                int start = stateCounter++;
-                int end = stateCounter++;
-                NFAFragment fragment(start);
-                fragment.acceptStates.insert(end);
-                fragment.transitions[{start, symbol}].insert(end);
-                stack.push(fragment);
-            } else if (symbol == '|') { // Union
-                if (stack.size() < 2) throw std::runtime_error("Invalid regex: insufficient operands for '|'");
-                NFAFragment right = stack.top(); stack.pop();
-                NFAFragment left = stack.top(); stack.pop();
-                int start = stateCounter++;
-                int end = stateCounter++;
+    // The bytes an operand matches, and for a Unicode operand the code points, which match their UTF-8 encodings.
+    // Operands that name no code point match bytes, classes with a Unicode member match code points.
+    struct Operand {
+        ByteSet bytes;
+        std::vector<CodePointRange> codePoints;
+        bool unicode = false;
 
-                NFAFragment fragment(start);
-                fragment.transitions[{start, EPSILON}].insert(left.startState);
-                fragment.transitions[{start, EPSILON}].insert(right.startState);
+        void add(const Operand& other) {
+            bytes |= other.bytes;
+            codePoints.insert(codePoints.end(), other.codePoints.begin(), other.codePoints.end());
+            unicode |= other.unicode;
+        }
 
-                for (int state : left.acceptStates) {
-                    fragment.transitions[{state, EPSILON}].insert(end);
+        // Turns the bytes of a Unicode operand into the code points U+0000 to U+00FF, and normalizes the ranges
+        void toCodePoints() {
+            for (size_t byte = 0; byte < 256; ++byte) {
+                if (bytes.test(byte)) codePoints.push_back({static_cast<uint32_t>(byte), static_cast<uint32_t>(byte)});
+            }
+            bytes.reset();
+            UnicodeTables::normalize(codePoints);
+        }
+
+        // Moves the ASCII code points of a normalized Unicode operand back to bytes, as they encode as themselves
+        void splitASCII() {
+            std::vector<CodePointRange> rest;
+            for (const auto& range : codePoints) {
+                for (uint32_t codePoint = range.low; codePoint <= std::min<uint32_t>(range.high, 0x7F); ++codePoint) {
+                    bytes.set(codePoint);
+                }
+                if (range.high >= 0x80) rest.push_back({std::max<uint32_t>(range.low, 0x80), range.high});
+            }
+            codePoints = std::move(rest);
+        }
+    };
+
+    static bool isOperator(char c) {
+        switch (c) {
+            case '\\': case '.': case '[': case ']': case '(': case ')': case '|':
+            case '*': case '+': case '?': case '{': case '}': case '^': case '$':
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    static int precedence(char op) {
+        if (op == '.') return 2;
+        if (op == '|') return 1;
+        return 0;
+    }
+
+    // Pops operators that bind at least as tight as op, then pushes op
+    static void pushOperator(char op, std::string& postfix, std::stack<char>& operators) {
+        while (!operators.empty() && precedence(operators.top()) >= precedence(op)) {
+            postfix += operators.top();
+            operators.pop();
+        }
+        operators.push(op);
+    }
+
+    // Parses the operand at i. Returns the position after it.
+    static size_t parseOperand(const std::string& regex, size_t i, Operand& operand) {
+        char c = regex[i];
+        switch (c) {
+            case '[':
+                return parseClass(regex, i + 1, operand);
+            case '\\':
+                return parseEscape(regex, i + 1, operand);
+            case '.':
+                operand.bytes.set();
+                operand.bytes.reset('\n');
+                return i + 1;
+            case ']': case '}':
+                throw std::runtime_error(std::string("Invalid regex: unescaped '") + c + "'");
+            case '^': case '$':
+                throw std::runtime_error("Invalid regex: anchors are not supported");
+            default:
+                operand.bytes.set(static_cast<unsigned char>(c));
+                return i + 1;
+        }
+    }
+
+    // Parses the escape after a backslash at i - 1 and adds what it stands for. Returns the position after it.
+    static size_t parseEscape(const std::string& regex, size_t i, Operand& operand) {
+        if (i >= regex.length()) throw std::runtime_error("Invalid regex: trailing '\\'");
+        char c = regex[i];
+        ByteSet escaped;
+        switch (c) {
+            case 'd': case 'D':
+                for (char digit = '0'; digit <= '9'; ++digit) escaped.set(digit);
+                break;
+            case 'w': case 'W':
+                for (int byte = 0; byte < 256; ++byte) {
+                    if (std::isalnum(byte) || byte == '_') escaped.set(byte);
+                }
+                break;
+            case 's': case 'S':
+                for (char space : {' ', '\t', '\n', '\r', '\f', '\v'}) escaped.set(static_cast<unsigned char>(space));
+                break;
+            case 'n': escaped.set('\n'); break;
+            case 't': escaped.set('\t'); break;
+            case 'r': escaped.set('\r'); break;
+            case 'f': escaped.set('\f'); break;
+            case 'v': escaped.set('\v'); break;
+            case 'x': {
+                int high = i + 2 < regex.length() ? hexValue(regex[i + 1]) : -1;
+                int low = high >= 0 ? hexValue(regex[i + 2]) : -1;
+                if (low < 0) throw std::runtime_error("Invalid regex: '\\x' needs two hex digits");
+                operand.bytes.set(static_cast<size_t>(high * 16 + low));
+                return i + 3;
+            }
+            case 'u':
+                return parseCodePoint(regex, i + 1, operand);
+            case 'p': case 'P':
+                return parseProperty(regex, i + 1, c == 'P', operand);
+            default:
+                if (std::isalnum(static_cast<unsigned char>(c))) {
+                    throw std::runtime_error(std::string("Invalid regex: unknown escape '\\") + c + "'");
                 }
-                for (int state : right.acceptStates) {
-                    fragment.transitions[{state, EPSILON}].insert(end);
+                escaped.set(static_cast<unsigned char>(c));
+        }
+        if (c == 'D' || c == 'W' || c == 'S') escaped.flip();
+        operand.bytes |= escaped;
+        return i + 1;
+    }
+
+    // Parses the <name> of a capture group at i, after its "(?", and adds the name. Returns the position after it.
+    static size_t parseGroupName(const std::string& regex, size_t i, std::vector<std::string>& names) {
+        if (i >= regex.length() || regex[i] != '<') throw std::runtime_error("Invalid regex: unknown group syntax '(?'");
+        size_t nameEnd = regex.find('>', i);
+        if (nameEnd == std::string::npos) throw std::runtime_error("Invalid regex: unterminated group name");
+        std::string name = regex.substr(i + 1, nameEnd - i - 1);
+        bool valid = !name.empty() && !std::isdigit(static_cast<unsigned char>(name[0]));
+        for (char c : name) {
+            valid &= std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+        }
+        if (!valid) throw std::runtime_error("Invalid regex: bad group name '" + name + "'");
+        if (std::find(names.begin(), names.end(), name) != names.end()) {
+            throw std::runtime_error("Invalid regex: duplicate group name '" + name + "'");
+        }
+        if (names.size() == MAX_CAPTURE_GROUPS) {
+            throw std::runtime_error("Invalid regex: more than " + std::to_string(MAX_CAPTURE_GROUPS) + " capture groups");
+        }
+        names.push_back(std::move(name));
+        return nameEnd + 1;
+    }
+
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    // Parses the code point of \uXXXX or \u{X...} from after the 'u'
+    static size_t parseCodePoint(const std::string& regex, size_t i, Operand& operand) {
+        bool braced = i < regex.length() && regex[i] == '{';
+        size_t digitsStart = braced ? i + 1 : i;
+        size_t digitsEnd = digitsStart;
+        uint32_t codePoint = 0;
+        while (digitsEnd < regex.length() && hexValue(regex[digitsEnd]) >= 0 && (braced || digitsEnd < digitsStart + 4)) {
+            codePoint = codePoint * 16 + static_cast<uint32_t>(hexValue(regex[digitsEnd++]));
+            if (codePoint > UnicodeTables::MAX_CODE_POINT) throw std::runtime_error("Invalid regex: code point out of range");
+        }
+        bool complete = braced ? digitsEnd > digitsStart && digitsEnd < regex.length() && regex[digitsEnd] == '}'
+                               : digitsEnd == digitsStart + 4;
+        if (!complete) throw std::runtime_error("Invalid regex: '\\u' needs four hex digits or a braced code point");
+
+        operand.codePoints.push_back({codePoint, codePoint});
+        operand.unicode = true;
+        return braced ? digitsEnd + 1 : digitsEnd;
+    }
+
+    // Parses the {Name} of \p{Name}, or of \P{Name} for everything but the property, from after the 'p'
+    static size_t parseProperty(const std::string& regex, size_t i, bool negated, Operand& operand) {
+        size_t close = i < regex.length() && regex[i] == '{' ? regex.find('}', i) : std::string::npos;
+        if (close == std::string::npos) throw std::runtime_error("Invalid regex: '\\p' needs a braced property name");
+
+        std::string name = regex.substr(i + 1, close - i - 1);
+        std::vector<CodePointRange> ranges = UnicodeTables::property(name);
+        if (ranges.empty()) throw std::runtime_error("Invalid regex: unknown Unicode property '" + name + "'");
+        if (negated) ranges = UnicodeTables::complement(ranges);
+
+        operand.codePoints.insert(operand.codePoints.end(), ranges.begin(), ranges.end());
+        operand.unicode = true;
+        return close + 1;
+    }
+
+    // Parses a class from after its '[' and adds its members. A ']' right after the '[' or '[^' is a member, as is a
+    // '-' that cannot form a range. A class with a Unicode member is a class of code points: its bytes stand for
+    // U+0000 to U+00FF, non-ASCII UTF-8 in it for the code point encoded, and a negated one holds every code point
+    // but its members. Returns the position after the closing ']'.
+    static size_t parseClass(const std::string& regex, size_t i, Operand& operand) {
+        bool negated = i < regex.length() && regex[i] == '^';
+        if (negated) i++;
+
+        Operand members;
+        for (bool first = true;; first = false) {
+            if (i >= regex.length()) throw std::runtime_error("Invalid regex: unterminated '['");
+            if (regex[i] == ']' && !first) {
+                i++;
+                break;
+            }
+
+            Operand item;
+            i = parseClassItem(regex, i, item);
+            if (i + 1 < regex.length() && regex[i] == '-' && regex[i + 1] != ']') {
+                Operand upper;
+                i = parseClassItem(regex, i + 1, upper);
+                uint32_t low = singleValue(item);
+                uint32_t high = singleValue(upper);
+                if (low > high) throw std::runtime_error("Invalid regex: class range out of order");
+                if (item.unicode || upper.unicode) {
+                    members.codePoints.push_back({low, high});
+                    members.unicode = true;
+                } else {
+                    for (uint32_t byte = low; byte <= high; ++byte) members.bytes.set(byte);
                 }
+            } else {
+                members.add(item);
+            }
+        }
+
+        if (members.unicode) {
+            members.toCodePoints();
+            if (negated) members.codePoints = UnicodeTables::complement(members.codePoints);
+        } else if (negated) {
+            members.bytes.flip();
+        }
+        operand.add(members);
+        return i;
+    }
+
+    static size_t parseClassItem(const std::string& regex, size_t i, Operand& item) {
+        if (regex[i] == '\\') return parseEscape(regex, i + 1, item);
+        size_t next = decodeUtf8(regex, i, item);
+        if (next > i) return next;
+        item.bytes.set(static_cast<unsigned char>(regex[i]));
+        return i + 1;
+    }
+
+    // Decodes a multibyte UTF-8 sequence at i into a code point. Returns the position after it, or i if there is none.
+    static size_t decodeUtf8(const std::string& regex, size_t i, Operand& item) {
+        auto lead = static_cast<unsigned char>(regex[i]);
+        size_t length = lead >= 0xF0 && lead <= 0xF4 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC2 ? 2 : 0;
+        if (length == 0 || lead > 0xF4 || i + length > regex.length()) return i;
+
+        uint32_t codePoint = lead & (0x7F >> length);
+        for (size_t j = 1; j < length; ++j) {
+            auto byte = static_cast<unsigned char>(regex[i + j]);
+            if ((byte & 0xC0) != 0x80) return i;
+            codePoint = codePoint << 6 | (byte & 0x3F);
+        }
+        // Overlong encodings, surrogates and code points past U+10FFFF are not valid UTF-8
+        static constexpr uint32_t minimum[] = {0, 0, 0x80, 0x800, 0x10000};
+        if (codePoint < minimum[length] || (codePoint >= 0xD800 && codePoint <= 0xDFFF) ||
+            codePoint > UnicodeTables::MAX_CODE_POINT) {
+            return i;
+        }
+        item.codePoints.push_back({codePoint, codePoint});
+        item.unicode = true;
+        return i + length;
+    }
+
+    // The one byte or code point a range bound stands for
+    static uint32_t singleValue(const Operand& item) {
+        if (!item.unicode && item.bytes.count() == 1) return static_cast<uint32_t>(lowestByte(item.bytes));
+        if (item.unicode && item.bytes.none() && item.codePoints.size() == 1 &&
+            item.codePoints[0].low == item.codePoints[0].high) {
+            return item.codePoints[0].low;
+        }
+        throw std::runtime_error("Invalid regex: class range bounds must be single bytes or code points");
+    }
+
+    static size_t lowestByte(const ByteSet& bytes) {
+        size_t byte = 0;
+        while (!bytes.test(byte)) byte++;
+        return byte;
+    }
+
+    // Escapes operators, '-' and '<', so bytes read back unambiguously both as operands and inside canonical classes
+    static void appendByte(unsigned char byte, std::string& postfix) {
+        if (isOperator(static_cast<char>(byte)) || byte == '-' || byte == '<') postfix += '\\';
+        postfix += static_cast<char>(byte);
+    }
+
+    // Appends an operand as a byte or a class. The non-ASCII code points of a class follow its byte ranges, as hex
+    // ranges in angle brackets: [_-_a-z<e0-ff>].
+    static void appendOperand(Operand operand, std::string& postfix) {
+        if (operand.unicode) {
+            operand.toCodePoints();
+            operand.splitASCII();
+        }
+        ByteSet& bytes = operand.bytes;
+        bytes.reset(static_cast<unsigned char>(EPSILON));
+        if (bytes.none() && operand.codePoints.empty()) throw std::runtime_error("Invalid regex: operand matches no byte");
+        if (bytes.count() == 1 && operand.codePoints.empty()) {
+            appendByte(static_cast<unsigned char>(lowestByte(bytes)), postfix);
+            return;
+        }
+
+        postfix += '[';
+        for (size_t low = 0; low < 256;) {
+            if (!bytes.test(low)) {
+                low++;
+                continue;
+            }
+            size_t high = low;
+            while (high + 1 < 256 && bytes.test(high + 1)) high++;
+            appendByte(static_cast<unsigned char>(low), postfix);
+            postfix += '-';
+            appendByte(static_cast<unsigned char>(high), postfix);
+            low = high + 1;
+        }
+        for (const auto& range : operand.codePoints) {
+            postfix += '<' + toHex(range.low) + '-' + toHex(range.high) + '>';
+        }
+        postfix += ']';
+    }
+
+    static std::string toHex(uint32_t value) {
+        static constexpr char digits[] = "0123456789abcdef";
+        std::string hex;
+        do {
+            hex.insert(hex.begin(), digits[value % 16]);
+            value /= 16;
+        } while (value > 0);
+        return hex;
+    }
+
+    // Parses {m}, {m,} or {m,n} at i and appends it in canonical form. Returns the position after the '}'.
+    static size_t appendCounts(const std::string& regex, size_t i, std::string& postfix) {
+        size_t position = i + 1;
+        int min = parseCount(regex, position);
+        int max = min;
+        if (position < regex.length() && regex[position] == ',') {
+            position++;
+            max = parseCount(regex, position);
+        }
+        if (min < 0 || position >= regex.length() || regex[position] != '}') {
+            throw std::runtime_error("Invalid regex: malformed repetition count");
+        }
+        if (max >= 0 && max < min) throw std::runtime_error("Invalid regex: repetition count out of order");
+
+        postfix += '{' + std::to_string(min) + ',' + (max < 0 ? "" : std::to_string(max)) + '}';
+        return position + 1;
+    }
+
+    // Parses a decimal count at position, or returns -1 if there is none
+    static int parseCount(const std::string& text, size_t& position) {
+        int count = -1;
+        for (; position < text.length() && text[position] >= '0' && text[position] <= '9'; ++position) {
+            count = std::max(count, 0) * 10 + (text[position] - '0');
+            if (count > MAX_REPEAT) {
+                throw std::runtime_error("Invalid regex: repetition count above " + std::to_string(MAX_REPEAT));
+            }
+        }
+        return count;
+    }
+
+    // Reads a hex code point of a canonical postfix class at i, up to the delimiter after it
+    static uint32_t readCodePoint(const std::string& postfix, size_t& i, char delimiter) {
+        uint32_t codePoint = 0;
+        size_t digitsStart = i;
+        for (; i < postfix.length() && hexValue(postfix[i]) >= 0 && i < digitsStart + 8; ++i) {
+            codePoint = codePoint * 16 + static_cast<uint32_t>(hexValue(postfix[i]));
+        }
+        if (i == digitsStart || i >= postfix.length() || postfix[i] != delimiter ||
+            codePoint > UnicodeTables::MAX_CODE_POINT) {
+            throw std::runtime_error("Invalid regex: malformed expression");
+        }
+        i++;
+        return codePoint;
+    }
+
+    // Reads a byte of a canonical postfix operand at i, unescaping it
+    static unsigned char readByte(const std::string& postfix, size_t& i) {
+        if (postfix[i] == '\\') i++;
+        if (i >= postfix.length()) throw std::runtime_error("Invalid regex: malformed expression");
+        return static_cast<unsigned char>(postfix[i++]);
+    }
+
+    // A start state with an epsilon edge to every rule, and the rule of every accept state
+    static NFAFragment buildRules(const std::vector<std::string>& regexes, NFAArena& arena,
+                                  std::vector<std::pair<int, int>>& acceptRules,
+                                  std::vector<std::vector<std::string>>* captureNames = nullptr) {
+        NFAFragment fragment(arena.addState());
+        if (captureNames != nullptr) {
+            captureNames->assign(regexes.size(), {});
+        }
+        for (size_t rule = 0; rule < regexes.size(); ++rule) {
+            std::vector<std::string>* names = captureNames != nullptr ? &(*captureNames)[rule] : nullptr;
+            NFAFragment ruleFragment = buildFragmentFromPostfix(infixToPostfix(regexes[rule], names), arena);
+            arena.addEdge(fragment.startState, EPSILON, ruleFragment.startState);
+            for (int state : ruleFragment.acceptStates) {
+                acceptRules.emplace_back(state, static_cast<int>(rule));
+            }
+        }
+        recordSize(arena);
+        return fragment;
+    }
+
+    static void recordSize(const NFAArena& arena) {
+        Stats::set(&Stats::Construction::nfaStates, static_cast<size_t>(arena.stateCount));
+        Stats::set(&Stats::Construction::nfaEdges, arena.edges.size() + arena.rangeEdges.size());
+    }
+
+    // Thompson construction. States and edges go straight into the arena, and the operand stack only holds
+    // (start, accept states) handles, so every operator costs time proportional to the states it touches. In postfix
+    // every operand is a contiguous stretch, so the states and edges of a fragment are everything added to the arena
+    // since it began, which is how repetition copies it.
+    static NFAFragment buildFragmentFromPostfix(const std::string& postfix, NFAArena& arena) {
+        std::vector<NFAFragment> stack;
+        std::vector<NFAArena::Mark> begins;
+
+        for (size_t i = 0; i < postfix.length(); ++i) {
+            char symbol = postfix[i];
+            if (symbol == '|') { // Union
+                if (stack.size() < 2) throw std::runtime_error("Invalid regex: insufficient operands for '|'");
+                NFAFragment right = std::move(stack.back()); stack.pop_back();
+                NFAFragment left = std::move(stack.back()); stack.pop_back();
+                begins.pop_back();
+                int start = arena.addState();
+
+                arena.addEdge(start, EPSILON, left.startState);
+                arena.addEdge(start, EPSILON, right.startState);
 
-                fragment.acceptStates.insert(end);
-                fragment.transitions.insert(left.transitions.begin(), left.transitions.end());
-                fragment.transitions.insert(right.transitions.begin(), right.transitions.end());
-                stack.push(fragment);
+                // Both sides keep their accept states, the shorter list is appended to the longer one
+                NFAFragment fragment(start);
+                if (left.acceptStates.size() < right.acceptStates.size()) std::swap(left, right);
+                fragment.acceptStates = std::move(left.acceptStates);
+                fragment.acceptStates.insert(fragment.acceptStates.end(),
+                                             right.acceptStates.begin(), right.acceptStates.end());
+                stack.push_back(std::move(fragment));
             } else if (symbol == '.') { // Concatenation
                 if (stack.size() < 2) throw std::runtime_error("Invalid regex: insufficient operands for '.'");
-                NFAFragment right = stack.top(); stack.pop();
-                NFAFragment left = stack.top(); stack.pop();
+                NFAFragment right = std::move(stack.back()); stack.pop_back();
+                begins.pop_back();
+                NFAFragment& left = stack.back();
 
                 for (int state : left.acceptStates) {
-                    left.transitions[{state, EPSILON}].insert(right.startState);
+                    arena.addEdge(state, EPSILON, right.startState);
                 }
 
-                left.acceptStates = right.acceptStates;
-                left.transitions.insert(right.transitions.begin(), right.transitions.end());
-                stack.push(left);
+                left.acceptStates = std::move(right.acceptStates);
             } else if (symbol == '*') { // Kleene star
                 if (stack.empty()) throw std::runtime_error("Invalid regex: insufficient operand for '*'");
-                NFAFragment fragment = stack.top(); stack.pop();
-                int start = stateCounter++;
-                int end = stateCounter++;
+                NFAFragment& fragment = stack.back();
+                int start = arena.addState();
+                int end = arena.addState();
 
-                fragment.transitions[{start, EPSILON}].insert(fragment.startState);
-                fragment.transitions[{start, EPSILON}].insert(end);
+                arena.addEdge(start, EPSILON, fragment.startState);
+                arena.addEdge(start, EPSILON, end);
 
                 for (int state : fragment.acceptStates) {
-                    fragment.transitions[{state, EPSILON}].insert(fragment.startState);
-                    fragment.transitions[{state, EPSILON}].insert(end);
+                    arena.addEdge(state, EPSILON, fragment.startState);
+                    arena.addEdge(state, EPSILON, end);
                 }
 
                 fragment.startState = start;
                 fragment.acceptStates = {end};
-                stack.push(fragment);
+            } else if (symbol == '+' || symbol == '?' || symbol == '{') { // Bounded and unbounded repetition
+                if (stack.empty()) throw std::runtime_error(std::string("Invalid regex: insufficient operand for '") + symbol + "'");
+                int min = symbol == '?' ? 0 : 1;
+                int max = symbol == '+' ? -1 : 1;
+                if (symbol == '{') {
+                    size_t position = i + 1;
+                    min = parseCount(postfix, position);
+                    max = position < postfix.length() && postfix[position] == ',' ? parseCount(postfix, ++position) : min;
+                    if (min < 0 || position >= postfix.length() || postfix[position] != '}') {
+                        throw std::runtime_error("Invalid regex: malformed repetition count");
+                    }
+                    i = position;
+                }
+                repeat(stack.back(), begins.back(), min, max, arena);
+            } else { // Tag, byte or class transition
+                begins.push_back(arena.mark());
+                int start = arena.addState();
+                int end = arena.addState();
+                if (symbol == '<') {
+                    int tag = parseCount(postfix, ++i);
+                    if (tag < 0 || tag >= 2 * MAX_CAPTURE_GROUPS || i >= postfix.length() || postfix[i] != '>') {
+                        throw std::runtime_error("Invalid regex: malformed expression");
+                    }
+                    arena.addTagEdge(start, tag, end);
+                } else if (symbol == '[') {
+                    // Code point ranges come in order, as the compiler that shares their UTF-8 sequences needs
+                    Utf8Compiler codePoints(arena, start, end);
+                    uint32_t previousHigh = 0;
+                    for (i++; i < postfix.length() && postfix[i] != ']';) {
+                        if (postfix[i] == '<') {
+                            uint32_t low = readCodePoint(postfix, ++i, '-');
+                            uint32_t high = readCodePoint(postfix, i, '>');
+                            if (low > high || (previousHigh > 0 && low <= previousHigh)) {
+                                throw std::runtime_error("Invalid regex: malformed expression");
+                            }
+                            codePoints.add({low, high});
+                            previousHigh = high;
+                            continue;
+                        }
+                        unsigned char low = readByte(postfix, i);
+                        if (i >= postfix.length() || postfix[i++] != '-') {
+                            throw std::runtime_error("Invalid regex: malformed expression");
+                        }
+                        unsigned char high = readByte(postfix, i);
+                        if (low == high) {
+                            arena.addEdge(start, static_cast<char>(low), end);
+                        } else {
+                            arena.addRangeEdge(start, low, high, end);
+                        }
+                    }
+                    if (i >= postfix.length()) throw std::runtime_error("Invalid regex: malformed expression");
+                    codePoints.finish();
+                } else {
+                    arena.addEdge(start, static_cast<char>(readByte(postfix, i)), end);
+                    i--;
+                }
+                NFAFragment fragment(start);
+                fragment.acceptStates.push_back(end);
+                stack.push_back(std::move(fragment));
             }
         }
 
         if (stack.size() != 1) throw std::runtime_error("Invalid regex: malformed expression");
-        return NFA(stack.top());
+        return std::move(stack.back());
+    }
+
+    // Repeats a fragment from min to max times, max -1 meaning without bound. Every repetition up to max, or up to min
+    // when unbounded, gets its own copy of the fragment. Copies past min can be left early, and the last copy of an
+    // unbounded repetition loops.
+    static void repeat(NFAFragment& fragment, const NFAArena::Mark& begin, int min, int max, NFAArena& arena) {
+        if (max == 0) {
+            int state = arena.addState();
+            fragment = NFAFragment(state);
+            fragment.acceptStates.push_back(state);
+            return;
+        }
+
+        const NFAArena::Mark end = arena.mark();
+        const int copies = max < 0 ? std::max(min, 1) : max;
+        std::vector<NFAFragment> parts = {fragment};
+        for (int copy = 1; copy < copies; ++copy) {
+            int offset = arena.copy(begin, end);
+            NFAFragment part(fragment.startState + offset);
+            for (int state : fragment.acceptStates) {
+                part.acceptStates.push_back(state + offset);
+            }
+            parts.push_back(std::move(part));
+        }
+
+        NFAFragment result(parts.front().startState);
+        if (min == 0) {
+            int start = arena.addState();
+            arena.addEdge(start, EPSILON, result.startState);
+            result.startState = start;
+            result.acceptStates.push_back(start);
+        }
+        for (int copy = 0; copy < copies; ++copy) {
+            if (copy > 0) {
+                for (int state : parts[copy - 1].acceptStates) {
+                    arena.addEdge(state, EPSILON, parts[copy].startState);
+                }
+            }
+            if (copy + 1 >= min) {
+                result.acceptStates.insert(result.acceptStates.end(),
+                                           parts[copy].acceptStates.begin(), parts[copy].acceptStates.end());
+            }
+        }
+        if (max < 0) {
+            for (int state : parts.back().acceptStates) {
+                arena.addEdge(state, EPSILON, parts.back().startState);
+            }
+        }
+        fragment = std::move(result);
     }
 };
 
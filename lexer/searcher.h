@@ -0,0 +1,261 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_SEARCHER_H
+#define SYPHON_SEARCHER_H
+
+
+#include <bit>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "automataTransformations.h"
+#include "compiledDFA.h"
+#include "prefilter.h"
+#include "regexToNFA.h"
+
+struct Match {
+    size_t offset;
+    size_t length;
+
+    bool operator==(const Match& other) const = default;
+};
+
+// Finds the matches of a regex anywhere in an input, leftmost first and longest at each position.
+//
+// findAll works in passes over the input, as RE2 does. A forward DFA for .*R marks every position a match ends at, and
+// a DFA for .*reverse(R) run backwards from the marked ends marks every position a match starts at. The matches are
+// then picked from the start marks left to right, each extended by an anchored longest-prefix scan. Whenever a pass
+// is back in its start state, nothing scanned so far affects what comes after, so the forward pass skips ahead to the
+// next position the prefilter lets through, once at a byte no match starts with, and the reverse pass skips to the
+// next match end. find runs the forward DFA only to the first match end, which finds an early match without scanning
+// the whole input. The leftmost match starts by that end, at or before the first start the reverse DFA marks back from
+// it, so only the positions up to that mark get an anchored scan.
+//
+// An anchored scan can run far past its match, as one for a|a(a|b)*c does over a run of a's, and the next scan goes
+// over the same bytes again. Scans therefore remember the (position, state) pairs they went through past their match,
+// from which nothing more matched, and a later scan stops at one. No pair is scanned twice past a match, so findAll
+// takes time linear in the input times the DFA's states, and the pairs take memory only while scans overlap. The same
+// holds for the scans find makes from the positions before its match, none of which match at all.
+//
+// Regexes have no transitions on the NUL byte, so no match spans one, and the unanchored scans restart after it.
+class Searcher {
+public:
+    explicit Searcher(const std::string& regex, bool usePrefilter = true) {
+        NFA nfa = RegexToNFA::fromRegex(regex);
+        dfa = compile(nfa);
+        forwardDFA = compile(AutomataTransformations::unanchored_nfa(nfa));
+        reverseDFA = compile(AutomataTransformations::unanchored_nfa(AutomataTransformations::reverse_nfa(nfa)));
+        if (usePrefilter) {
+            prefilter = Prefilter::fromDFA(dfa);
+        }
+    }
+
+    // The leftmost longest match starting at or after from
+    [[nodiscard]] std::optional<Match> find(std::string_view input, size_t from = 0) const {
+        if (from > input.size()) {
+            return std::nullopt;
+        }
+        DeadEnds deadEnds;
+        if (dfa.isAccept(dfa.getStartState())) {
+            // The empty match is everywhere
+            return Match{from, longestMatchAt(input, from, input.size(), deadEnds)};
+        }
+        size_t firstEnd = firstMatchEnd(input, from);
+        if (firstEnd == CompiledDFA::NO_MATCH) {
+            return std::nullopt;
+        }
+
+        // A match starts at lastStart, so its scan is the last one. Matches are not empty, so an earlier scan that
+        // finds none returns 0.
+        size_t lastStart = firstMatchStart(input, from, firstEnd);
+        for (size_t start = prefilter.find(input, from); start < lastStart; start = prefilter.find(input, start + 1)) {
+            size_t length = longestMatchAt(input, start, input.size(), deadEnds);
+            if (length != 0) {
+                return Match{start, length};
+            }
+        }
+        return Match{lastStart, longestMatchAt(input, lastStart, input.size(), deadEnds)};
+    }
+
+    // All non-overlapping matches, each search resuming after the previous match. An empty match is followed by a
+    // search one byte further on.
+    [[nodiscard]] std::vector<Match> findAll(std::string_view input) const {
+        std::vector<Match> matches;
+        std::vector<uint64_t> ends = matchEnds(input);
+        size_t lastEnd = previousMark(ends, input.size());
+        if (lastEnd == CompiledDFA::NO_MATCH) {
+            return matches;
+        }
+
+        std::vector<uint64_t> starts = matchStarts(input, ends, lastEnd);
+        DeadEnds deadEnds;
+        size_t from = 0;
+        while ((from = nextMark(starts, from)) <= lastEnd) {
+            size_t length = longestMatchAt(input, from, lastEnd, deadEnds);
+            matches.push_back({from, length});
+            from += std::max<size_t>(length, 1);
+        }
+        return matches;
+    }
+
+    [[nodiscard]] const CompiledDFA& getDFA() const {
+        return dfa;
+    }
+
+    [[nodiscard]] const Prefilter& getPrefilter() const {
+        return prefilter;
+    }
+
+private:
+    CompiledDFA dfa;
+    CompiledDFA forwardDFA;
+    CompiledDFA reverseDFA;
+    Prefilter prefilter;
+
+    // The (position, state) pairs anchored scans went through past their match, from which nothing more matches.
+    // They all lie below until, and none is of use once scans start at or after it.
+    struct DeadEnds {
+        std::unordered_set<uint64_t> pairs;
+        size_t until = 0;
+        std::vector<uint32_t> path;  // Of the scan in progress, the state after every byte
+    };
+
+    // The length of the longest match at start ending by lastEnd, or 0 if there is none
+    size_t longestMatchAt(std::string_view input, size_t start, size_t lastEnd, DeadEnds& deadEnds) const {
+        if (start >= deadEnds.until && !deadEnds.pairs.empty()) {
+            std::unordered_set<uint64_t>().swap(deadEnds.pairs);
+        }
+        const uint64_t stateCount = dfa.getStateCount();
+        uint32_t state = dfa.getStartState();
+        size_t lastAccept = start;
+        deadEnds.path.clear();
+        for (size_t position = start; position < lastEnd;) {
+            state = dfa.getTransition(state, static_cast<unsigned char>(input[position++]));
+            if (state == CompiledDFA::DEAD_STATE ||
+                (position < deadEnds.until && deadEnds.pairs.count(position * stateCount + state))) {
+                break;
+            }
+            deadEnds.path.push_back(state);
+            if (dfa.isAccept(state)) {
+                lastAccept = position;
+            }
+        }
+
+        for (size_t i = lastAccept - start; i < deadEnds.path.size(); ++i) {
+            deadEnds.pairs.insert((start + 1 + i) * stateCount + deadEnds.path[i]);
+        }
+        deadEnds.until = std::max(deadEnds.until, start + 1 + deadEnds.path.size());
+        return lastAccept - start;
+    }
+
+    static CompiledDFA compile(const NFA& nfa) {
+        return CompiledDFA(AutomataTransformations::minimize_dfa(AutomataTransformations::nfa_to_dfa(nfa)));
+    }
+
+    // Steps an unanchored DFA, which restarts on a NUL byte since no match spans one
+    static uint32_t step(const CompiledDFA& scanner, uint32_t state, unsigned char byte) {
+        return byte == 0 ? scanner.getStartState() : scanner.getTransition(state, byte);
+    }
+
+    // The first position after from at which a match starting at or after from ends, or NO_MATCH if there is none
+    [[nodiscard]] size_t firstMatchEnd(std::string_view input, size_t from) const {
+        const uint32_t start = forwardDFA.getStartState();
+        uint32_t state = start;
+        for (size_t position = from; position < input.size();) {
+            auto byte = static_cast<unsigned char>(input[position]);
+            if (state == start && !prefilter.mayStartWith(byte)) {
+                if ((position = prefilter.find(input, position)) == input.size()) break;
+                byte = static_cast<unsigned char>(input[position]);
+            }
+            state = step(forwardDFA, state, byte);
+            position++;
+            if (forwardDFA.isAccept(state)) {
+                return position;
+            }
+        }
+        return CompiledDFA::NO_MATCH;
+    }
+
+    // The first position from on at which a match ending by end starts, given that one does
+    [[nodiscard]] size_t firstMatchStart(std::string_view input, size_t from, size_t end) const {
+        uint32_t state = reverseDFA.getStartState();
+        size_t first = end;
+        for (size_t position = end; position > from;) {
+            state = step(reverseDFA, state, static_cast<unsigned char>(input[--position]));
+            if (reverseDFA.isAccept(state)) {
+                first = position;
+            }
+        }
+        return first;
+    }
+
+    // A bit for every position in [0, input.size()] at which some match ends
+    [[nodiscard]] std::vector<uint64_t> matchEnds(std::string_view input) const {
+        std::vector<uint64_t> ends(input.size() / 64 + 1, 0);
+        const uint32_t start = forwardDFA.getStartState();
+        if (forwardDFA.isAccept(start)) {
+            ends[0] |= 1;
+        }
+        uint32_t state = start;
+        for (size_t position = 0; position < input.size();) {
+            auto byte = static_cast<unsigned char>(input[position]);
+            if (state == start && !prefilter.mayStartWith(byte)) {
+                if ((position = prefilter.find(input, position)) == input.size()) break;
+                byte = static_cast<unsigned char>(input[position]);
+            }
+            state = step(forwardDFA, state, byte);
+            position++;
+            if (forwardDFA.isAccept(state)) {
+                ends[position / 64] |= uint64_t{1} << (position % 64);
+            }
+        }
+        return ends;
+    }
+
+    // A bit for every position in [0, lastEnd] at which some match starts
+    [[nodiscard]] std::vector<uint64_t> matchStarts(std::string_view input, const std::vector<uint64_t>& ends,
+                                                    size_t lastEnd) const {
+        std::vector<uint64_t> starts(lastEnd / 64 + 1, 0);
+        const uint32_t start = reverseDFA.getStartState();
+        uint32_t state = start;
+        for (size_t position = lastEnd;;) {
+            if (state == start && (position = previousMark(ends, position)) == CompiledDFA::NO_MATCH) break;
+            if (reverseDFA.isAccept(state)) {
+                starts[position / 64] |= uint64_t{1} << (position % 64);
+            }
+            if (position == 0) break;
+            state = step(reverseDFA, state, static_cast<unsigned char>(input[--position]));
+        }
+        return starts;
+    }
+
+    // The first marked position from on, or NO_MATCH if there is none
+    static size_t nextMark(const std::vector<uint64_t>& marks, size_t from) {
+        size_t word = from / 64;
+        if (word >= marks.size()) return CompiledDFA::NO_MATCH;
+        uint64_t bits = marks[word] & (~uint64_t{0} << (from % 64));
+        while (bits == 0) {
+            if (++word == marks.size()) return CompiledDFA::NO_MATCH;
+            bits = marks[word];
+        }
+        return word * 64 + static_cast<size_t>(std::countr_zero(bits));
+    }
+
+    // The last marked position up to from, or NO_MATCH if there is none
+    static size_t previousMark(const std::vector<uint64_t>& marks, size_t from) {
+        size_t word = from / 64;
+        uint64_t bits = marks[word] & (~uint64_t{0} >> (63 - from % 64));
+        while (bits == 0) {
+            if (word == 0) return CompiledDFA::NO_MATCH;
+            bits = marks[--word];
+        }
+        return word * 64 + 63 - static_cast<size_t>(std::countl_zero(bits));
+    }
+};
+
+
+#endif //SYPHON_SEARCHER_H
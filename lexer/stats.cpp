@@ -0,0 +1,35 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#include "stats.h"
+
+#ifdef SYPHON_STATS
+#include <cstdlib>
+#include <new>
+
+// Counting replacements of operator new, weak so a program's own replacements take precedence
+namespace {
+    void* allocate(size_t size) noexcept {
+        Stats::recordAllocation(size);
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void* allocateOrThrow(size_t size) {
+        void* pointer = allocate(size);
+        if (!pointer) throw std::bad_alloc();
+        return pointer;
+    }
+}
+
+__attribute__((weak)) void* operator new(size_t size) { return allocateOrThrow(size); }
+__attribute__((weak)) void* operator new[](size_t size) { return allocateOrThrow(size); }
+__attribute__((weak)) void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+__attribute__((weak)) void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+__attribute__((weak)) void operator delete(void* pointer) noexcept { std::free(pointer); }
+__attribute__((weak)) void operator delete[](void* pointer) noexcept { std::free(pointer); }
+__attribute__((weak)) void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+__attribute__((weak)) void operator delete[](void* pointer, size_t) noexcept { std::free(pointer); }
+__attribute__((weak)) void operator delete(void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+__attribute__((weak)) void operator delete[](void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+#endif
@@ -0,0 +1,274 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_STATS_H
+#define SYPHON_STATS_H
+
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Counters for where construction and matching spend their time and memory. Collection is opt-in twice: the hooks
+// are compiled in only when SYPHON_STATS is defined, by the CMake option of the same name, and even then only count
+// while a Stats::Collector is alive on the calling thread. Without SYPHON_STATS every hook is an empty inline function
+// and the Collector does nothing, so code using this API builds either way.
+//
+// With SYPHON_STATS, stats.cpp also counts the bytes each thread allocates through operator new, to charge them to the
+// phase running. Its operators are weak, so a program that replaces operator new keeps its own and can call
+// recordAllocation itself.
+namespace Stats {
+#ifdef SYPHON_STATS
+    inline constexpr bool ENABLED = true;
+#else
+    inline constexpr bool ENABLED = false;
+#endif
+
+    // Wall time and heap bytes allocated over every run of one phase
+    struct Phase {
+        size_t runs = 0;
+        double seconds = 0;
+        size_t bytesAllocated = 0;
+    };
+
+    // Filled in by RegexToNFA, AutomataTransformations::nfa_to_dfa and minimize_dfa. Sizes are those of the last
+    // automaton built, counters add up over everything built while collecting.
+    struct Construction {
+        size_t nfaStates = 0;
+        size_t nfaEdges = 0;             // Byte and range edges, and epsilon edges
+        size_t dfaStates = 0;            // Before minimization
+        size_t minimizedStates = 0;
+        size_t epsilonClosures = 0;      // Closures computed by SubsetConstruction, one per NFA state
+        size_t subsetLookups = 0;        // State sets looked up while interning DFA states
+        size_t subsetHits = 0;           // Lookups that found an existing DFA state
+        size_t refinementIterations = 0; // Splitters taken off the Hopcroft worklist
+        Phase regexToNFA;
+        Phase subsetConstruction;
+        Phase minimization;
+
+        [[nodiscard]] std::string toJSON() const;
+    };
+
+    // Filled in by the matching loops of CompiledDFA
+    struct Matching {
+        std::vector<uint64_t> stateVisits;  // Times every state was entered, by CompiledDFA state, the dead state excluded
+        size_t scans = 0;
+        size_t bytes = 0;                   // Bytes stepped over, one per transition
+        size_t deadStateExits = 0;          // Scans that stopped early on the dead state
+
+        [[nodiscard]] std::string toJSON() const;
+    };
+
+#ifdef SYPHON_STATS
+    namespace Detail {
+        inline thread_local Construction* construction = nullptr;
+        inline thread_local Matching* matching = nullptr;
+        inline thread_local const Phase* runningPhase = nullptr;
+        inline thread_local size_t allocatedBytes = 0;
+    }
+#endif
+
+    // Collects into stats on the calling thread for as long as it lives. Collectors nest, the innermost one counting.
+    class Collector {
+    public:
+        explicit Collector(Construction& stats) {
+#ifdef SYPHON_STATS
+            previousConstruction = Detail::construction;
+            previousMatching = Detail::matching;
+            Detail::construction = &stats;
+#else
+            (void) stats;
+#endif
+        }
+
+        explicit Collector(Matching& stats) {
+#ifdef SYPHON_STATS
+            previousConstruction = Detail::construction;
+            previousMatching = Detail::matching;
+            Detail::matching = &stats;
+#else
+            (void) stats;
+#endif
+        }
+
+        Collector(const Collector&) = delete;
+        Collector& operator=(const Collector&) = delete;
+
+        ~Collector() {
+#ifdef SYPHON_STATS
+            Detail::construction = previousConstruction;
+            Detail::matching = previousMatching;
+#endif
+        }
+
+    private:
+#ifdef SYPHON_STATS
+        Construction* previousConstruction;
+        Matching* previousMatching;
+#endif
+    };
+
+    inline void recordAllocation(size_t bytes) {
+#ifdef SYPHON_STATS
+        Detail::allocatedBytes += bytes;
+#else
+        (void) bytes;
+#endif
+    }
+
+    // Bytes allocated by the calling thread so far, as counted by recordAllocation
+    [[nodiscard]] inline size_t allocatedBytes() {
+#ifdef SYPHON_STATS
+        return Detail::allocatedBytes;
+#else
+        return 0;
+#endif
+    }
+
+    inline void add(size_t Construction::* counter, size_t amount = 1) {
+#ifdef SYPHON_STATS
+        if (Detail::construction) Detail::construction->*counter += amount;
+#else
+        (void) counter;
+        (void) amount;
+#endif
+    }
+
+    inline void set(size_t Construction::* counter, size_t value) {
+#ifdef SYPHON_STATS
+        if (Detail::construction) Detail::construction->*counter = value;
+#else
+        (void) counter;
+        (void) value;
+#endif
+    }
+
+    // Times a construction phase from its creation to its destruction. A phase entered again from within itself, as
+    // RegexToNFA::fromRegex does through fromPostfix, is timed once.
+    class PhaseTimer {
+    public:
+        explicit PhaseTimer(Phase Construction::* phase) {
+#ifdef SYPHON_STATS
+            if (!Detail::construction || Detail::runningPhase == &(Detail::construction->*phase)) return;
+            running = &(Detail::construction->*phase);
+            previousPhase = Detail::runningPhase;
+            Detail::runningPhase = running;
+            startBytes = Detail::allocatedBytes;
+            startTime = std::chrono::steady_clock::now();
+#else
+            (void) phase;
+#endif
+        }
+
+        PhaseTimer(const PhaseTimer&) = delete;
+        PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+        ~PhaseTimer() {
+#ifdef SYPHON_STATS
+            if (!running) return;
+            running->runs++;
+            running->seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            running->bytesAllocated += Detail::allocatedBytes - startBytes;
+            Detail::runningPhase = previousPhase;
+#endif
+        }
+
+    private:
+#ifdef SYPHON_STATS
+        Phase* running = nullptr;
+        const Phase* previousPhase = nullptr;
+        size_t startBytes = 0;
+        std::chrono::steady_clock::time_point startTime;
+#endif
+    };
+
+#ifdef SYPHON_STATS
+    namespace Detail {
+        inline void countVisit(uint32_t state) {
+            auto& visits = matching->stateVisits;
+            if (state >= visits.size()) visits.resize(state + 1, 0);
+            visits[state]++;
+        }
+    }
+#endif
+
+    // Matching hooks, called for every state entered, once per scan as it enters its start state, and for every scan
+    // that runs into the dead state
+    inline void scan(uint32_t startState) {
+#ifdef SYPHON_STATS
+        if (!Detail::matching) return;
+        Detail::matching->scans++;
+        Detail::countVisit(startState);
+#else
+        (void) startState;
+#endif
+    }
+
+    inline void visit(uint32_t state) {
+#ifdef SYPHON_STATS
+        if (!Detail::matching) return;
+        Detail::matching->bytes++;
+        Detail::countVisit(state);
+#else
+        (void) state;
+#endif
+    }
+
+    inline void deadStateExit() {
+#ifdef SYPHON_STATS
+        if (!Detail::matching) return;
+        Detail::matching->bytes++;
+        Detail::matching->deadStateExits++;
+#endif
+    }
+
+    namespace Detail {
+        inline void appendPhase(std::string& json, const char* name, const Phase& phase) {
+            char seconds[32];
+            std::snprintf(seconds, sizeof(seconds), "%.9g", phase.seconds);
+            json += "\"";
+            json += name;
+            json += "\":{\"runs\":" + std::to_string(phase.runs) + ",\"seconds\":" + seconds +
+                    ",\"bytes_allocated\":" + std::to_string(phase.bytesAllocated) + "}";
+        }
+    }
+
+    inline std::string Construction::toJSON() const {
+        std::string json = "{\"enabled\":" + std::string(ENABLED ? "true" : "false") +
+                           ",\"nfa_states\":" + std::to_string(nfaStates) +
+                           ",\"nfa_edges\":" + std::to_string(nfaEdges) +
+                           ",\"dfa_states\":" + std::to_string(dfaStates) +
+                           ",\"minimized_states\":" + std::to_string(minimizedStates) +
+                           ",\"epsilon_closures\":" + std::to_string(epsilonClosures) +
+                           ",\"subset_lookups\":" + std::to_string(subsetLookups) +
+                           ",\"subset_hits\":" + std::to_string(subsetHits) +
+                           ",\"refinement_iterations\":" + std::to_string(refinementIterations) + ",\"phases\":{";
+        Detail::appendPhase(json, "regex_to_nfa", regexToNFA);
+        json += ",";
+        Detail::appendPhase(json, "subset_construction", subsetConstruction);
+        json += ",";
+        Detail::appendPhase(json, "minimization", minimization);
+        json += "}}";
+        return json;
+    }
+
+    inline std::string Matching::toJSON() const {
+        std::string json = "{\"enabled\":" + std::string(ENABLED ? "true" : "false") +
+                           ",\"scans\":" + std::to_string(scans) +
+                           ",\"bytes\":" + std::to_string(bytes) +
+                           ",\"dead_state_exits\":" + std::to_string(deadStateExits) + ",\"state_visits\":[";
+        for (size_t state = 0; state < stateVisits.size(); ++state) {
+            if (state > 0) json += ",";
+            json += std::to_string(stateVisits[state]);
+        }
+        json += "]}";
+        return json;
+    }
+}
+
+
+#endif //SYPHON_STATS_H
@@ -0,0 +1,211 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_SUBSETCONSTRUCTION_H
+#define SYPHON_SUBSETCONSTRUCTION_H
+
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "automata.h"
+#include "byteClasses.h"
+#include "frozenNFA.h"
+#include "stats.h"
+
+// Hashes a sorted set of dense NFA state ids, so state sets can be interned in an unordered_map
+struct StateSetHash {
+    size_t operator()(const std::vector<int>& set) const {
+        uint64_t hash = 1469598103934665603ull;
+        for (int state : set) {
+            hash ^= static_cast<uint32_t>(state);
+            hash *= 1099511628211ull;
+        }
+        return static_cast<size_t>(hash ^ (hash >> 32));
+    }
+};
+
+// Everything the subset construction needs from an NFA, precomputed once. The bytes are split into classes that every
+// state treats alike, and for every state and class the epsilon closure of the move is stored, so the successor of a
+// state set is just a union of precomputed sets. State sets are sorted vectors of the dense ids of a FrozenNFA.
+class SubsetConstruction {
+public:
+    explicit SubsetConstruction(const NFA& nfa) : SubsetConstruction(FrozenNFA(nfa)) {}
+
+    explicit SubsetConstruction(const FrozenNFA& nfa) : stateCount(nfa.getStateCount()) {
+        if (nfa.empty()) {
+            return;
+        }
+
+        acceptRules.assign(stateCount, NO_RULE);
+        for (int state = 0; state < stateCount; ++state) {
+            acceptRules[state] = nfa.getAcceptRule(state);
+        }
+
+        // Split the bytes into classes. A state splits a class when it sends some of its bytes to one set of states
+        // and the rest elsewhere.
+        byteClasses = ByteClasses::fromNFA(nfa);
+        classCount = byteClasses.getClassCount();
+        classSymbolLists.assign(classCount, {});
+        for (int byte = 0; byte < 256; ++byte) {
+            classSymbolLists[byteClasses.classOf(static_cast<unsigned char>(byte))].push_back(static_cast<char>(byte));
+        }
+
+        // Epsilon closures of every state, computed once
+        std::vector<std::vector<int>> closures(stateCount);
+        std::vector<int> seen(stateCount, -1);
+        std::vector<int> stack;
+        for (int state = 0; state < stateCount; ++state) {
+            auto& closure = closures[state];
+            closure.push_back(state);
+            seen[state] = state;
+            stack.push_back(state);
+            while (!stack.empty()) {
+                int current = stack.back();
+                stack.pop_back();
+                for (uint32_t next : nfa.getEpsilonTargets(current)) {
+                    if (seen[next] != state) {
+                        seen[next] = state;
+                        closure.push_back(static_cast<int>(next));
+                        stack.push_back(static_cast<int>(next));
+                    }
+                }
+            }
+            std::sort(closure.begin(), closure.end());
+        }
+        Stats::add(&Stats::Construction::epsilonClosures, static_cast<size_t>(stateCount));
+        startClosure = closures[nfa.getStartState()];
+
+        // For every state and class, the closure of everything reachable on that class. Each edge adds its target to
+        // the classes its bytes fall in.
+        moveStart.assign(stateCount + 1, 0);
+        std::vector<std::vector<int>> classTargets(classCount);
+        std::vector<int> touchedClasses;
+        std::vector<int> targetSet;
+        std::vector<size_t> classEdge(classCount, SIZE_MAX);
+        size_t edgeIndex = 0;
+        for (int state = 0; state < stateCount; ++state) {
+            moveStart[state] = static_cast<int>(moves.size());
+            touchedClasses.clear();
+            for (const auto& edge : nfa.getEdges(state)) {
+                for (int byte = edge.low; byte <= edge.high; ++byte) {
+                    int symbolClass = byteClasses.classOf(static_cast<unsigned char>(byte));
+                    if (classEdge[symbolClass] == edgeIndex) continue;
+                    classEdge[symbolClass] = edgeIndex;
+                    if (classTargets[symbolClass].empty()) touchedClasses.push_back(symbolClass);
+                    classTargets[symbolClass].push_back(static_cast<int>(edge.target));
+                }
+                edgeIndex++;
+            }
+
+            std::sort(touchedClasses.begin(), touchedClasses.end());
+            for (int symbolClass : touchedClasses) {
+                targetSet.clear();
+                for (int target : classTargets[symbolClass]) {
+                    targetSet.insert(targetSet.end(), closures[target].begin(), closures[target].end());
+                }
+                classTargets[symbolClass].clear();
+                std::sort(targetSet.begin(), targetSet.end());
+                targetSet.erase(std::unique(targetSet.begin(), targetSet.end()), targetSet.end());
+
+                moves.push_back({symbolClass, static_cast<int>(movePool.size()), static_cast<int>(targetSet.size())});
+                movePool.insert(movePool.end(), targetSet.begin(), targetSet.end());
+            }
+        }
+        moveStart[stateCount] = static_cast<int>(moves.size());
+    }
+
+    [[nodiscard]] bool empty() const {
+        return stateCount == 0;
+    }
+
+    // The epsilon closure of the NFA start state
+    [[nodiscard]] const std::vector<int>& startSet() const {
+        return startClosure;
+    }
+
+    [[nodiscard]] bool containsAccept(const std::vector<int>& set) const {
+        return std::any_of(set.begin(), set.end(), [this](int state) { return acceptRules[state] != NO_RULE; });
+    }
+
+    // The highest priority (lowest) rule accepted by a state set, or NO_RULE
+    [[nodiscard]] int ruleOf(const std::vector<int>& set) const {
+        int rule = NO_RULE;
+        for (int state : set) {
+            if (acceptRules[state] != NO_RULE && (rule == NO_RULE || acceptRules[state] < rule)) {
+                rule = acceptRules[state];
+            }
+        }
+        return rule;
+    }
+
+    [[nodiscard]] int getClassCount() const {
+        return classCount;
+    }
+
+    [[nodiscard]] int classOf(unsigned char symbol) const {
+        return byteClasses.classOf(symbol);
+    }
+
+    [[nodiscard]] const ByteClasses& getByteClasses() const {
+        return byteClasses;
+    }
+
+    [[nodiscard]] const std::vector<char>& classSymbols(int symbolClass) const {
+        return classSymbolLists[symbolClass];
+    }
+
+    // Computes the successor of a state set for every class at once. successors must hold getClassCount() sets,
+    // which are expected to be empty and are left empty for classes without a transition.
+    void moveAll(const std::vector<int>& set, std::vector<std::vector<int>>& successors) const {
+        for (int state : set) {
+            for (int i = moveStart[state]; i < moveStart[state + 1]; ++i) {
+                const Move& move = moves[i];
+                successors[move.symbolClass].insert(successors[move.symbolClass].end(),
+                                                    movePool.begin() + move.offset,
+                                                    movePool.begin() + move.offset + move.length);
+            }
+        }
+        for (auto& successor : successors) {
+            std::sort(successor.begin(), successor.end());
+            successor.erase(std::unique(successor.begin(), successor.end()), successor.end());
+        }
+    }
+
+    // Computes the successor of a state set for a single class into out
+    void move(const std::vector<int>& set, int symbolClass, std::vector<int>& out) const {
+        out.clear();
+        for (int state : set) {
+            for (int i = moveStart[state]; i < moveStart[state + 1]; ++i) {
+                const Move& move = moves[i];
+                if (move.symbolClass == symbolClass) {
+                    out.insert(out.end(), movePool.begin() + move.offset, movePool.begin() + move.offset + move.length);
+                    break;
+                }
+            }
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+
+private:
+    struct Move {
+        int symbolClass;
+        int offset;
+        int length;
+    };
+
+    int stateCount;
+    std::vector<int> acceptRules;
+    ByteClasses byteClasses;
+    int classCount = 1;
+    std::vector<std::vector<char>> classSymbolLists;
+    std::vector<int> startClosure;
+    std::vector<int> moveStart;
+    std::vector<Move> moves;
+    std::vector<int> movePool;
+};
+
+
+#endif //SYPHON_SUBSETCONSTRUCTION_H
@@ -0,0 +1,352 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_TAGGEDDFA_H
+#define SYPHON_TAGGEDDFA_H
+
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "automata.h"
+#include "byteClasses.h"
+#include "frozenNFA.h"
+#include "regexToNFA.h"
+#include "subsetConstruction.h"
+
+// The span of a capture group, or UNSET if the group took no part in the match
+struct Capture {
+    static constexpr size_t UNSET = std::string_view::npos;
+
+    size_t offset;
+    size_t length;
+
+    bool operator==(const Capture& other) const = default;
+};
+
+// A DFA that reports the capture groups of the longest match in the same pass that finds it, after Laurikari's tagged
+// DFA. Its states are the ordered thread lists of a Pike VM, so threads keep the preference of a backtracking
+// matcher: the left side of an alternation and more repetitions first. Every thread has a register per tag, holding
+// the position the tag was last taken at on the thread's path, and a transition carries the register operations that
+// take the threads of one state to those of the next: a copy where a thread descends from a thread at another index,
+// and the current position where its path takes a tag. Copies are ordered so that none overwrites a register another
+// one still reads, with a spare register for cycles.
+//
+// Among the threads accepting the longest match, captures come from the first of the lowest rule, the same rule a
+// DFA from nfa_to_dfa accepts for.
+class TaggedDFA {
+public:
+    static constexpr uint32_t DEAD_STATE = 0;
+    static constexpr size_t NO_MATCH = std::string_view::npos;
+
+    // Scratch space for a scan. Passing the same registers to every scan keeps matching from allocating.
+    using Registers = std::vector<size_t>;
+
+    // The tagged DFA for the union of rules, as Lexer builds it
+    explicit TaggedDFA(const std::vector<std::string>& rules) {
+        FrozenNFA nfa = RegexToNFA::frozenFromRules(rules, &captureNames);
+        build(nfa);
+    }
+
+    // The tagged DFA for an NFA from RegexToNFA::frozenFromRules, with the capture group names it gave
+    TaggedDFA(const FrozenNFA& nfa, std::vector<std::vector<std::string>> captureNames)
+            : captureNames(std::move(captureNames)) {
+        build(nfa);
+    }
+
+    // Returns the length of the longest accepted prefix of the input, or NO_MATCH. On a match, rule is the rule it
+    // accepts for and captures holds the span of every capture group of that rule.
+    size_t longestPrefix(std::string_view input, int& rule, std::vector<Capture>& captures,
+                         Registers& registers) const {
+        rule = NO_RULE;
+        captures.clear();
+        if (startState == DEAD_STATE) {
+            return NO_MATCH;
+        }
+
+        registers.resize(registerCount);
+        size_t* values = registers.data();
+        run(startOps.data(), startOps.data() + startOps.size(), 0, values);
+        uint32_t state = startState;
+        size_t longest = NO_MATCH;
+        if (acceptRules[state] != NO_RULE) {
+            longest = 0;
+            saveCaptures(state, values, rule, captures);
+        }
+
+        const uint8_t* classes = byteClasses.getTable().data();
+        for (size_t i = 0; i < input.size(); ++i) {
+            size_t cell = state * columnCount + classes[static_cast<unsigned char>(input[i])];
+            uint32_t next = transitions[cell];
+            if (next == DEAD_STATE) {
+                break;
+            }
+            run(ops.data() + opStart[cell], ops.data() + opStart[cell + 1], i + 1, values);
+            state = next;
+            if (acceptRules[state] != NO_RULE) {
+                longest = i + 1;
+                saveCaptures(state, values, rule, captures);
+            }
+        }
+        return longest;
+    }
+
+    size_t longestPrefix(std::string_view input, int& rule, std::vector<Capture>& captures) const {
+        Registers registers;
+        return longestPrefix(input, rule, captures, registers);
+    }
+
+    // The names of a rule's capture groups, in the order their captures are reported
+    [[nodiscard]] const std::vector<std::string>& getCaptureNames(int rule) const {
+        return captureNames[rule];
+    }
+
+    // Number of states, including the dead state
+    [[nodiscard]] size_t getStateCount() const {
+        return stateCount;
+    }
+
+    [[nodiscard]] size_t getRegisterCount() const {
+        return registerCount;
+    }
+
+    // Register operations over all transitions
+    [[nodiscard]] size_t getOperationCount() const {
+        return ops.size();
+    }
+
+private:
+    // Sets register target to another register, or to the current position or UNSET
+    struct RegisterOp {
+        uint32_t target;
+        uint32_t source;
+    };
+
+    static constexpr uint32_t SOURCE_POSITION = UINT32_MAX;
+    static constexpr uint32_t SOURCE_UNSET = UINT32_MAX - 1;
+    static constexpr uint32_t SPARE_REGISTER = 0;
+
+    // An NFA state reached by a step, with the index of the thread it descends from and the tags on its path
+    struct Thread {
+        int state;
+        uint32_t source;
+        uint64_t tags;
+    };
+
+    std::vector<std::vector<std::string>> captureNames;
+    ByteClasses byteClasses;
+    size_t columnCount = 1;
+    size_t stateCount = 1;
+    uint32_t startState = DEAD_STATE;
+    size_t tagCount = 0;
+    size_t registerCount = 1;
+    std::vector<uint32_t> transitions;  // states x classes
+    std::vector<uint32_t> opStart;      // Operations of every transition, with a final offset past the end
+    std::vector<RegisterOp> ops;
+    std::vector<RegisterOp> startOps;
+    std::vector<int> acceptRules;       // Rule of every state, or NO_RULE
+    std::vector<uint32_t> acceptSlots;  // First register of the accepting thread of every accept state
+
+    static void run(const RegisterOp* op, const RegisterOp* end, size_t position, size_t* values) {
+        for (; op != end; ++op) {
+            if (op->source == SOURCE_POSITION) {
+                values[op->target] = position;
+            } else if (op->source == SOURCE_UNSET) {
+                values[op->target] = Capture::UNSET;
+            } else {
+                values[op->target] = values[op->source];
+            }
+        }
+    }
+
+    void saveCaptures(uint32_t state, const size_t* values, int& rule, std::vector<Capture>& captures) const {
+        rule = acceptRules[state];
+        size_t groups = static_cast<size_t>(rule) < captureNames.size() ? captureNames[rule].size() : 0;
+        captures.resize(groups);
+        const size_t* slot = values + acceptSlots[state];
+        for (size_t group = 0; group < groups; ++group) {
+            size_t open = slot[2 * group];
+            size_t close = slot[2 * group + 1];
+            if (open == Capture::UNSET || close == Capture::UNSET || open > close) {
+                captures[group] = {Capture::UNSET, 0};
+            } else {
+                captures[group] = {open, close - open};
+            }
+        }
+    }
+
+    void build(const FrozenNFA& nfa) {
+        transitions.assign(1, DEAD_STATE);
+        opStart.assign(1, 0);
+        acceptRules.assign(1, NO_RULE);
+        acceptSlots.assign(1, 0);
+        if (nfa.empty()) {
+            opStart.push_back(0);
+            return;
+        }
+
+        for (const auto& names : captureNames) {
+            tagCount = std::max(tagCount, 2 * names.size());
+        }
+        byteClasses = ByteClasses::fromNFA(nfa);
+        columnCount = byteClasses.getClassCount();
+        transitions.assign(columnCount, DEAD_STATE);
+        opStart.assign(columnCount, 0);
+        std::vector<unsigned char> representatives(columnCount);
+        for (int byte = 255; byte >= 0; --byte) {
+            representatives[byteClasses.classOf(static_cast<unsigned char>(byte))] = static_cast<unsigned char>(byte);
+        }
+
+        // Follows epsilon edges from a state in order of preference, collecting the states that consume bytes or
+        // accept. A state already reached in this step by a preferred path is not reached again.
+        std::vector<Thread> found;
+        std::vector<uint32_t> seen(nfa.getStateCount(), 0);
+        uint32_t step = 0;
+        std::vector<std::pair<int, uint64_t>> stack;
+        auto follow = [&](int from, uint32_t source) {
+            stack.emplace_back(from, 0);
+            while (!stack.empty()) {
+                auto [state, path] = stack.back();
+                stack.pop_back();
+                if (seen[state] == step) continue;
+                seen[state] = step;
+                if (!nfa.getEdges(state).empty() || nfa.isAccept(state)) {
+                    found.push_back({state, source, path});
+                }
+                auto targets = nfa.getEpsilonTargets(state);
+                auto tags = nfa.getEpsilonTags(state);
+                for (size_t k = targets.size(); k-- > 0;) {
+                    uint64_t next = path;
+                    if (!tags.empty() && tags[k] != NO_TAG && static_cast<size_t>(tags[k]) < tagCount) {
+                        next |= uint64_t{1} << tags[k];
+                    }
+                    stack.emplace_back(static_cast<int>(targets[k]), next);
+                }
+            }
+        };
+
+        static const std::vector<int> noThreads;
+        std::unordered_map<std::vector<int>, uint32_t, StateSetHash> stateIndex;
+        std::vector<const std::vector<int>*> stateThreads = {&noThreads};
+        size_t maxThreads = 0;
+        auto intern = [&]() {
+            if (found.empty()) return DEAD_STATE;
+            std::vector<int> threads;
+            threads.reserve(found.size());
+            for (const auto& thread : found) {
+                threads.push_back(thread.state);
+            }
+            auto [it, inserted] = stateIndex.try_emplace(std::move(threads),
+                                                         static_cast<uint32_t>(stateThreads.size()));
+            if (inserted) {
+                stateThreads.push_back(&it->first);
+                maxThreads = std::max(maxThreads, found.size());
+                // The state accepts for the lowest rule of its threads, through the first thread of that rule
+                int rule = NO_RULE;
+                uint32_t acceptIndex = 0;
+                for (size_t index = 0; index < found.size(); ++index) {
+                    int threadRule = nfa.getAcceptRule(found[index].state);
+                    if (threadRule != NO_RULE && (rule == NO_RULE || threadRule < rule)) {
+                        rule = threadRule;
+                        acceptIndex = static_cast<uint32_t>(index);
+                    }
+                }
+                acceptRules.push_back(rule);
+                acceptSlots.push_back(acceptIndex);
+            }
+            return it->second;
+        };
+
+        step++;
+        follow(nfa.getStartState(), 0);
+        addOperations(found, true, startOps);
+        startState = intern();
+
+        for (uint32_t current = 1; current < stateThreads.size(); ++current) {
+            const std::vector<int>& threads = *stateThreads[current];
+            for (size_t symbolClass = 0; symbolClass < columnCount; ++symbolClass) {
+                unsigned char byte = representatives[symbolClass];
+                step++;
+                found.clear();
+                for (size_t index = 0; index < threads.size(); ++index) {
+                    for (const auto& edge : nfa.getEdges(threads[index])) {
+                        if (edge.low <= byte && byte <= edge.high) {
+                            follow(static_cast<int>(edge.target), static_cast<uint32_t>(index));
+                        }
+                    }
+                }
+                opStart.push_back(static_cast<uint32_t>(ops.size()));
+                uint32_t target = intern();
+                transitions.push_back(target);
+                if (target != DEAD_STATE) {
+                    addOperations(found, false, ops);
+                }
+            }
+        }
+        opStart.push_back(static_cast<uint32_t>(ops.size()));
+        stateCount = stateThreads.size();
+        registerCount = 1 + maxThreads * tagCount;
+
+        // Acceptance was recorded by thread index, which is now turned into the thread's first register
+        for (auto& slot : acceptSlots) {
+            slot = 1 + slot * static_cast<uint32_t>(tagCount);
+        }
+    }
+
+    // Appends the register operations that set up the threads found by a step, each thread having its registers at
+    // its index. A start state has no earlier threads to copy from, so registers its path takes no tag on are unset.
+    void addOperations(const std::vector<Thread>& threads, bool start, std::vector<RegisterOp>& out) const {
+        std::vector<RegisterOp> copies;
+        std::vector<RegisterOp> sets;
+        for (size_t index = 0; index < threads.size(); ++index) {
+            const Thread& thread = threads[index];
+            for (size_t tag = 0; tag < tagCount; ++tag) {
+                auto target = static_cast<uint32_t>(1 + index * tagCount + tag);
+                if ((thread.tags >> tag) & 1) {
+                    sets.push_back({target, SOURCE_POSITION});
+                } else if (start) {
+                    sets.push_back({target, SOURCE_UNSET});
+                } else if (thread.source != index) {
+                    copies.push_back({target, static_cast<uint32_t>(1 + thread.source * tagCount + tag)});
+                }
+            }
+        }
+        sequentialize(copies, out);
+        out.insert(out.end(), sets.begin(), sets.end());
+    }
+
+    // Orders copies that happen all at once so that no register is overwritten while another copy still reads it.
+    // When only cycles are left, one register of a cycle is saved to the spare register, which opens the cycle.
+    static void sequentialize(std::vector<RegisterOp>& copies, std::vector<RegisterOp>& out) {
+        while (!copies.empty()) {
+            bool progress = false;
+            for (size_t k = 0; k < copies.size();) {
+                uint32_t target = copies[k].target;
+                bool read = std::any_of(copies.begin(), copies.end(),
+                                        [target](const RegisterOp& op) { return op.source == target; });
+                if (read) {
+                    k++;
+                    continue;
+                }
+                out.push_back(copies[k]);
+                copies[k] = copies.back();
+                copies.pop_back();
+                progress = true;
+            }
+            if (!progress) {
+                uint32_t saved = copies.front().target;
+                out.push_back({SPARE_REGISTER, saved});
+                for (auto& op : copies) {
+                    if (op.source == saved) op.source = SPARE_REGISTER;
+                }
+            }
+        }
+    }
+};
+
+
+#endif //SYPHON_TAGGEDDFA_H
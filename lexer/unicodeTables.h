@@ -0,0 +1,85 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_UNICODETABLES_H
+#define SYPHON_UNICODETABLES_H
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// An inclusive range of code points
+struct CodePointRange {
+    uint32_t low;
+    uint32_t high;
+
+    bool operator==(const CodePointRange& other) const = default;
+};
+
+// Code point sets for the Unicode properties regexes can name with \p{...}. The tables live in unicodeTables.cpp,
+// generated by tools/generate_unicode_tables.py.
+class UnicodeTables {
+public:
+    static constexpr uint32_t MAX_CODE_POINT = 0x10FFFF;
+
+    struct Property {
+        const char* name;
+        const CodePointRange* ranges;
+        size_t size;
+    };
+
+    static const char VERSION[];
+    static const Property PROPERTIES[];
+    static const size_t PROPERTY_COUNT;
+
+    // The sorted, disjoint ranges of a property: a general category such as Lu, a major category such as L, which is
+    // the union of its subcategories, XID_Start, XID_Continue or Any. Returns nothing for an unknown name.
+    static std::vector<CodePointRange> property(std::string_view name) {
+        if (name == "Any") {
+            return {{0, MAX_CODE_POINT}};
+        }
+        std::vector<CodePointRange> ranges;
+        for (size_t i = 0; i < PROPERTY_COUNT; ++i) {
+            std::string_view propertyName = PROPERTIES[i].name;
+            bool category = name.size() == 1 && propertyName.size() == 2 && propertyName[0] == name[0];
+            if (category || propertyName == name) {
+                ranges.insert(ranges.end(), PROPERTIES[i].ranges, PROPERTIES[i].ranges + PROPERTIES[i].size);
+            }
+        }
+        normalize(ranges);
+        return ranges;
+    }
+
+    // Sorts ranges and merges the ones that overlap or touch
+    static void normalize(std::vector<CodePointRange>& ranges) {
+        std::sort(ranges.begin(), ranges.end(), [](const auto& a, const auto& b) { return a.low < b.low; });
+        size_t merged = 0;
+        for (const auto& range : ranges) {
+            if (merged > 0 && range.low <= ranges[merged - 1].high + 1) {
+                ranges[merged - 1].high = std::max(ranges[merged - 1].high, range.high);
+            } else {
+                ranges[merged++] = range;
+            }
+        }
+        ranges.resize(merged);
+    }
+
+    // Every code point not in the normalized ranges
+    static std::vector<CodePointRange> complement(const std::vector<CodePointRange>& ranges) {
+        std::vector<CodePointRange> result;
+        uint32_t next = 0;
+        for (const auto& range : ranges) {
+            if (range.low > next) result.push_back({next, range.low - 1});
+            next = range.high + 1;
+        }
+        if (next <= MAX_CODE_POINT) result.push_back({next, MAX_CODE_POINT});
+        return result;
+    }
+};
+
+
+#endif //SYPHON_UNICODETABLES_H
@@ -0,0 +1,215 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#ifndef SYPHON_UTF8SEQUENCES_H
+#define SYPHON_UTF8SEQUENCES_H
+
+
+#include <array>
+#include <map>
+#include <optional>
+#include <vector>
+#include "automata.h"
+#include "unicodeTables.h"
+
+// A run of bytes at one position of a UTF-8 sequence
+struct ByteRange {
+    unsigned char low;
+    unsigned char high;
+
+    auto operator<=>(const ByteRange& other) const = default;
+};
+
+// Splits code point ranges into sequences of byte ranges that encode them exactly in UTF-8. The sequence
+// [E1-EC][80-BF][80-BF] stands for every three byte string with one byte from each range, here U+1000 to U+CFFF.
+// A range is split where the encoded length changes, and wherever the bytes after some position do not span their
+// full range, until every piece is such a product. Surrogates cannot be encoded and are left out.
+class Utf8Sequences {
+public:
+    static constexpr size_t MAX_LENGTH = 4;
+
+    // Calls onSequence(ranges, length) for every sequence of range, in the order of the code points they encode
+    template<typename F>
+    static void forEach(CodePointRange range, F&& onSequence) {
+        std::vector<CodePointRange> pending = {range};
+        while (!pending.empty()) {
+            CodePointRange current = pending.back();
+            pending.pop_back();
+            if (current.low > current.high) continue;
+
+            // The upper piece of a split goes on the stack first, so pieces come out in order
+            if (current.low <= 0xDFFF && current.high >= 0xD800) {
+                if (current.high > 0xDFFF) pending.push_back({0xE000, current.high});
+                if (current.low < 0xD800) pending.push_back({current.low, 0xD7FF});
+                continue;
+            }
+            if (split(current, pending)) continue;
+
+            std::array<unsigned char, MAX_LENGTH> low{}, high{};
+            size_t length = encode(current.low, low.data());
+            encode(current.high, high.data());
+            std::array<ByteRange, MAX_LENGTH> ranges{};
+            for (size_t i = 0; i < length; ++i) {
+                ranges[i] = {low[i], high[i]};
+            }
+            onSequence(ranges.data(), length);
+        }
+    }
+
+    // Writes the UTF-8 encoding of a code point and returns its length
+    static size_t encode(uint32_t codePoint, unsigned char* out) {
+        if (codePoint < 0x80) {
+            out[0] = static_cast<unsigned char>(codePoint);
+            return 1;
+        }
+        if (codePoint < 0x800) {
+            out[0] = static_cast<unsigned char>(0xC0 | (codePoint >> 6));
+            out[1] = static_cast<unsigned char>(0x80 | (codePoint & 0x3F));
+            return 2;
+        }
+        if (codePoint < 0x10000) {
+            out[0] = static_cast<unsigned char>(0xE0 | (codePoint >> 12));
+            out[1] = static_cast<unsigned char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out[2] = static_cast<unsigned char>(0x80 | (codePoint & 0x3F));
+            return 3;
+        }
+        out[0] = static_cast<unsigned char>(0xF0 | (codePoint >> 18));
+        out[1] = static_cast<unsigned char>(0x80 | ((codePoint >> 12) & 0x3F));
+        out[2] = static_cast<unsigned char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out[3] = static_cast<unsigned char>(0x80 | (codePoint & 0x3F));
+        return 4;
+    }
+
+private:
+    // Splits a range that is no single sequence in two, pushing the upper piece and then the lower one
+    static bool split(CodePointRange range, std::vector<CodePointRange>& pending) {
+        for (uint32_t lengthLimit : {0x7Fu, 0x7FFu, 0xFFFFu}) {
+            if (range.low <= lengthLimit && lengthLimit < range.high) {
+                pending.push_back({lengthLimit + 1, range.high});
+                pending.push_back({range.low, lengthLimit});
+                return true;
+            }
+        }
+        if (range.high < 0x80) return false;
+
+        // Below the bytes that differ, the low end must start its continuation bytes at 80 and the high end end at BF
+        for (uint32_t bits = 6; bits < 24; bits += 6) {
+            uint32_t mask = (1u << bits) - 1;
+            if ((range.low & ~mask) == (range.high & ~mask)) continue;
+            if ((range.low & mask) != 0) {
+                pending.push_back({(range.low | mask) + 1, range.high});
+                pending.push_back({range.low, range.low | mask});
+                return true;
+            }
+            if ((range.high & mask) != mask) {
+                pending.push_back({range.high & ~mask, range.high});
+                pending.push_back({range.low, (range.high & ~mask) - 1});
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Adds the automaton for a set of UTF-8 sequences to an NFAArena, from a start to an end state. Sequences are added in
+// increasing order and build a trie, whose nodes are frozen as soon as no later sequence can extend them. Frozen nodes
+// with the same transitions are merged, so suffixes such as the [80-BF] tails are shared as well as prefixes. The
+// result is the minimal acyclic automaton for the sequences, with one edge per byte range.
+class Utf8Compiler {
+public:
+    Utf8Compiler(NFAArena& arena, int start, int end) : arena(arena), start(start), end(end), uncompiled(1) {}
+
+    void add(CodePointRange range) {
+        Utf8Sequences::forEach(range, [this](const ByteRange* ranges, size_t length) {
+            add(ranges, length);
+        });
+    }
+
+    // Adds a sequence, which must come after every sequence added before it
+    void add(const ByteRange* ranges, size_t length) {
+        size_t prefix = 0;
+        while (prefix < length && prefix < uncompiled.size() && uncompiled[prefix].last == ranges[prefix]) {
+            prefix++;
+        }
+        if (prefix == length) return;
+
+        compileFrom(prefix);
+        uncompiled.back().last = ranges[prefix];
+        for (size_t i = prefix + 1; i < length; ++i) {
+            uncompiled.push_back({{}, ranges[i]});
+        }
+    }
+
+    // Freezes what is left of the trie and adds the transitions of its root to the start state
+    void finish() {
+        compileFrom(0);
+        for (const auto& transition : uncompiled.front().transitions) {
+            addEdge(start, transition);
+        }
+        uncompiled.assign(1, {});
+    }
+
+private:
+    struct Transition {
+        ByteRange range;
+        int next;
+
+        auto operator<=>(const Transition& other) const = default;
+    };
+
+    // A trie node on the path of the last sequence. last is the edge to the next node on the path, or to the end state
+    // for the deepest node, and is only added to transitions once the node after it is frozen.
+    struct Node {
+        std::vector<Transition> transitions;
+        std::optional<ByteRange> last;
+    };
+
+    NFAArena& arena;
+    int start;
+    int end;
+    std::vector<Node> uncompiled;
+    std::map<std::vector<Transition>, int> frozen;
+
+    // Freezes the nodes deeper than from, deepest first
+    void compileFrom(size_t from) {
+        int next = end;
+        while (from + 1 < uncompiled.size()) {
+            Node node = std::move(uncompiled.back());
+            uncompiled.pop_back();
+            freezeLast(node, next);
+            next = compile(node.transitions);
+        }
+        freezeLast(uncompiled.back(), next);
+    }
+
+    static void freezeLast(Node& node, int next) {
+        if (node.last) {
+            node.transitions.push_back({*node.last, next});
+            node.last.reset();
+        }
+    }
+
+    // The state for a frozen node, shared by every node with the same transitions
+    int compile(const std::vector<Transition>& transitions) {
+        auto [it, inserted] = frozen.try_emplace(transitions, 0);
+        if (inserted) {
+            it->second = arena.addState();
+            for (const auto& transition : transitions) {
+                addEdge(it->second, transition);
+            }
+        }
+        return it->second;
+    }
+
+    void addEdge(int from, const Transition& transition) {
+        if (transition.range.low == transition.range.high) {
+            arena.addEdge(from, static_cast<char>(transition.range.low), transition.next);
+        } else {
+            arena.addRangeEdge(from, transition.range.low, transition.range.high, transition.next);
+        }
+    }
+};
+
+
+#endif //SYPHON_UTF8SEQUENCES_H
@@ -0,0 +1,5 @@
+# Keywords and identifiers over a small alphabet, used to test precompiled lexers
+IF      if
+ELSE    else
+IDENT   [a-fils]+
+SPACE   z+
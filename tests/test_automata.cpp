@@ -1,7 +1,52 @@
 #include <gtest/gtest.h>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <set>
 #include "automata.h"
 #include "regexToNFA.h"
 #include "automataTransformations.h"
+#include "byteClasses.h"
+#include "codeGenerator.h"
+#include "compiledDFA.h"
+#include "dfaLayout.h"
+#include "frozenNFA.h"
+#include "hybridDFA.h"
+#include "keywordTable.h"
+#include "lazyDFA.h"
+#include "dfaFile.h"
+#include "lexer.h"
+#include "lexerSpec.h"
+#include "lexerStream.h"
+#include "nfaMatcher.h"
+#include "parallelConstruction.h"
+#include "parallelScan.h"
+#include "prefilter.h"
+#include "searcher.h"
+#include "stats.h"
+#include "taggedDFA.h"
+#include "unicodeTables.h"
+#include "utf8Sequences.h"
+#include "keywordsDirect.h"
+#include "keywordsTable.h"
+#include "keywordsHashed.h"
+
+// Reference NFA simulation, stepping whole state sets
+static bool simulateNFA(const NFA& nfa, const std::string& input) {
+    std::set<int> current = nfa.epsilonClosure(nfa.getStartState());
+    for (char c : input) {
+        std::set<int> next;
+        for (int state : current) {
+            std::set<int> closure = nfa.epsilonClosure(nfa.move(state, static_cast<unsigned char>(c)));
+            next.insert(closure.begin(), closure.end());
+        }
+        current = next;
+    }
+    return std::any_of(current.begin(), current.end(), [&nfa](int state) {
+        return nfa.getAcceptState().count(state) > 0;
+    });
+}
 
 // DFA Tests
 TEST(DFATest, AddTransition) {
@@ -37,6 +82,238 @@ TEST(NFATest, EpsilonClosure) {
 }
 
 // RegexToNFA Tests
+TEST(RegexToNFATest, ConcatenationStarAndUnion) {
+    CompiledDFA compiled(AutomataTransformations::nfa_to_dfa(RegexToNFA::fromRegex("(a|b)*abb")));
+
+    EXPECT_TRUE(compiled.match("abb"));
+    EXPECT_TRUE(compiled.match("aababb"));
+    EXPECT_FALSE(compiled.match("abab"));
+    EXPECT_FALSE(compiled.match(""));
+
+    CompiledDFA starred(AutomataTransformations::nfa_to_dfa(RegexToNFA::fromRegex("ab*c|d")));
+    EXPECT_TRUE(starred.match("ac"));
+    EXPECT_TRUE(starred.match("abbbc"));
+    EXPECT_TRUE(starred.match("d"));
+    EXPECT_FALSE(starred.match("abd"));
+}
+
+TEST(RegexToNFATest, PostfixWithExplicitConcatenation) {
+    EXPECT_EQ(RegexToNFA::infixToPostfix("ab*c|d"), "ab*.c.d|");
+    EXPECT_EQ(RegexToNFA::infixToPostfix("(a|b)*a"), "ab|*a.");
+
+    NFA nfa = RegexToNFA::fromPostfix(RegexToNFA::infixToPostfix("(a|b)*a"));
+    EXPECT_EQ(nfa.getStates().size(), RegexToNFA::fromRegex("(a|b)*a").getStates().size());
+    EXPECT_TRUE(simulateNFA(nfa, "bba"));
+    EXPECT_FALSE(simulateNFA(nfa, "ab"));
+}
+
+TEST(RegexToNFATest, RejectsMalformedRegex) {
+    EXPECT_THROW(RegexToNFA::fromRegex("(ab"), std::runtime_error);
+    EXPECT_THROW(RegexToNFA::fromRegex("ab)"), std::runtime_error);
+    EXPECT_THROW(RegexToNFA::fromRegex("a|"), std::runtime_error);
+    EXPECT_THROW(RegexToNFA::fromRegex("*"), std::runtime_error);
+}
+
+static CompiledDFA compileRegex(const std::string& regex) {
+    return CompiledDFA(AutomataTransformations::minimize_dfa(AutomataTransformations::nfa_to_dfa(
+            RegexToNFA::fromRegex(regex))));
+}
+
+TEST(RegexToNFATest, ExtendedSyntax) {
+    CompiledDFA identifier = compileRegex("[a-zA-Z_][a-zA-Z0-9_]*");
+    EXPECT_TRUE(identifier.match("foo_Bar1"));
+    EXPECT_FALSE(identifier.match("1foo"));
+
+    CompiledDFA number = compileRegex("\\d+(\\.\\d+)?");
+    EXPECT_TRUE(number.match("42"));
+    EXPECT_TRUE(number.match("3.14"));
+    EXPECT_FALSE(number.match("3."));
+
+    CompiledDFA repeated = compileRegex("ab{2,3}c{2,}d{0}e?");
+    EXPECT_TRUE(repeated.match("abbcc"));
+    EXPECT_TRUE(repeated.match("abbbccccce"));
+    EXPECT_FALSE(repeated.match("abcc"));
+    EXPECT_FALSE(repeated.match("abbbbcc"));
+    EXPECT_FALSE(repeated.match("abbc"));
+    EXPECT_FALSE(repeated.match("abbccd"));
+
+    CompiledDFA escapes = compileRegex("\\x41\\*[]\\-]\\s\\W.[^\\n]");
+    EXPECT_TRUE(escapes.match("A*] +ab"));
+    EXPECT_TRUE(escapes.match("A*-\t!\x7f "));
+    EXPECT_FALSE(escapes.match("A*]\t_ab"));
+    EXPECT_FALSE(escapes.match("A*] +\na"));
+    EXPECT_FALSE(escapes.match("A*] +a\n"));
+}
+
+TEST(RegexToNFATest, CanonicalPostfix) {
+    EXPECT_EQ(RegexToNFA::infixToPostfix("[a-c_]+x?"), "[_-_a-c]+x?.");
+    EXPECT_EQ(RegexToNFA::infixToPostfix("a\\.b{3}"), "a\\..b{3,3}.");
+    EXPECT_EQ(RegexToNFA::infixToPostfix("[-]{2,}"), "\\-{2,}");
+}
+
+TEST(RegexToNFATest, CaptureGroupsBecomeTags) {
+    std::vector<std::string> names;
+    EXPECT_EQ(RegexToNFA::infixToPostfix("(?<key>a)(b(?<value>c))", &names), "<0>a.<1>.b<2>c.<3>...");
+    EXPECT_EQ(names, (std::vector<std::string>{"key", "value"}));
+
+    // To everything but TaggedDFA a capture group is a plain group
+    CompiledDFA dfa = compileRegex("(?<x>a|b)+c");
+    EXPECT_TRUE(dfa.match("abc"));
+    EXPECT_FALSE(dfa.match("c"));
+
+    std::string tooMany;
+    for (int group = 0; group <= RegexToNFA::MAX_CAPTURE_GROUPS; ++group) {
+        tooMany += "(?<g" + std::to_string(group) + ">a)";
+    }
+    for (const std::string regex : {"(?<x>a)(?<x>b)", "(?<1x>a)", "(?<>a)", "(?<x a)", "(?<x-y>a)", "(?<x>)",
+                                    tooMany.c_str()}) {
+        EXPECT_THROW(RegexToNFA::fromRegex(regex), std::runtime_error) << regex;
+    }
+}
+
+TEST(RegexToNFATest, RejectsMalformedExtendedSyntax) {
+    for (const std::string regex : {"[ab", "[]", "[z-a]", "a{2,1}", "a{1001}", "a{", "a{x}", "+a", "(?a)", "\\q",
+                                    "\\x4", "\\x00", "a\\", "^a", "a]", "[\\d-z]"}) {
+        EXPECT_THROW(RegexToNFA::fromRegex(regex), std::runtime_error) << regex;
+    }
+}
+
+TEST(RegexToNFATest, ClassesUseRangeEdges) {
+    NFA nfa = RegexToNFA::fromRegex("[^\\n]");
+    size_t symbolEdges = 0;
+    for (const auto& [key, targets] : nfa.getTransitionTable()) {
+        symbolEdges += key.second != EPSILON;
+    }
+    size_t rangeEdges = 0;
+    for (const auto& [state, ranges] : nfa.getRangeTransitions()) {
+        rangeEdges += ranges.size();
+    }
+    EXPECT_EQ(symbolEdges, 0);
+    EXPECT_EQ(rangeEdges, 2);
+    EXPECT_TRUE(simulateNFA(nfa, "x"));
+    EXPECT_FALSE(simulateNFA(nfa, "\n"));
+    EXPECT_FALSE(simulateNFA(nfa, std::string(1, '\0')));
+}
+
+TEST(RegexToNFATest, BoundedRepeatStaysSmall) {
+    NFA nfa = RegexToNFA::fromRegex("[^\\n]{1,200}");
+    // One copy of the class per repetition
+    EXPECT_LE(nfa.getStates().size(), 2 * 200 + 4);
+
+    DFA dfa = AutomataTransformations::minimize_dfa(AutomataTransformations::nfa_to_dfa(nfa));
+    EXPECT_EQ(dfa.getStates().size(), 201);
+
+    CompiledDFA compiled(dfa);
+    EXPECT_TRUE(compiled.match(std::string(200, 'x')));
+    EXPECT_FALSE(compiled.match(std::string(201, 'x')));
+    EXPECT_FALSE(compiled.match(""));
+}
+
+static std::string encodeUtf8(uint32_t codePoint) {
+    unsigned char bytes[Utf8Sequences::MAX_LENGTH];
+    size_t length = Utf8Sequences::encode(codePoint, bytes);
+    return {reinterpret_cast<const char*>(bytes), length};
+}
+
+TEST(Utf8SequencesTest, SplitsAllNonASCIICodePoints) {
+    std::vector<std::vector<std::pair<int, int>>> sequences;
+    Utf8Sequences::forEach({0x80, UnicodeTables::MAX_CODE_POINT}, [&](const ByteRange* ranges, size_t length) {
+        std::vector<std::pair<int, int>> sequence;
+        for (size_t i = 0; i < length; ++i) {
+            sequence.emplace_back(ranges[i].low, ranges[i].high);
+        }
+        sequences.push_back(sequence);
+    });
+
+    std::vector<std::vector<std::pair<int, int>>> expected = {
+            {{0xC2, 0xDF}, {0x80, 0xBF}},
+            {{0xE0, 0xE0}, {0xA0, 0xBF}, {0x80, 0xBF}},
+            {{0xE1, 0xEC}, {0x80, 0xBF}, {0x80, 0xBF}},
+            {{0xED, 0xED}, {0x80, 0x9F}, {0x80, 0xBF}},
+            {{0xEE, 0xEF}, {0x80, 0xBF}, {0x80, 0xBF}},
+            {{0xF0, 0xF0}, {0x90, 0xBF}, {0x80, 0xBF}, {0x80, 0xBF}},
+            {{0xF1, 0xF3}, {0x80, 0xBF}, {0x80, 0xBF}, {0x80, 0xBF}},
+            {{0xF4, 0xF4}, {0x80, 0x8F}, {0x80, 0xBF}, {0x80, 0xBF}},
+    };
+    EXPECT_EQ(sequences, expected);
+}
+
+TEST(RegexToNFATest, UnicodePropertiesMatchTheirCodePoints) {
+    CompiledDFA letters = compileRegex("\\p{L}");
+    CompiledDFA nonLetters = compileRegex("\\P{L}");
+    std::vector<CodePointRange> ranges = UnicodeTables::property("L");
+
+    size_t range = 0;
+    for (uint32_t codePoint = 1; codePoint <= UnicodeTables::MAX_CODE_POINT; ++codePoint) {
+        if (codePoint >= 0xD800 && codePoint <= 0xDFFF) continue;
+        while (range < ranges.size() && ranges[range].high < codePoint) range++;
+        bool isLetter = range < ranges.size() && ranges[range].low <= codePoint;
+        std::string encoded = encodeUtf8(codePoint);
+        ASSERT_EQ(letters.match(encoded), isLetter) << std::hex << codePoint;
+        ASSERT_EQ(nonLetters.match(encoded), !isLetter) << std::hex << codePoint;
+    }
+    // Surrogates and bytes that start no UTF-8 sequence never match
+    EXPECT_FALSE(compileRegex("\\p{Any}").match("\xED\xA0\x80"));
+    EXPECT_FALSE(compileRegex("\\p{Any}").match("\xFF"));
+
+    // The class compiles to the minimal automaton for its UTF-8 sequences, with few byte classes
+    DFA dfa = AutomataTransformations::nfa_to_dfa(RegexToNFA::fromRegex("\\p{L}"));
+    EXPECT_EQ(RegexToNFA::fromRegex("\\p{L}").getStates().size(), AutomataTransformations::minimize_dfa(dfa).getStates().size());
+    EXPECT_LT(letters.getColumnCount(), 128);
+}
+
+TEST(RegexToNFATest, UnicodeClassesAndCodePoints) {
+    CompiledDFA greek = compileRegex("[α-ω]+");
+    EXPECT_TRUE(greek.match("αβγω"));
+    EXPECT_FALSE(greek.match("a"));
+    EXPECT_FALSE(greek.match("\xCE"));
+
+    CompiledDFA notAlpha = compileRegex("[^α\\d]");
+    EXPECT_TRUE(notAlpha.match("β"));
+    EXPECT_TRUE(notAlpha.match("a"));
+    EXPECT_TRUE(notAlpha.match("\xF0\x9F\x98\x80"));
+    EXPECT_FALSE(notAlpha.match("α"));
+    EXPECT_FALSE(notAlpha.match("7"));
+
+    // In a class of code points \xHH stands for U+00HH, elsewhere for a byte
+    EXPECT_TRUE(compileRegex("\\u00e9\\u{1F600}[\\xe9\\u{1F600}]{2}").match("é\xF0\x9F\x98\x80\xF0\x9F\x98\x80é"));
+    EXPECT_TRUE(compileRegex("[\\xe9]").match("\xE9"));
+    EXPECT_EQ(RegexToNFA::infixToPostfix("[a<\\u{e9}-\\u{ff}]"), "[\\<-\\<a-a<e9-ff>]");
+
+    for (const std::string regex : {"\\p{Foo}", "\\p", "\\pL", "\\u12", "\\u{}", "\\u{110000}", "[\\p{L}-z]"}) {
+        EXPECT_THROW(RegexToNFA::fromRegex(regex), std::runtime_error) << regex;
+    }
+}
+
+TEST(LexerTest, UnicodeIdentifiers) {
+    Lexer lexer({{0, "\\p{XID_Start}\\p{XID_Continue}*"}, {1, "\\s+"}});
+    std::vector<Token> tokens = lexer.tokenize("naïve 変数 x1");
+    ASSERT_EQ(tokens.size(), 5);
+    EXPECT_EQ(tokens[0].length, std::string("naïve").size());
+    EXPECT_EQ(tokens[2].tokenId, 0);
+    EXPECT_EQ(tokens[2].length, std::string("変数").size());
+    EXPECT_EQ(tokens[4].length, 2);
+}
+
+TEST(RegexToNFATest, LargeRegexStaysLinear) {
+    // 100 KB of (word|word|...)* alternations
+    std::string regex = "(";
+    std::mt19937 rng(7);
+    while (regex.size() < 100000) {
+        if (regex.size() > 1) regex += '|';
+        for (int i = 0; i < 8; ++i) {
+            regex += static_cast<char>('a' + rng() % 26);
+        }
+    }
+    regex += ")*";
+
+    NFA nfa = RegexToNFA::fromRegex(regex);
+
+    // Two states per letter plus a constant number per operator
+    EXPECT_LE(nfa.getStates().size(), 3 * regex.size());
+    EXPECT_EQ(nfa.getAcceptState().size(), 1);
+}
+
 
 // AutomataTransformations tests
 class AutomataTransformationsTest : public ::testing::Test {
@@ -121,6 +398,52 @@ TEST_F(AutomataTransformationsTest, SubsetConstructionComplexNFA) {
     EXPECT_GT(dfa.getAcceptState().size(), 0);
 }
 
+TEST_F(AutomataTransformationsTest, SubsetConstructionSharesSymbolClasses) {
+    NFA nfa;
+    nfa.setStartState(0);
+    nfa.addState(2, true);
+    nfa.addTransition(0, 'a', 1);
+    nfa.addTransition(0, 'b', 1);
+    nfa.addTransition(1, EPSILON, 3);
+    nfa.addTransition(3, 'c', 2);
+    nfa.addTransition(3, 'a', 2);
+
+    DFA dfa = AutomataTransformations::nfa_to_dfa(nfa);
+    CompiledDFA compiled(dfa);
+
+    EXPECT_EQ(dfa.getStates().size(), 3);
+    EXPECT_EQ(dfa.getTransitionTable().size(), 4);
+    EXPECT_TRUE(compiled.match("ac"));
+    EXPECT_TRUE(compiled.match("ba"));
+    EXPECT_FALSE(compiled.match("cc"));
+    EXPECT_FALSE(compiled.match("ab"));
+}
+
+TEST_F(AutomataTransformationsTest, SubsetConstructionMatchesNFASimulation) {
+    std::mt19937 rng(99);
+    NFA nfa;
+    nfa.setStartState(0);
+    const int stateCount = 30;
+    for (int state = 0; state < stateCount; ++state) {
+        nfa.addState(state, rng() % 6 == 0);
+        for (int edge = 0; edge < 3; ++edge) {
+            int symbol = static_cast<int>(rng() % 4);
+            nfa.addTransition(state, symbol == 3 ? EPSILON : static_cast<char>('a' + symbol),
+                              static_cast<int>(rng() % stateCount));
+        }
+    }
+
+    CompiledDFA compiled(AutomataTransformations::nfa_to_dfa(nfa));
+    for (int i = 0; i < 2000; ++i) {
+        std::string input;
+        size_t length = rng() % 10;
+        for (size_t j = 0; j < length; ++j) {
+            input += static_cast<char>('a' + rng() % 3);
+        }
+        EXPECT_EQ(compiled.match(input), simulateNFA(nfa, input)) << input;
+    }
+}
+
 // DFA Minimization Tests
 TEST_F(AutomataTransformationsTest, DFAMinimizationBasic) {
     DFA originalDfa = createMinimizationDFA();
@@ -159,6 +482,61 @@ TEST_F(AutomataTransformationsTest, DFAMinimizationEvenOnes) {
     EXPECT_FALSE(minimizedDfa.getAcceptState().empty());
 }
 
+TEST_F(AutomataTransformationsTest, DFAMinimizationMergesEquivalentStates) {
+    DFA minimizedDfa = AutomataTransformations::minimize_dfa(createMinimizationDFA());
+
+    // {0}, {1, 2} and {3, 4}
+    EXPECT_EQ(minimizedDfa.getStates().size(), 3);
+    EXPECT_EQ(minimizedDfa.getAcceptState().size(), 1);
+    EXPECT_EQ(minimizedDfa.getTransitionTable().size(), 4);
+}
+
+TEST_F(AutomataTransformationsTest, DFAMinimizationDropsDeadAndUnreachableStates) {
+    DFA originalDfa;
+    originalDfa.setStartState(0);
+    originalDfa.addState(1, true);
+    originalDfa.addTransition(0, 'a', 1);
+    originalDfa.addTransition(0, 'b', 2); // 2 can never reach an accept state
+    originalDfa.addTransition(2, 'a', 2);
+    originalDfa.addTransition(3, 'a', 1); // 3 is unreachable
+
+    DFA minimizedDfa = AutomataTransformations::minimize_dfa(originalDfa);
+
+    EXPECT_EQ(minimizedDfa.getStates().size(), 2);
+    EXPECT_EQ(minimizedDfa.getTransitionTable().size(), 1);
+}
+
+TEST_F(AutomataTransformationsTest, DFAMinimizationPreservesLanguage) {
+    // A random DFA over {a, b, c} with many redundant states
+    std::mt19937 rng(1234);
+    DFA originalDfa;
+    originalDfa.setStartState(0);
+    const int stateCount = 200;
+    for (int state = 0; state < stateCount; ++state) {
+        originalDfa.addState(state, rng() % 5 == 0);
+        for (char symbol : {'a', 'b', 'c'}) {
+            if (rng() % 8 != 0) {
+                originalDfa.addTransition(state, symbol, static_cast<int>(rng() % stateCount));
+            }
+        }
+    }
+
+    DFA minimizedDfa = AutomataTransformations::minimize_dfa(originalDfa);
+    EXPECT_LE(minimizedDfa.getStates().size(), originalDfa.getStates().size());
+    // Minimizing again must not find anything left to merge
+    EXPECT_EQ(AutomataTransformations::minimize_dfa(minimizedDfa).getStates().size(), minimizedDfa.getStates().size());
+
+    CompiledDFA original(originalDfa), minimized(minimizedDfa);
+    for (int i = 0; i < 2000; ++i) {
+        std::string input;
+        size_t length = rng() % 12;
+        for (size_t j = 0; j < length; ++j) {
+            input += static_cast<char>('a' + rng() % 3);
+        }
+        EXPECT_EQ(original.match(input), minimized.match(input)) << input;
+    }
+}
+
 // Edge Case Tests
 TEST_F(AutomataTransformationsTest, SubsetConstructionEmptyNFA) {
     NFA nfa;
@@ -188,6 +566,1578 @@ TEST_F(AutomataTransformationsTest, DFAMinimizationSingleState) {
     EXPECT_TRUE(minimizedDfa.getAcceptState().find(0) != minimizedDfa.getAcceptState().end());
 }
 
+// ByteClasses Tests
+TEST(ByteClassesTest, SplitSeparatesCoveredBytes) {
+    ByteClasses byteClasses;
+    EXPECT_EQ(byteClasses.getClassCount(), 1);
+
+    byteClasses.split({'a', 'b', 'c'});
+    byteClasses.split({'b', 'c', 'd'});
+
+    // {a}, {b, c}, {d} and everything else
+    EXPECT_EQ(byteClasses.getClassCount(), 4);
+    EXPECT_EQ(byteClasses.classOf('b'), byteClasses.classOf('c'));
+    EXPECT_NE(byteClasses.classOf('a'), byteClasses.classOf('b'));
+    EXPECT_NE(byteClasses.classOf('d'), byteClasses.classOf('b'));
+    EXPECT_EQ(byteClasses.classOf('e'), byteClasses.classOf('\0'));
+    EXPECT_EQ(byteClasses.members(byteClasses.classOf('b')), (std::vector<unsigned char>{'b', 'c'}));
+}
+
+TEST(ByteClassesTest, DFABytesWithIdenticalColumnsShareAClass) {
+    DFA dfa;
+    dfa.setStartState(0);
+    dfa.addState(1, true);
+    for (char c = 'a'; c <= 'z'; ++c) {
+        dfa.addTransition(0, c, 1);
+        dfa.addTransition(1, c, 1);
+    }
+    for (char c = '0'; c <= '9'; ++c) {
+        dfa.addTransition(1, c, 1);
+    }
+
+    ByteClasses byteClasses = ByteClasses::fromDFA(dfa);
+
+    // Letters, digits and everything else
+    EXPECT_EQ(byteClasses.getClassCount(), 3);
+    EXPECT_EQ(byteClasses.classOf('a'), byteClasses.classOf('q'));
+    EXPECT_EQ(byteClasses.classOf('0'), byteClasses.classOf('9'));
+    EXPECT_NE(byteClasses.classOf('a'), byteClasses.classOf('0'));
+
+    CompiledDFA compiled(dfa);
+    EXPECT_EQ(compiled.getColumnCount(), 3);
+    EXPECT_TRUE(compiled.match("abc123"));
+    EXPECT_FALSE(compiled.match("1abc"));
+}
+
+TEST(ByteClassesTest, NFAClassesFollowTargetSets) {
+    NFA nfa;
+    nfa.setStartState(0);
+    nfa.addState(2, true);
+    nfa.addTransition(0, 'a', 1);
+    nfa.addTransition(0, 'b', 1);
+    nfa.addTransition(1, 'c', 2);
+    nfa.addTransition(1, 'd', 2);
+    nfa.addTransition(1, 'd', 0);
+
+    ByteClasses byteClasses = ByteClasses::fromNFA(nfa);
+
+    EXPECT_EQ(byteClasses.classOf('a'), byteClasses.classOf('b'));
+    EXPECT_NE(byteClasses.classOf('c'), byteClasses.classOf('d'));
+    EXPECT_NE(byteClasses.classOf('a'), byteClasses.classOf('x'));
+}
+
+// FrozenNFA Tests
+TEST(FrozenNFATest, RenumbersStatesDensely) {
+    NFA nfa;
+    nfa.setStartState(10);
+    nfa.addTransition(10, 'b', 30);
+    nfa.addTransition(10, 'a', 30);
+    nfa.addTransition(10, EPSILON, 20);
+    nfa.addRangeTransition(20, '0', '9', 30);
+    nfa.setAcceptRule(30, 2);
+
+    FrozenNFA frozen(nfa);
+
+    ASSERT_EQ(frozen.getStateCount(), 3);
+    EXPECT_EQ(frozen.getStartState(), 0);
+    auto edges = frozen.getEdges(0);
+    ASSERT_EQ(edges.size(), 2);
+    EXPECT_EQ(edges[0], (FrozenNFA::Edge{2, 'a', 'a'}));
+    EXPECT_EQ(edges[1], (FrozenNFA::Edge{2, 'b', 'b'}));
+    ASSERT_EQ(frozen.getEpsilonTargets(0).size(), 1);
+    EXPECT_EQ(frozen.getEpsilonTargets(0)[0], 1);
+    ASSERT_EQ(frozen.getEdges(1).size(), 1);
+    EXPECT_EQ(frozen.getEdges(1)[0], (FrozenNFA::Edge{2, '0', '9'}));
+    EXPECT_TRUE(frozen.getEdges(2).empty());
+
+    EXPECT_FALSE(frozen.isAccept(0));
+    EXPECT_TRUE(frozen.isAccept(2));
+    EXPECT_EQ(frozen.getAcceptRule(2), 2);
+    EXPECT_EQ(frozen.getAcceptRule(1), NO_RULE);
+    EXPECT_TRUE(frozen.hasAcceptRules());
+    EXPECT_TRUE(FrozenNFA(NFA()).empty());
+}
+
+TEST(FrozenNFATest, FrozenRulesBuildTheSameDFA) {
+    std::vector<std::string> rules = {"if|else", "[a-z_][a-z0-9_]*", "[0-9]+(\\.[0-9]+)?", "\\p{Lu}+", " +"};
+    NFA nfa = RegexToNFA::fromRules(rules);
+    FrozenNFA direct = RegexToNFA::frozenFromRules(rules);
+    FrozenNFA converted(nfa);
+
+    ASSERT_EQ(direct.getStateCount(), converted.getStateCount());
+    EXPECT_EQ(direct.getStateCount(), static_cast<int>(nfa.getStates().size()));
+    for (int state = 0; state < direct.getStateCount(); ++state) {
+        EXPECT_TRUE(std::ranges::equal(direct.getEdges(state), converted.getEdges(state))) << state;
+        // The arena keeps epsilon edges in the order they were added, an NFA sorted by target
+        std::vector<uint32_t> epsilons(direct.getEpsilonTargets(state).begin(), direct.getEpsilonTargets(state).end());
+        std::sort(epsilons.begin(), epsilons.end());
+        EXPECT_TRUE(std::ranges::equal(epsilons, converted.getEpsilonTargets(state))) << state;
+        EXPECT_EQ(direct.getAcceptRule(state), nfa.getAcceptRule(state)) << state;
+    }
+
+    DFA fromFrozen = AutomataTransformations::minimize_dfa(AutomataTransformations::nfa_to_dfa(direct));
+    DFA fromNFA = AutomataTransformations::minimize_dfa(AutomataTransformations::nfa_to_dfa(nfa));
+    EXPECT_EQ(fromFrozen.getTransitionTable(), fromNFA.getTransitionTable());
+    EXPECT_EQ(fromFrozen.getAcceptRules(), fromNFA.getAcceptRules());
+
+    LazyDFA lazy(direct);
+    EXPECT_EQ(lazy.longestPrefix("else1"), 5);
+    EXPECT_EQ(lazy.longestPrefix("\u0391\u0392 "), 4);
+}
+
+TEST(FrozenNFATest, TakesFewBytesPerState) {
+    std::string regex;
+    for (int i = 0; i < 1000; ++i) {
+        regex += (i ? "|kw" : "kw") + std::to_string(i);
+    }
+    FrozenNFA frozen = RegexToNFA::frozenFromRules({regex});
+
+    EXPECT_LT(frozen.getMemoryUsage() / static_cast<size_t>(frozen.getStateCount()), 24);
+}
+
+// CompiledDFA Tests
+class CompiledDFATest : public ::testing::Test {
+protected:
+    // Accepts (a|b)*abb
+    static DFA createEndsWithAbbDFA() {
+        DFA dfa;
+        dfa.setStartState(0);
+        dfa.addState(3, true);
+        dfa.addTransition(0, 'a', 1);
+        dfa.addTransition(0, 'b', 0);
+        dfa.addTransition(1, 'a', 1);
+        dfa.addTransition(1, 'b', 2);
+        dfa.addTransition(2, 'a', 1);
+        dfa.addTransition(2, 'b', 3);
+        dfa.addTransition(3, 'a', 1);
+        dfa.addTransition(3, 'b', 0);
+        return dfa;
+    }
+};
+
+TEST_F(CompiledDFATest, MatchesWholeInput) {
+    CompiledDFA compiled(createEndsWithAbbDFA());
+
+    EXPECT_TRUE(compiled.match("abb"));
+    EXPECT_TRUE(compiled.match("babaabb"));
+    EXPECT_FALSE(compiled.match("ab"));
+    EXPECT_FALSE(compiled.match("abba"));
+    EXPECT_FALSE(compiled.match("abc"));
+    EXPECT_FALSE(compiled.match(""));
+}
+
+TEST_F(CompiledDFATest, LongestPrefix) {
+    CompiledDFA compiled(createEndsWithAbbDFA());
+
+    EXPECT_EQ(compiled.longestPrefix("abbabbab"), 6);
+    EXPECT_EQ(compiled.longestPrefix("abbc"), 3);
+    EXPECT_EQ(compiled.longestPrefix("ab"), CompiledDFA::NO_MATCH);
+    EXPECT_EQ(compiled.longestPrefix(""), CompiledDFA::NO_MATCH);
+}
+
+TEST_F(CompiledDFATest, MatchesRegexDFA) {
+    CompiledDFA compiled(AutomataTransformations::nfa_to_dfa(RegexToNFA::fromRegex("a|b")));
+
+    EXPECT_TRUE(compiled.match("a"));
+    EXPECT_TRUE(compiled.match("b"));
+    EXPECT_FALSE(compiled.match("ab"));
+    EXPECT_EQ(compiled.longestPrefix("bb"), 1);
+}
+
+TEST_F(CompiledDFATest, MissingTransitionsLeadToDeadState) {
+    DFA dfa;
+    dfa.setStartState(7);
+    dfa.addState(7, true);
+    dfa.addTransition(7, 'x', 9);
+    dfa.addState(9, true);
+    CompiledDFA compiled(dfa);
+
+    EXPECT_EQ(compiled.getStateCount(), 3);
+    EXPECT_TRUE(compiled.match(""));
+    EXPECT_TRUE(compiled.match("x"));
+    EXPECT_FALSE(compiled.match("xx"));
+    EXPECT_EQ(compiled.getTransition(compiled.getStartState(), 'y'), CompiledDFA::DEAD_STATE);
+    EXPECT_EQ(compiled.longestPrefix("xxx"), 1);
+}
+
+TEST_F(CompiledDFATest, EmptyDFAMatchesNothing) {
+    CompiledDFA compiled{DFA()};
+
+    EXPECT_FALSE(compiled.match(""));
+    EXPECT_EQ(compiled.longestPrefix("a"), CompiledDFA::NO_MATCH);
+}
+
+TEST_F(CompiledDFATest, NarrowsStateIdsToFit) {
+    EXPECT_EQ(CompiledDFA::stateWidthFor(0x100), 1);
+    EXPECT_EQ(CompiledDFA::stateWidthFor(0x101), 2);
+    EXPECT_EQ(CompiledDFA::stateWidthFor(0x10000), 2);
+    EXPECT_EQ(CompiledDFA::stateWidthFor(0x10001), 4);
+    EXPECT_EQ(CompiledDFA(createEndsWithAbbDFA()).getStateWidth(), 1);
+
+    // (a|b)*a(a|b){9} needs 2^10 states, more than a byte numbers
+    std::string regex = "(a|b)*a(a|b){9}";
+    CompiledDFA wide(AutomataTransformations::minimize_dfa(AutomataTransformations::nfa_to_dfa(
+            RegexToNFA::fromRegex(regex))));
+    EXPECT_EQ(wide.getStateWidth(), 2);
+    PikeVM reference(RegexToNFA::fromRegex(regex));
+    std::mt19937 rng(43);
+    for (int i = 0; i < 200; ++i) {
+        std::string input;
+        size_t length = rng() % 24;
+        for (size_t j = 0; j < length; ++j) {
+            input += "ab"[rng() % 2];
+        }
+        ASSERT_EQ(wide.match(input), reference.match(input)) << input;
+        ASSERT_EQ(wide.longestPrefix(input), reference.longestPrefix(input)) << input;
+    }
+}
+
+TEST_F(CompiledDFATest, CombEncodingMatchesDense) {
+    std::mt19937 rng(47);
+    std::string keywords = "if|else|while|for|return|int";
+    for (int keyword = 0; keyword < 300; ++keyword) {
+        keywords += '|';
+        for (size_t length = 4 + rng() % 6; length > 0; --length) {
+            keywords += static_cast<char>('a' + rng() % 26);
+        }
+    }
+    std::vector<std::string> rules = {keywords, "[a-z_][a-z0-9_]*", "[0-9]+", " +"};
+    CompiledDFA dense(AutomataTransformations::minimize_dfa(
+            AutomataTransformations::nfa_to_dfa(RegexToNFA::fromRules(rules))));
+    CompiledDFA comb = dense.withEncoding(CompiledDFA::Encoding::COMB);
+    EXPECT_EQ(comb.getEncoding(), CompiledDFA::Encoding::COMB);
+    // Most keyword states go to the identifier state on most bytes, which is their default
+    EXPECT_LT(comb.getMemoryUsage() * 2, dense.getMemoryUsage());
+
+    for (uint32_t state = 0; state < dense.getStateCount(); ++state) {
+        for (int byte = 0; byte < 256; ++byte) {
+            ASSERT_EQ(comb.getTransition(state, byte), dense.getTransition(state, byte)) << state << " " << byte;
+        }
+    }
+    const std::string alphabet = "abefilnorstuw_09 ";
+    for (int i = 0; i < 500; ++i) {
+        std::string input;
+        size_t length = rng() % 10;
+        for (size_t j = 0; j < length; ++j) {
+            input += alphabet[rng() % alphabet.size()];
+        }
+        int denseRule;
+        int combRule;
+        ASSERT_EQ(comb.longestPrefix(input, combRule), dense.longestPrefix(input, denseRule)) << input;
+        ASSERT_EQ(combRule, denseRule) << input;
+        ASSERT_EQ(comb.match(input), dense.match(input)) << input;
+    }
+
+    // Renumbering keeps the encoding, and converting back gives the dense table again
+    EXPECT_EQ(comb.renumbered(DFALayout::breadthFirst(comb)).getEncoding(), CompiledDFA::Encoding::COMB);
+    CompiledDFA back = comb.withEncoding(CompiledDFA::Encoding::DENSE);
+    EXPECT_EQ(back.getMemoryUsage(), dense.getMemoryUsage());
+    EXPECT_EQ(back.getTransition(back.getStartState(), 'i'), dense.getTransition(dense.getStartState(), 'i'));
+
+    Lexer denseLexer({{1, rules[0]}, {2, rules[1]}, {3, rules[2]}, {4, rules[3]}});
+    Lexer combLexer({{1, rules[0]}, {2, rules[1]}, {3, rules[2]}, {4, rules[3]}}, CompiledDFA::Encoding::COMB);
+    std::string input = "while (x1 < 10) returned 7 for_ever if";
+    EXPECT_EQ(combLexer.tokenize(input), denseLexer.tokenize(input));
+}
+
+TEST_F(CompiledDFATest, CombEncodingPacksRowsUpToTheEnd) {
+    // Two byte classes, with every row's exception in a different class than the row placed before it, so the rows
+    // fill every entry the comb has
+    DFA dfa;
+    dfa.addState(0, false);
+    dfa.addState(1, false);
+    dfa.addState(2, true);
+    dfa.setStartState(0);
+    for (int byte = 0; byte < 128; ++byte) {
+        dfa.addTransition(0, static_cast<char>(byte), 1);
+        dfa.addTransition(1, static_cast<char>(byte + 128), 2);
+        dfa.addTransition(2, static_cast<char>(byte), 0);
+    }
+    CompiledDFA dense(dfa);
+    CompiledDFA comb(dfa, CompiledDFA::Encoding::COMB);
+
+    for (uint32_t state = 0; state < dense.getStateCount(); ++state) {
+        for (int byte = 0; byte < 256; ++byte) {
+            ASSERT_EQ(comb.getTransition(state, byte), dense.getTransition(state, byte)) << state << " " << byte;
+        }
+    }
+    EXPECT_TRUE(comb.match("a\x80"));
+    EXPECT_FALSE(comb.match(std::string("a\x80") + "b"));
+}
+
+// DFALayout Tests
+TEST(DFALayoutTest, RenumbersStatesBreadthFirst) {
+    CompiledDFA dfa(AutomataTransformations::minimize_dfa(AutomataTransformations::nfa_to_dfa(
+            RegexToNFA::fromRules({"if|in|int", "[a-z]+", "[0-9]+(\\.[0-9]+)?"}))));
+    std::vector<uint32_t> order = DFALayout::breadthFirst(dfa);
+    ASSERT_EQ(order.size(), dfa.getStateCount());
+    EXPECT_EQ(order[0], CompiledDFA::DEAD_STATE);
+    EXPECT_EQ(order[1], dfa.getStartState());
+
+    CompiledDFA reordered = dfa.renumbered(order);
+    EXPECT_EQ(reordered.getStartState(), 1);
+    // Every state is entered from one numbered before it
+    for (uint32_t state = 2; state < reordered.getStateCount(); ++state) {
+        bool entered = false;
+        for (uint32_t from = 1; from < state && !entered; ++from) {
+            for (int byte = 0; byte < 256 && !entered; ++byte) {
+                entered = reordered.getTransition(from, static_cast<unsigned char>(byte)) == state;
+            }
+        }
+        EXPECT_TRUE(entered) << state;
+    }
+    for (const std::string input : {"if", "int", "inx", "12.5", "12.", "", "x9"}) {
+        int rule;
+        int reorderedRule;
+        EXPECT_EQ(reordered.longestPrefix(input, reorderedRule), dfa.longestPrefix(input, rule)) << input;
+        EXPECT_EQ(reorderedRule, rule) << input;
+        EXPECT_EQ(reordered.match(input), dfa.match(input)) << input;
+    }
+
+    std::vector<uint32_t> missing(order.begin(), order.end() - 1);
+    std::vector<uint32_t> repeated = order;
+    repeated.back() = repeated[1];
+    std::vector<uint32_t> deadLast = order;
+    std::swap(deadLast.front(), deadLast.back());
+    for (const auto& invalid : {missing, repeated, deadLast}) {
+        EXPECT_THROW((void) dfa.renumbered(invalid), std::runtime_error);
+    }
+}
+
+TEST(DFALayoutTest, ProfilePutsHotStatesFirst) {
+    Lexer lexer({{1, "while"}, {2, "return"}, {3, "[a-z]+"}, {4, " +"}});
+    std::string sample = "return return retx x";
+    std::vector<uint64_t> visits = DFALayout::countVisits(lexer.getDFA(), sample);
+    uint64_t total = 0;
+    for (uint64_t count : visits) {
+        total += count;
+    }
+    EXPECT_EQ(total, sample.size() + lexer.tokenize(sample).size());
+
+    std::vector<Token> before = lexer.tokenize(sample);
+    lexer.reorderStates(DFALayout::byProfile(lexer.getDFA(), visits));
+    EXPECT_EQ(lexer.tokenize(sample), before);
+
+    // The states the sample visits now come first, the start state leading, and the states of "whil" it never
+    // visits last
+    std::vector<uint64_t> reordered = DFALayout::countVisits(lexer.getDFA(), sample);
+    EXPECT_EQ(lexer.getDFA().getStartState(), 1);
+    EXPECT_TRUE(std::is_partitioned(reordered.begin() + 1, reordered.end(), [](uint64_t count) { return count > 0; }));
+    EXPECT_EQ(std::count(reordered.begin(), reordered.end(), 0), std::count(visits.begin(), visits.end(), 0));
+    EXPECT_GT(std::count(reordered.begin(), reordered.end(), 0), 1);
+}
+
+// Lexer Tests
+enum TestToken { IF = 1, IDENT, AB_RUN };
+
+TEST(LexerTest, LongestMatchWithRulePriority) {
+    // "if" is matched by both rules, the keyword is listed first
+    Lexer lexer({{IF, "if"}, {IDENT, "(a|b|f|i|x)(a|b|f|i|x)*"}});
+
+    std::vector<Token> tokens = lexer.tokenize("ifxif");
+    ASSERT_EQ(tokens.size(), 1);
+    EXPECT_EQ(tokens[0], (Token{IDENT, 0, 5}));
+
+    tokens = lexer.tokenize("if");
+    ASSERT_EQ(tokens.size(), 1);
+    EXPECT_EQ(tokens[0], (Token{IF, 0, 2}));
+}
+
+TEST(LexerTest, TokensWithCaptures) {
+    Lexer lexer({{1, "(?<key>[a-z]+)=(?<value>[0-9]+)"}, {2, "[a-z]+"}, {3, " +"}});
+    std::vector<std::pair<Token, std::vector<Capture>>> tokens;
+    lexer.forEachTokenWithCaptures("ab=12 cd x=3", [&tokens](const Token& token, const std::vector<Capture>& captures) {
+        tokens.emplace_back(token, captures);
+    });
+
+    ASSERT_EQ(tokens.size(), 5);
+    EXPECT_EQ(tokens[0].first, (Token{1, 0, 5}));
+    EXPECT_EQ(tokens[0].second, (std::vector<Capture>{{0, 2}, {3, 2}}));
+    EXPECT_EQ(tokens[2].first, (Token{2, 6, 2}));
+    EXPECT_TRUE(tokens[2].second.empty());
+    EXPECT_EQ(tokens[4].second, (std::vector<Capture>{{9, 1}, {11, 1}}));
+    EXPECT_EQ(lexer.getCaptureNames(0), (std::vector<std::string>{"key", "value"}));
+
+    std::vector<Token> plain;
+    for (const auto& [token, captures] : tokens) {
+        plain.push_back(token);
+    }
+    EXPECT_EQ(plain, lexer.tokenize("ab=12 cd x=3"));
+    EXPECT_THROW(Lexer({{1, "a"}}).forEachTokenWithCaptures("a", [](const Token&, const std::vector<Capture>&) {}),
+                 std::runtime_error);
+}
+
+TEST(LexerTest, InvalidBytesBecomeSingleTokens) {
+    Lexer lexer({{AB_RUN, "ab(ab)*"}, {IDENT, "x"}});
+
+    std::vector<Token> expected = {{AB_RUN, 0, 4}, {Lexer::INVALID_TOKEN, 4, 1}, {IDENT, 5, 1},
+                                   {Lexer::INVALID_TOKEN, 6, 1}, {AB_RUN, 7, 2}};
+    EXPECT_EQ(lexer.tokenize("ababqxaab"), expected);
+}
+
+TEST(LexerTest, MinimizationKeepsRulesApart) {
+    // Both rules end in equivalent states that must not be merged
+    Lexer lexer({{IF, "ab"}, {IDENT, "ba"}});
+
+    EXPECT_EQ(lexer.tokenize("abba"), (std::vector<Token>{{IF, 0, 2}, {IDENT, 2, 2}}));
+    // Start, a, b, ab, ba and the dead state
+    EXPECT_EQ(lexer.getDFA().getStateCount(), 6);
+}
+
+TEST(LexerTest, RejectsRuleMatchingEmptyString) {
+    EXPECT_THROW(Lexer({{IF, "a"}, {IDENT, "b*"}}), std::runtime_error);
+}
+
+// DFAFile Tests
+class DFAFileTest : public ::testing::Test {
+protected:
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("syphon_test_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()) + "_" +
+                         ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".dfa")).string();
+
+    void TearDown() override {
+        std::filesystem::remove(path);
+    }
+
+    std::vector<unsigned char> readFile() const {
+        std::ifstream file(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    }
+
+    void writeFile(const std::vector<unsigned char>& contents) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+    }
+};
+
+TEST_F(DFAFileTest, MappedDFAMatchesLikeTheOriginal) {
+    CompiledDFA original(AutomataTransformations::minimize_dfa(
+            AutomataTransformations::nfa_to_dfa(RegexToNFA::fromRegex("(a|b)*abb|ba*"))));
+    DFAFile::write(path, original);
+    CompiledDFA mapped = DFAFile::map(path);
+
+    EXPECT_TRUE(mapped.isMapped());
+    EXPECT_EQ(mapped.getStateCount(), original.getStateCount());
+    EXPECT_EQ(mapped.getColumnCount(), original.getColumnCount());
+    EXPECT_EQ(mapped.getStartState(), original.getStartState());
+    for (uint32_t state = 0; state < original.getStateCount(); ++state) {
+        for (int symbol = 0; symbol < 256; ++symbol) {
+            ASSERT_EQ(mapped.getTransition(state, symbol), original.getTransition(state, symbol));
+        }
+        EXPECT_EQ(mapped.isAccept(state), original.isAccept(state));
+    }
+
+    // Copies share the mapping, which stays alive after the original goes away
+    CompiledDFA copy = mapped;
+    mapped = CompiledDFA();
+    for (const std::string input : {"abb", "aabb", "baaa", "ab", "", "bab"}) {
+        EXPECT_EQ(copy.match(input), original.match(input)) << input;
+        EXPECT_EQ(copy.longestPrefix(input), original.longestPrefix(input)) << input;
+    }
+}
+
+TEST_F(DFAFileTest, MapsTwoByteStateIds) {
+    CompiledDFA original(AutomataTransformations::minimize_dfa(
+            AutomataTransformations::nfa_to_dfa(RegexToNFA::fromRegex("(a|b)*a(a|b){9}"))));
+    ASSERT_EQ(original.getStateWidth(), 2);
+    DFAFile::write(path, original);
+    CompiledDFA mapped = DFAFile::map(path);
+
+    EXPECT_EQ(mapped.getStateWidth(), 2);
+    for (uint32_t state = 0; state < original.getStateCount(); ++state) {
+        ASSERT_EQ(mapped.getTransition(state, 'a'), original.getTransition(state, 'a'));
+        ASSERT_EQ(mapped.getTransition(state, 'b'), original.getTransition(state, 'b'));
+    }
+    EXPECT_TRUE(mapped.match("babbbbbbbbb"));
+    EXPECT_FALSE(mapped.match("abbbbbbbbbb"));
+}
+
+TEST_F(DFAFileTest, WritesCombTablesDense) {
+    CompiledDFA comb(AutomataTransformations::nfa_to_dfa(RegexToNFA::fromRegex("[a-z]+|if")),
+                     CompiledDFA::Encoding::COMB);
+    DFAFile::write(path, comb);
+    CompiledDFA mapped = DFAFile::map(path);
+
+    EXPECT_EQ(mapped.getEncoding(), CompiledDFA::Encoding::DENSE);
+    for (const std::string input : {"if", "iffy", "", "x1", "abc"}) {
+        EXPECT_EQ(mapped.longestPrefix(input), comb.longestPrefix(input)) << input;
+    }
+}
+
+TEST_F(DFAFileTest, LoadedLexerTokenizesLikeTheBuiltOne) {
+    Lexer built({{IF, "if"}, {IDENT, "(a|b|f|i|x)(a|b|f|i|x)*"}, {AB_RUN, "q(q)*"}});
+    built.save(path);
+    Lexer loaded = Lexer::load(path);
+
+    std::string input = "if ifx qqq xif q if";
+    EXPECT_EQ(loaded.tokenize(input), built.tokenize(input));
+    EXPECT_EQ(loaded.getTokenId(2), AB_RUN);
+}
+
+TEST_F(DFAFileTest, RejectsCorruptFiles) {
+    DFAFile::write(path, CompiledDFA(AutomataTransformations::nfa_to_dfa(RegexToNFA::fromRegex("ab*"))));
+    const std::vector<unsigned char> contents = readFile();
+
+    auto rejects = [&](std::vector<unsigned char> corrupt) {
+        writeFile(corrupt);
+        EXPECT_THROW(DFAFile::map(path), std::runtime_error);
+    };
+    rejects(std::vector<unsigned char>(contents.begin(), contents.begin() + 16));
+    rejects(std::vector<unsigned char>(contents.begin(), contents.end() - 8));
+
+    std::vector<unsigned char> badMagic = contents;
+    badMagic[0] = 'X';
+    rejects(badMagic);
+
+    std::vector<unsigned char> badVersion = contents;
+    badVersion[offsetof(DFAFileHeader, version)]++;
+    rejects(badVersion);
+
+    std::vector<unsigned char> badStates = contents;
+    badStates[offsetof(DFAFileHeader, stateCount)]++;
+    rejects(badStates);
+
+    std::vector<unsigned char> badClass = contents;
+    DFAFileHeader header{};
+    std::memcpy(&header, contents.data(), sizeof(header));
+    badClass[header.classTableOffset + 'a'] = 0xFF;
+    rejects(badClass);
+
+    EXPECT_THROW(DFAFile::map(path + ".missing"), std::runtime_error);
+}
+
+TEST_F(DFAFileTest, RejectsCorruptTables) {
+    Lexer({{IF, "if"}, {IDENT, "(a|b|f|i|x)(a|b|f|i|x)*"}}).save(path);
+    const std::vector<unsigned char> contents = readFile();
+    DFAFileHeader header{};
+    std::memcpy(&header, contents.data(), sizeof(header));
+    ASSERT_EQ(CompiledDFA::stateWidthFor(header.stateCount), 1);
+
+    auto rejects = [&](std::vector<unsigned char> corrupt) {
+        writeFile(corrupt);
+        EXPECT_THROW(Lexer::load(path), std::runtime_error);
+        EXPECT_THROW(DFAFile::map(path), std::runtime_error);
+    };
+
+    std::vector<unsigned char> badTransition = contents;
+    badTransition[header.transitionsOffset + header.classCount] = static_cast<unsigned char>(header.stateCount);
+    rejects(badTransition);
+
+    // An accept rule with no token id, and one below NO_RULE
+    for (int32_t rule : {100000, -5}) {
+        std::vector<unsigned char> badRule = contents;
+        for (uint64_t state = 0; state < header.stateCount; ++state) {
+            std::memcpy(badRule.data() + header.acceptRulesOffset + state * sizeof(int32_t), &rule, sizeof(rule));
+        }
+        rejects(badRule);
+    }
+
+    // Tokenizing from an accepting start state would never advance
+    std::vector<unsigned char> acceptingStart = contents;
+    acceptingStart[header.acceptBitsOffset + header.startState / 8] |= 1 << (header.startState % 8);
+    int32_t rule = 0;
+    std::memcpy(acceptingStart.data() + header.acceptRulesOffset + header.startState * sizeof(int32_t), &rule,
+                sizeof(rule));
+    writeFile(acceptingStart);
+    EXPECT_THROW(Lexer::load(path), std::runtime_error);
+
+    // A bare DFA may accept the empty string, and its rules are only bounded once it is mapped for token ids
+    DFAFile::write(path, CompiledDFA(AutomataTransformations::nfa_to_dfa(RegexToNFA::fromRegex("a*"))));
+    EXPECT_TRUE(DFAFile::map(path).match(""));
+    std::vector<int> tokenIds;
+    EXPECT_THROW(DFAFile::map(path, &tokenIds), std::runtime_error);
+}
+
+TEST(LexerSpecTest, ParsesRulesInOrder) {
+    LexerSpec spec = LexerSpec::fromString("# comment\n\nIF  if\n  IDENT\t(a|b)(a|b)*  \r\n");
+
+    EXPECT_EQ(spec.names, (std::vector<std::string>{"IF", "IDENT"}));
+    ASSERT_EQ(spec.rules.size(), 2);
+    EXPECT_EQ(spec.rules[0].tokenId, 0);
+    EXPECT_EQ(spec.rules[0].regex, "if");
+    EXPECT_EQ(spec.rules[1].tokenId, 1);
+    EXPECT_EQ(spec.rules[1].regex, "(a|b)(a|b)*");
+
+    EXPECT_THROW(LexerSpec::fromString("IF\n"), std::runtime_error);
+    EXPECT_THROW(LexerSpec::fromString("# nothing\n"), std::runtime_error);
+}
+
+TEST(LexerSpecTest, PrecompiledSpecMatchesSpec) {
+    // keywords.dfa is compiled from keywords.spec by syphonc as part of the build
+    Lexer built(LexerSpec::fromFile(SYPHON_KEYWORDS_SPEC).rules);
+    Lexer loaded = Lexer::load(SYPHON_KEYWORDS_DFA);
+
+    std::string input = "ifzelsezzifelsezbadzelzx";
+    EXPECT_EQ(loaded.tokenize(input), built.tokenize(input));
+    EXPECT_TRUE(loaded.getDFA().isMapped());
+}
+
+// CodeGenerator Tests
+template<typename Token, typename ForEachToken>
+static std::vector<::Token> tokenizeGenerated(std::string_view input, ForEachToken forEachToken) {
+    std::vector<::Token> tokens;
+    forEachToken(input, [&tokens](const Token& token) {
+        tokens.push_back({token.tokenId, token.offset, token.length});
+    });
+    return tokens;
+}
+
+TEST(CodeGeneratorTest, GeneratedScannersTokenizeLikeTheLexer) {
+    // keywordsDirect, keywordsTable and keywordsHashed are generated from keywords.spec by syphonc as part of the build,
+    // keywordsHashed with its keywords in a keyword table
+    Lexer lexer(LexerSpec::fromFile(SYPHON_KEYWORDS_SPEC).rules);
+    EXPECT_EQ(keywordsDirect::ELSE, 1);
+    EXPECT_EQ(keywordsTable::SPACE, 3);
+
+    std::mt19937 rng(13);
+    const std::string alphabet = "abcdefilsz?";
+    for (int i = 0; i < 300; ++i) {
+        std::string input;
+        size_t length = rng() % 24;
+        for (size_t j = 0; j < length; ++j) {
+            input += alphabet[rng() % alphabet.size()];
+        }
+        if (i % 3 == 0) input += "ifzelse";
+
+        std::vector<Token> expected = lexer.tokenize(input);
+        EXPECT_EQ(tokenizeGenerated<keywordsDirect::Token>(input, [](std::string_view in, auto&& onToken) {
+            keywordsDirect::forEachToken(in, onToken);
+        }), expected) << input;
+        EXPECT_EQ(tokenizeGenerated<keywordsTable::Token>(input, [](std::string_view in, auto&& onToken) {
+            keywordsTable::forEachToken(in, onToken);
+        }), expected) << input;
+        EXPECT_EQ(tokenizeGenerated<keywordsHashed::Token>(input, [](std::string_view in, auto&& onToken) {
+            keywordsHashed::forEachToken(in, onToken);
+        }), expected) << input;
+        EXPECT_EQ(keywordsDirect::match(input), lexer.getDFA().match(input)) << input;
+        EXPECT_EQ(keywordsTable::match(input), lexer.getDFA().match(input)) << input;
+    }
+}
+
+TEST(CodeGeneratorTest, DirectCodedScannerHasOneLabelPerLiveState) {
+    Lexer lexer({{IF, "ab"}, {IDENT, "ba"}});
+    CodeGenerator::Options options;
+    options.name = "scanner";
+    GeneratedLexer generated = CodeGenerator::generate(lexer.getDFA(), {IF, IDENT}, options);
+
+    // Every state but the dead one, which becomes the default case of every switch
+    size_t labels = 0;
+    for (size_t at = generated.source.find("\nstate"); at != std::string::npos;
+         at = generated.source.find("\nstate", at + 1)) {
+        labels++;
+    }
+    EXPECT_EQ(labels, lexer.getDFA().getStateCount() - 1);
+    EXPECT_NE(generated.source.find("#include \"scanner.h\""), std::string::npos);
+    EXPECT_NE(generated.header.find("namespace scanner"), std::string::npos);
+
+    options.name = "not a name";
+    EXPECT_THROW(CodeGenerator::generate(lexer.getDFA(), {IF, IDENT}, options), std::runtime_error);
+    options.name = "scanner";
+    options.tokenNames = {"IF"};
+    EXPECT_THROW(CodeGenerator::generate(lexer.getDFA(), {IF, IDENT}, options), std::runtime_error);
+}
+
+// ParallelScan Tests
+TEST(ParallelScanTest, StateMappingFollowsEveryStartState) {
+    CompiledDFA dfa(AutomataTransformations::minimize_dfa(
+            AutomataTransformations::nfa_to_dfa(RegexToNFA::fromRegex("(a|b)*abb"))));
+    std::string chunk = "babbaabab";
+
+    std::vector<uint32_t> mapping = ParallelScan::stateMapping(dfa, chunk);
+    ASSERT_EQ(mapping.size(), dfa.getStateCount());
+    for (uint32_t state = 0; state < dfa.getStateCount(); ++state) {
+        uint32_t expected = state;
+        for (char c : chunk) {
+            expected = dfa.getTransition(expected, c);
+        }
+        EXPECT_EQ(mapping[state], expected) << state;
+    }
+}
+
+TEST(ParallelScanTest, MatchAgreesWithSequentialScan) {
+    CompiledDFA dfa(AutomataTransformations::minimize_dfa(
+            AutomataTransformations::nfa_to_dfa(RegexToNFA::fromRegex("(a|b)*a(a|b)(a|b)(a|b)"))));
+
+    std::mt19937 rng(31);
+    for (int i = 0; i < 200; ++i) {
+        std::string input;
+        size_t length = rng() % 200;
+        for (size_t j = 0; j < length; ++j) {
+            input += "abc"[rng() % (i % 4 == 0 ? 3 : 2)];
+        }
+        EXPECT_EQ(ParallelScan::match(dfa, input, 1 + i % 8, 1 + i % 13), dfa.match(input)) << input;
+    }
+}
+
+TEST(ParallelScanTest, ForEachChunkRethrowsAfterJoining) {
+    std::vector<size_t> bounds = ParallelScan::chunkBounds(100, 4, 1);
+    ASSERT_EQ(bounds.size(), 5);
+
+    // Every chunk runs to the end, then the exception of the first chunk that threw comes out
+    for (size_t first : {0, 2}) {
+        std::atomic<int> finished{0};
+        try {
+            ParallelScan::forEachChunk(bounds, [&](size_t chunk) {
+                if (chunk >= first && chunk % 2 == 0) throw std::runtime_error(std::to_string(chunk));
+                finished++;
+            });
+            ADD_FAILURE() << "forEachChunk did not throw";
+        } catch (const std::runtime_error& error) {
+            EXPECT_EQ(error.what(), std::to_string(first));
+        }
+        EXPECT_EQ(finished, first == 0 ? 2 : 3);
+    }
+}
+
+TEST(LexerTest, ParallelTokenizeMatchesSequential) {
+    // Differential test over chunkings small enough that tokens often straddle chunk boundaries
+    Lexer lexer({{IF, "if"}, {IDENT, "(a|b|f|i|x)(a|b|f|i|x)*"}, {AB_RUN, "ab(ab)*"}});
+
+    std::mt19937 rng(37);
+    const std::string alphabet = "abfixq ";
+    for (int i = 0; i < 500; ++i) {
+        std::string input;
+        size_t length = rng() % 300;
+        for (size_t j = 0; j < length; ++j) {
+            input += alphabet[rng() % alphabet.size()];
+        }
+        unsigned threadCount = 1 + rng() % 8;
+        size_t minChunkSize = 1 + rng() % 40;
+        EXPECT_EQ(lexer.tokenizeParallel(input, threadCount, minChunkSize), lexer.tokenize(input))
+                << input << " threads=" << threadCount << " chunk=" << minChunkSize;
+    }
+
+    // Long tokens swallowing whole chunks
+    std::string input = std::string(1000, 'x') + "q" + std::string(1000, 'a') + "ifif" + "abababab";
+    EXPECT_EQ(lexer.tokenizeParallel(input, 16, 1), lexer.tokenize(input));
+}
+
+// LexerStream Tests
+TEST(LexerStreamTest, ChunkedInputTokenizesLikeWholeInput) {
+    Lexer lexer({{IF, "if"}, {IDENT, "(a|b|f|i|x)(a|b|f|i|x)*"}, {AB_RUN, "ab(ab)*q"}});
+
+    std::mt19937 rng(41);
+    const std::string alphabet = "abfiqx ";
+    for (int i = 0; i < 300; ++i) {
+        std::string input;
+        size_t length = rng() % 200;
+        for (size_t j = 0; j < length; ++j) {
+            input += alphabet[rng() % alphabet.size()];
+        }
+
+        LexerStream stream(lexer);
+        std::vector<Token> tokens;
+        auto collect = [&tokens](const Token& token) { tokens.push_back(token); };
+        for (size_t at = 0; at < input.size();) {
+            size_t chunkSize = std::min<size_t>(rng() % 9, input.size() - at);
+            stream.feed(std::string_view(input).substr(at, chunkSize), collect);
+            at += chunkSize;
+        }
+        stream.finish(collect);
+
+        EXPECT_EQ(tokens, lexer.tokenize(input)) << input;
+        EXPECT_EQ(stream.getPendingSize(), 0);
+    }
+}
+
+TEST(LexerStreamTest, EmitsTokensOnceFinal) {
+    // "abab" could still grow into an AB_RUN until the byte after it shows it does not
+    Lexer lexer({{IDENT, "(a|b)(a|b)*"}, {AB_RUN, "ab(ab)*q"}, {IF, "z"}});
+    LexerStream stream(lexer);
+    std::vector<Token> tokens;
+    auto collect = [&tokens](const Token& token) { tokens.push_back(token); };
+
+    stream.feed("abzab", collect);
+    EXPECT_EQ(tokens, (std::vector<Token>{{IDENT, 0, 2}, {IF, 2, 1}}));
+    EXPECT_EQ(stream.getOffset(), 3);
+    stream.feed("ab", collect);
+    EXPECT_EQ(tokens.size(), 2);
+    stream.feed("z", collect);
+    EXPECT_EQ(tokens.back(), (Token{IDENT, 3, 4}));
+    stream.finish(collect);
+    EXPECT_EQ(tokens.back(), (Token{IF, 7, 1}));
+}
+
+TEST(LexerStreamTest, PendingBytesBoundedByLongestToken) {
+    Lexer lexer({{IDENT, "(a|b)(a|b)*"}, {IF, "z"}});
+    LexerStream stream(lexer);
+    size_t tokenCount = 0;
+    size_t maxPending = 0;
+
+    std::string word = "abbabz";
+    for (int i = 0; i < 100000; ++i) {
+        stream.feed(word.substr(0, 4), [&tokenCount](const Token&) { tokenCount++; });
+        maxPending = std::max(maxPending, stream.getPendingSize());
+        stream.feed(word.substr(4), [&tokenCount](const Token&) { tokenCount++; });
+        maxPending = std::max(maxPending, stream.getPendingSize());
+    }
+    stream.finish([&tokenCount](const Token&) { tokenCount++; });
+
+    EXPECT_EQ(tokenCount, 200000);
+    EXPECT_LE(maxPending, word.size());
+}
+
+TEST(LexerStreamTest, LongTokenInTinyChunksStaysLinear) {
+    // The token stays open for the whole input. Copying its bytes so far again on every feed would take minutes here.
+    Lexer lexer({{IDENT, "(a|b)(a|b)*"}, {IF, "z"}});
+    LexerStream stream(lexer);
+    std::vector<Token> tokens;
+    auto collect = [&tokens](const Token& token) { tokens.push_back(token); };
+
+    const std::string chunk(16, 'a');
+    const size_t chunkCount = (4 << 20) / chunk.size();
+    for (size_t i = 0; i < chunkCount; ++i) {
+        stream.feed(chunk, collect);
+    }
+    EXPECT_TRUE(tokens.empty());
+    EXPECT_EQ(stream.getPendingSize(), chunkCount * chunk.size());
+    stream.feed("z", collect);
+    stream.finish(collect);
+    EXPECT_EQ(tokens, (std::vector<Token>{{IDENT, 0, chunkCount * chunk.size()}, {IF, chunkCount * chunk.size(), 1}}));
+}
+
+// Prefilter Tests
+static Prefilter createPrefilter(const std::string& regex) {
+    return Prefilter::fromDFA(CompiledDFA(AutomataTransformations::minimize_dfa(
+            AutomataTransformations::nfa_to_dfa(RegexToNFA::fromRegex(regex)))));
+}
+
+TEST(PrefilterTest, ExtractsLiteralsFromAlternations) {
+    Prefilter prefilter = createPrefilter("(syph|lex)(on|er)x*");
+    std::vector<std::string> literals = prefilter.getLiterals();
+    std::sort(literals.begin(), literals.end());
+    EXPECT_EQ(literals, (std::vector<std::string>{"lexer", "lexon", "sypher", "syphon"}));
+    EXPECT_EQ(prefilter.getFirstBytes(), (std::vector<unsigned char>{'l', 's'}));
+
+    // Paths stop at the length limit, and at the first accept
+    EXPECT_EQ(createPrefilter("abcdefghijkl").getLiterals(), (std::vector<std::string>{"abcdefgh"}));
+    EXPECT_EQ(createPrefilter("ab(c)*").getLiterals(), (std::vector<std::string>{"ab"}));
+
+    // A regex matching the empty string matches everywhere
+    EXPECT_FALSE(createPrefilter("a*").isActive());
+}
+
+TEST(PrefilterTest, FindsEveryCandidate) {
+    // Few first bytes take the vector path, many take the scalar one
+    for (const std::string regex : {"(ab|cd)e", "(a|b|c|d|e|f|g|h|i|j|k)z"}) {
+        Prefilter prefilter = createPrefilter(regex);
+        ASSERT_TRUE(prefilter.isActive());
+
+        std::mt19937 rng(43);
+        std::string input;
+        for (int i = 0; i < 2000; ++i) {
+            input += static_cast<char>('a' + rng() % 26);
+        }
+        for (size_t from = 0; from <= input.size(); from += 7) {
+            size_t expected = from;
+            while (expected < input.size()) {
+                bool candidate = prefilter.getLiterals().empty()
+                        ? std::count(prefilter.getFirstBytes().begin(), prefilter.getFirstBytes().end(),
+                                     static_cast<unsigned char>(input[expected])) > 0
+                        : std::any_of(prefilter.getLiterals().begin(), prefilter.getLiterals().end(),
+                                      [&](const std::string& literal) {
+                                          return input.compare(expected, literal.size(), literal) == 0;
+                                      });
+                if (candidate) break;
+                expected++;
+            }
+            EXPECT_EQ(prefilter.find(input, from), expected) << regex << " from " << from;
+        }
+    }
+}
+
+// Reference for findAll: a leftmost longest search restarted after every match
+static std::vector<Match> findAllByRestarting(const Searcher& searcher, std::string_view input) {
+    std::vector<Match> matches;
+    size_t from = 0;
+    while (from <= input.size()) {
+        std::optional<Match> match = searcher.find(input, from);
+        if (!match) break;
+        matches.push_back(*match);
+        from = match->offset + std::max<size_t>(match->length, 1);
+    }
+    return matches;
+}
+
+TEST(SearcherTest, PrefilterDoesNotChangeMatches) {
+    std::mt19937 rng(47);
+    for (const std::string regex : {"(ab|cd)e", "ab(c)*", "(a|b)*abb", "b(a|c)(a|c)*b", "a*", "xyz"}) {
+        Searcher filtered(regex);
+        Searcher unfiltered(regex, false);
+        for (int i = 0; i < 50; ++i) {
+            std::string input;
+            size_t length = rng() % 100;
+            for (size_t j = 0; j < length; ++j) {
+                input += "abcdexyz"[rng() % 8];
+            }
+            EXPECT_EQ(filtered.findAll(input), unfiltered.findAll(input)) << regex << " in " << input;
+            EXPECT_EQ(findAllByRestarting(filtered, input), findAllByRestarting(unfiltered, input))
+                    << regex << " in " << input;
+        }
+    }
+}
+
+TEST(SearcherTest, FindAllMatchesRestartedSearch) {
+    std::mt19937 rng(59);
+    for (const std::string regex : {"(ab|cd)e(e)*", "abcd|c", "(a|b)*abb", "a(b)*|ba", "b*", "a(a|b)*a",
+                                    "a|a(a|b)*c", "(a|b)(a|b)|(a|b)*e"}) {
+        Searcher searcher(regex);
+        for (int i = 0; i < 100; ++i) {
+            std::string input;
+            size_t length = rng() % 120;
+            for (size_t j = 0; j < length; ++j) {
+                // Includes NUL bytes, which no match spans
+                input += std::string("abcde\0", 6)[rng() % 6];
+            }
+            EXPECT_EQ(searcher.findAll(input), findAllByRestarting(searcher, input)) << regex << " in " << input;
+        }
+    }
+
+    Searcher searcher("(ab|cd)e(e)*");
+    EXPECT_EQ(searcher.findAll("xxabeeqcdecde"), (std::vector<Match>{{2, 4}, {7, 3}, {10, 3}}));
+    EXPECT_EQ(searcher.find("abab"), std::nullopt);
+    // The leftmost match wins over one that ends earlier
+    EXPECT_EQ(Searcher("abcd|c").findAll("abcdc"), (std::vector<Match>{{0, 4}, {4, 1}}));
+}
+
+TEST(SearcherTest, FindAllStaysLinearWhenScansRunPastTheirMatch) {
+    // Every scan from an a runs on to the last c looking for a longer match. Scanning each of them that far would take
+    // minutes here.
+    Searcher searcher("a|a(a|b)*c");
+    std::string input = std::string(200000, 'a') + "c";
+    std::vector<Match> matches = searcher.findAll(input);
+    ASSERT_EQ(matches.size(), 1);
+    EXPECT_EQ(matches[0], (Match{0, input.size()}));
+
+    input = std::string(200000, 'a') + "ba";
+    matches = searcher.findAll(input);
+    ASSERT_EQ(matches.size(), 200001);
+    EXPECT_EQ(matches[123456], (Match{123456, 1}));
+    EXPECT_EQ(matches.back(), (Match{200001, 1}));
+}
+
+TEST(SearcherTest, FindStaysLinearWithoutAnEarlyMatch) {
+    // An anchored scan from every a to the end of the input would take minutes here
+    std::string input(200000, 'a');
+    EXPECT_EQ(Searcher("a+b").find(input), std::nullopt);
+
+    // Every a before the b starts a scan that runs on to the b, where the first match is
+    Searcher searcher("a(a|b)*c|b");
+    input += "b";
+    EXPECT_EQ(searcher.find(input), (Match{200000, 1}));
+    input += "c";
+    EXPECT_EQ(searcher.find(input), (Match{0, input.size()}));
+    EXPECT_EQ(searcher.find(input, 5), (Match{5, input.size() - 5}));
+}
+
+TEST_F(AutomataTransformationsTest, ReverseAndUnanchoredNFA) {
+    NFA nfa = RegexToNFA::fromRegex("ab(c)*");
+    NFA reversed = AutomataTransformations::reverse_nfa(nfa);
+    EXPECT_TRUE(simulateNFA(reversed, "ba"));
+    EXPECT_TRUE(simulateNFA(reversed, "ccba"));
+    EXPECT_FALSE(simulateNFA(reversed, "abc"));
+
+    NFA unanchored = AutomataTransformations::unanchored_nfa(nfa);
+    EXPECT_TRUE(simulateNFA(unanchored, "xxabcc"));
+    EXPECT_TRUE(simulateNFA(unanchored, "ab"));
+    EXPECT_FALSE(simulateNFA(unanchored, "abx"));
+}
+
+// TaggedDFA Tests
+TEST(TaggedDFATest, ReportsCapturesOfLongestMatch) {
+    TaggedDFA dfa({"(?<int>[0-9]+)(\\.(?<frac>[0-9]+))?([eE](?<exp>[0-9]+))?", "(?<key>[a-z]+)=(?<value>[a-z0-9]*)"});
+    int rule;
+    std::vector<Capture> captures;
+
+    EXPECT_EQ(dfa.longestPrefix("12.5e3;", rule, captures), 6);
+    EXPECT_EQ(rule, 0);
+    EXPECT_EQ(captures, (std::vector<Capture>{{0, 2}, {3, 1}, {5, 1}}));
+
+    EXPECT_EQ(dfa.longestPrefix("7e", rule, captures), 1);
+    EXPECT_EQ(captures, (std::vector<Capture>{{0, 1}, {Capture::UNSET, 0}, {Capture::UNSET, 0}}));
+
+    EXPECT_EQ(dfa.longestPrefix("key=v4l ", rule, captures), 7);
+    EXPECT_EQ(rule, 1);
+    EXPECT_EQ(dfa.getCaptureNames(rule), (std::vector<std::string>{"key", "value"}));
+    EXPECT_EQ(captures, (std::vector<Capture>{{0, 3}, {4, 3}}));
+
+    EXPECT_EQ(dfa.longestPrefix("k=", rule, captures), 2);
+    EXPECT_EQ(captures, (std::vector<Capture>{{0, 1}, {2, 0}}));
+
+    EXPECT_EQ(dfa.longestPrefix("=", rule, captures), TaggedDFA::NO_MATCH);
+    EXPECT_TRUE(captures.empty());
+}
+
+TEST(TaggedDFATest, PrefersLeftAlternativesAndLongerRepetitions) {
+    int rule;
+    std::vector<Capture> captures;
+
+    TaggedDFA greedy({"(?<a>x*)(?<b>x*)"});
+    EXPECT_EQ(greedy.longestPrefix("xxx", rule, captures), 3);
+    EXPECT_EQ(captures, (std::vector<Capture>{{0, 3}, {3, 0}}));
+
+    TaggedDFA alternation({"(?<a>x|xy)(?<b>y?)"});
+    EXPECT_EQ(alternation.longestPrefix("xy", rule, captures), 2);
+    EXPECT_EQ(captures, (std::vector<Capture>{{0, 1}, {1, 1}}));
+
+    // A repeated group reports its last repetition
+    TaggedDFA repeated({"((?<letter>[a-z])[0-9])+"});
+    EXPECT_EQ(repeated.longestPrefix("a1b2c", rule, captures), 4);
+    EXPECT_EQ(captures, (std::vector<Capture>{{2, 1}}));
+
+    // Swapping threads each step needs the spare register to break the copy cycle
+    TaggedDFA swapped({"((?<a>x)|x)((?<b>x)|x)*"});
+    EXPECT_EQ(swapped.longestPrefix("xxxx", rule, captures), 4);
+    EXPECT_EQ(captures, (std::vector<Capture>{{0, 1}, {3, 1}}));
+}
+
+TEST(TaggedDFATest, AgreesWithCompiledDFAOnLengthAndRule) {
+    std::vector<std::string> rules = {"(?<kw>if|else)", "(?<head>[a-z])(?<tail>[a-z0-9]*)", "(?<digits>[0-9]+)",
+                                      "(?<n>[0-9]+)\\.(?<m>[0-9]*)", "((?<space> )|\t)+"};
+    TaggedDFA tagged(rules);
+    CompiledDFA dfa(AutomataTransformations::minimize_dfa(
+            AutomataTransformations::nfa_to_dfa(RegexToNFA::fromRules(rules))));
+
+    std::mt19937 rng(41);
+    const std::string alphabet = "ifels09. \t-";
+    int taggedRule;
+    int rule;
+    std::vector<Capture> captures;
+    TaggedDFA::Registers registers;
+    for (int i = 0; i < 2000; ++i) {
+        std::string input;
+        size_t length = rng() % 8;
+        for (size_t j = 0; j < length; ++j) {
+            input += alphabet[rng() % alphabet.size()];
+        }
+        size_t taggedLength = tagged.longestPrefix(input, taggedRule, captures, registers);
+        ASSERT_EQ(taggedLength, dfa.longestPrefix(input, rule)) << input;
+        if (taggedLength == TaggedDFA::NO_MATCH) continue;
+        EXPECT_EQ(taggedRule, rule) << input;
+        for (const auto& capture : captures) {
+            if (capture.offset != Capture::UNSET) {
+                EXPECT_LE(capture.offset + capture.length, taggedLength) << input;
+            }
+        }
+    }
+}
+
+// LazyDFA Tests
+TEST(LazyDFATest, AgreesWithEagerDFA) {
+    NFA nfa = RegexToNFA::fromRegex("(a|b)*abb|ba*");
+    CompiledDFA eager(AutomataTransformations::nfa_to_dfa(nfa));
+    LazyDFA lazy(nfa);
+
+    std::mt19937 rng(3);
+    for (int i = 0; i < 1000; ++i) {
+        std::string input;
+        size_t length = rng() % 12;
+        for (size_t j = 0; j < length; ++j) {
+            input += static_cast<char>('a' + rng() % 3);
+        }
+        EXPECT_EQ(lazy.match(input), eager.match(input)) << input;
+        EXPECT_EQ(lazy.longestPrefix(input), eager.longestPrefix(input)) << input;
+    }
+    EXPECT_EQ(lazy.getCacheClears(), 0);
+    EXPECT_LE(lazy.getCachedStateCount(), AutomataTransformations::nfa_to_dfa(nfa).getStates().size());
+}
+
+TEST(LazyDFATest, StaysWithinBudgetOnExponentialPattern) {
+    // The full DFA for (a|b)*a(a|b)^12 has 2^13 states
+    std::string regex = "(a|b)*a";
+    for (int i = 0; i < 12; ++i) {
+        regex += "(a|b)";
+    }
+    NFA nfa = RegexToNFA::fromRegex(regex);
+    const size_t budget = 16 * 1024;
+    LazyDFA lazy(nfa, budget);
+
+    std::mt19937 rng(5);
+    std::string input;
+    for (int i = 0; i < 20000; ++i) {
+        input += rng() % 2 ? 'a' : 'b';
+    }
+
+    for (size_t end = 100; end <= input.size(); end += 4975) {
+        std::string_view prefix(input.data(), end);
+        EXPECT_EQ(lazy.match(prefix), prefix[prefix.size() - 13] == 'a');
+        EXPECT_LE(lazy.getCacheBytes(), budget);
+    }
+    EXPECT_GT(lazy.getCacheClears(), 0);
+}
+
+TEST(LazyDFATest, FallsBackToNFASimulationWhenThrashing) {
+    std::string regex = "(a|b)*a";
+    for (int i = 0; i < 10; ++i) {
+        regex += "(a|b)";
+    }
+    NFA nfa = RegexToNFA::fromRegex(regex);
+    // Room for only a handful of states
+    LazyDFA lazy(nfa, 1024);
+
+    std::mt19937 rng(11);
+    std::string input;
+    for (int i = 0; i < 5000; ++i) {
+        input += rng() % 2 ? 'a' : 'b';
+    }
+    input[input.size() - 11] = 'a';
+
+    EXPECT_TRUE(lazy.match(input));
+    EXPECT_EQ(lazy.longestPrefix(input), input.size());
+    EXPECT_GT(lazy.getFallbackCount(), 0);
+}
+
+TEST(LazyDFATest, EmptyNFAMatchesNothing) {
+    LazyDFA lazy{NFA()};
+
+    EXPECT_FALSE(lazy.match(""));
+    EXPECT_EQ(lazy.longestPrefix("a"), LazyDFA::NO_MATCH);
+}
+
+// Construction budget Tests
+static std::string exponentialRegex(int tail) {
+    return "(a|b)*a(a|b){" + std::to_string(tail) + "}";
+}
+
+TEST(ConstructionBudgetTest, AbortsWithReport) {
+    // Unbudgeted, the DFA would have 2^31 states
+    FrozenNFA nfa = RegexToNFA::frozenFromRules({exponentialRegex(30)});
+    ConstructionBudget budget;
+    budget.maxStates = 1000;
+
+    try {
+        (void) AutomataTransformations::nfa_to_dfa(nfa, budget);
+        FAIL() << "expected the state budget to be exceeded";
+    } catch (const ConstructionBudgetExceeded& error) {
+        const ConstructionReport& report = error.getReport();
+        EXPECT_EQ(report.exceeded, ConstructionReport::Limit::STATES);
+        EXPECT_GT(report.states, 1000);
+        EXPECT_LE(report.expandedStates, 1000);
+        EXPECT_GT(report.bytes, 0);
+        EXPECT_EQ(std::string(error.what()).rfind("Invalid DFA construction: exceeded the state budget after", 0), 0)
+                << error.what();
+    }
+
+    budget = {};
+    budget.maxBytes = 64 * 1024;
+    try {
+        (void) AutomataTransformations::nfa_to_dfa(nfa, budget);
+        FAIL() << "expected the memory budget to be exceeded";
+    } catch (const ConstructionBudgetExceeded& error) {
+        EXPECT_EQ(error.getReport().exceeded, ConstructionReport::Limit::BYTES);
+        EXPECT_LT(error.getReport().bytes, 2 * budget.maxBytes);
+    }
+
+    budget = {};
+    budget.timeout = std::chrono::steady_clock::duration::zero();
+    try {
+        (void) AutomataTransformations::nfa_to_dfa(nfa, budget);
+        FAIL() << "expected the time budget to be exceeded";
+    } catch (const ConstructionBudgetExceeded& error) {
+        EXPECT_EQ(error.getReport().exceeded, ConstructionReport::Limit::TIME);
+    }
+}
+
+TEST(ConstructionBudgetTest, WithinBudgetBuildsTheSameDFA) {
+    NFA nfa = RegexToNFA::fromRegex(exponentialRegex(4));
+    DFA unbudgeted = AutomataTransformations::nfa_to_dfa(nfa);
+    ConstructionBudget budget;
+    budget.maxStates = unbudgeted.getStates().size();
+    budget.maxBytes = 1 << 20;
+    budget.timeout = std::chrono::seconds(10);
+
+    DFA budgeted = AutomataTransformations::nfa_to_dfa(nfa, budget);
+    EXPECT_EQ(budgeted.getStates(), unbudgeted.getStates());
+    EXPECT_EQ(budgeted.getAcceptState(), unbudgeted.getAcceptState());
+    EXPECT_EQ(budgeted.getTransitionTable(), unbudgeted.getTransitionTable());
+
+    budget.maxStates--;
+    EXPECT_THROW((void) AutomataTransformations::nfa_to_dfa(nfa, budget), ConstructionBudgetExceeded);
+}
+
+TEST(ConstructionBudgetTest, LexerRejectsRulesOverBudget) {
+    ConstructionBudget budget;
+    budget.maxStates = 500;
+    EXPECT_THROW(Lexer({{1, exponentialRegex(20)}, {2, " +"}}, CompiledDFA::Encoding::DENSE, budget),
+                 ConstructionBudgetExceeded);
+    EXPECT_NO_THROW(Lexer({{1, "[a-z]+"}, {2, " +"}}, CompiledDFA::Encoding::DENSE, budget));
+}
+
+// ParallelConstruction Tests
+static std::vector<std::string> createKeywordRules(unsigned seed) {
+    std::mt19937 rng(seed);
+    std::string keywords = "if|else|while|for|return|int";
+    for (int keyword = 0; keyword < 200; ++keyword) {
+        keywords += '|';
+        for (size_t length = 3 + rng() % 6; length > 0; --length) {
+            keywords += static_cast<char>('a' + rng() % 26);
+        }
+    }
+    return {keywords, "[a-z_][a-z0-9_]*", "[0-9]+", " +"};
+}
+
+TEST(ParallelConstructionTest, SubsetConstructionMatchesSequential) {
+    for (const auto& rules : std::vector<std::vector<std::string>>{createKeywordRules(7), {exponentialRegex(9)},
+                                                                  {"(a|b)*abb|ba*", "c+"}}) {
+        FrozenNFA nfa = RegexToNFA::frozenFromRules(rules);
+        DFA sequential = AutomataTransformations::nfa_to_dfa(nfa);
+        for (unsigned threads : {1, 4, 16}) {
+            DFA parallel = ParallelConstruction::nfa_to_dfa(nfa, threads);
+            EXPECT_EQ(parallel.getStartState(), sequential.getStartState()) << threads;
+            EXPECT_EQ(parallel.getStates(), sequential.getStates()) << threads;
+            EXPECT_EQ(parallel.getAcceptRules(), sequential.getAcceptRules()) << threads;
+            EXPECT_EQ(parallel.getTransitionTable(), sequential.getTransitionTable()) << threads;
+        }
+    }
+
+    ConstructionBudget budget;
+    budget.maxStates = 300;
+    EXPECT_THROW((void) ParallelConstruction::nfa_to_dfa(RegexToNFA::frozenFromRules({exponentialRegex(20)}), 4, budget),
+                 ConstructionBudgetExceeded);
+    EXPECT_EQ(ParallelConstruction::nfa_to_dfa(FrozenNFA(), 4).getStates().size(), 0);
+}
+
+TEST(ParallelConstructionTest, BudgetStopsWithinALevel) {
+    // The levels double in size, so stopping at a level boundary would overshoot the budgets by a whole level
+    FrozenNFA nfa = RegexToNFA::frozenFromRules({exponentialRegex(30)});
+    ConstructionBudget budget;
+    budget.maxStates = 700;
+    try {
+        (void) ParallelConstruction::nfa_to_dfa(nfa, 4, budget);
+        FAIL() << "expected the state budget to be exceeded";
+    } catch (const ConstructionBudgetExceeded& error) {
+        const ConstructionReport& report = error.getReport();
+        EXPECT_EQ(report.exceeded, ConstructionReport::Limit::STATES);
+        EXPECT_LE(report.expandedStates, 700);
+        // Past the budget, every thread may finish the state it is expanding, each finding at most two new states.
+        // The level the budget runs out in would take the states from about 512 to 1024.
+        EXPECT_LE(report.states, 700 + 1 + 4 * 2);
+    }
+
+    budget = {};
+    budget.timeout = std::chrono::milliseconds(20);
+    try {
+        (void) ParallelConstruction::nfa_to_dfa(nfa, 4, budget);
+        FAIL() << "expected the time budget to be exceeded";
+    } catch (const ConstructionBudgetExceeded& error) {
+        EXPECT_EQ(error.getReport().exceeded, ConstructionReport::Limit::TIME);
+        EXPECT_LT(error.getReport().seconds, 5.0);
+    }
+}
+
+// The rule and the targets on every byte of each state, with the states numbered breadth first over the bytes in
+// order, so equal DFAs give equal tables however their states were numbered
+static std::vector<std::vector<int>> canonicalTable(const CompiledDFA& dfa) {
+    std::vector<int> index(dfa.getStateCount(), -1);
+    std::vector<uint32_t> order = {dfa.getStartState()};
+    index[dfa.getStartState()] = 0;
+    std::vector<std::vector<int>> table;
+    for (size_t i = 0; i < order.size(); ++i) {
+        std::vector<int> row = {dfa.getAcceptRule(order[i])};
+        for (int byte = 0; byte < 256; ++byte) {
+            uint32_t target = dfa.getTransition(order[i], static_cast<unsigned char>(byte));
+            if (target != CompiledDFA::DEAD_STATE && index[target] < 0) {
+                index[target] = static_cast<int>(order.size());
+                order.push_back(target);
+            }
+            row.push_back(target == CompiledDFA::DEAD_STATE ? -1 : index[target]);
+        }
+        table.push_back(std::move(row));
+    }
+    return table;
+}
+
+TEST(ParallelConstructionTest, MinimizationMatchesHopcroft) {
+    for (const auto& rules : std::vector<std::vector<std::string>>{createKeywordRules(9), {exponentialRegex(6)},
+                                                                  {"(a|b)*abb|ba*", "c+"}, {"a{40}b"}, {"[^a]"},
+                                                                  {"a", "a"}}) {
+        DFA dfa = AutomataTransformations::nfa_to_dfa(RegexToNFA::frozenFromRules(rules));
+        DFA hopcroft = AutomataTransformations::minimize_dfa(dfa);
+        DFA single = ParallelConstruction::minimize_dfa(dfa, 1);
+        EXPECT_EQ(single.getStates().size(), hopcroft.getStates().size()) << rules[0];
+        EXPECT_EQ(canonicalTable(CompiledDFA(single)), canonicalTable(CompiledDFA(hopcroft))) << rules[0];
+
+        for (unsigned threads : {4, 16}) {
+            DFA parallel = ParallelConstruction::minimize_dfa(dfa, threads);
+            EXPECT_EQ(parallel.getTransitionTable(), single.getTransitionTable()) << threads;
+            EXPECT_EQ(parallel.getAcceptRules(), single.getAcceptRules()) << threads;
+        }
+    }
+
+    EXPECT_TRUE(ParallelConstruction::minimize_dfa(DFA(), 4).getStates().empty());
+}
+
+TEST(ParallelConstructionTest, LexerTokenizesLikeSequential) {
+    std::vector<std::string> regexes = createKeywordRules(11);
+    std::vector<Lexer::Rule> rules;
+    for (size_t rule = 0; rule < regexes.size(); ++rule) {
+        rules.push_back({static_cast<int>(rule) + 1, regexes[rule]});
+    }
+    Lexer sequential(rules);
+    Lexer parallel(rules, CompiledDFA::Encoding::DENSE, {}, 4);
+
+    EXPECT_EQ(parallel.getDFA().getStateCount(), sequential.getDFA().getStateCount());
+    std::string input = "if else while x1 42 " + createKeywordRules(11)[0].substr(0, 200);
+    std::replace(input.begin(), input.end(), '|', ' ');
+    EXPECT_EQ(parallel.tokenize(input), sequential.tokenize(input));
+}
+
+// HybridDFA Tests
+TEST(HybridDFATest, SimulatesBeyondTheBudget) {
+    std::mt19937 rng(41);
+    for (size_t maxStates : {0, 1, 50, 400}) {
+        FrozenNFA nfa = RegexToNFA::frozenFromRules({exponentialRegex(30) + "c?"});
+        ConstructionBudget budget;
+        budget.maxStates = maxStates;
+        HybridDFA hybrid(nfa, budget);
+        PikeVM reference(nfa);
+
+        EXPECT_FALSE(hybrid.isComplete());
+        EXPECT_LE(hybrid.getStateCount(), maxStates);
+        EXPECT_GT(hybrid.getFrontierCount(), 0);
+        EXPECT_EQ(hybrid.getReport().exceeded, ConstructionReport::Limit::STATES);
+
+        for (int i = 0; i < 300; ++i) {
+            std::string input;
+            size_t length = rng() % 64;
+            for (size_t j = 0; j < length; ++j) {
+                input += "aabbc"[rng() % 5];
+            }
+            EXPECT_EQ(hybrid.match(input), reference.match(input)) << maxStates << " " << input;
+            EXPECT_EQ(hybrid.longestPrefix(input), reference.longestPrefix(input)) << maxStates << " " << input;
+        }
+    }
+}
+
+TEST(HybridDFATest, CompleteWithinBudget) {
+    NFA nfa = RegexToNFA::fromRegex("(a|b)*abb|ba*");
+    CompiledDFA dfa(AutomataTransformations::nfa_to_dfa(nfa));
+    HybridDFA hybrid(nfa, ConstructionBudget{});
+
+    EXPECT_TRUE(hybrid.isComplete());
+    EXPECT_EQ(hybrid.getStateCount(), dfa.getStateCount() - 1);
+    EXPECT_EQ(hybrid.getReport().exceeded, ConstructionReport::Limit::NONE);
+    for (const std::string input : {"", "abb", "babb", "baaa", "ab", "c", "abbc"}) {
+        EXPECT_EQ(hybrid.match(input), dfa.match(input)) << input;
+        EXPECT_EQ(hybrid.longestPrefix(input), dfa.longestPrefix(input)) << input;
+    }
+
+    HybridDFA empty(NFA(), ConstructionBudget{});
+    EXPECT_FALSE(empty.match(""));
+    EXPECT_EQ(empty.longestPrefix("a"), HybridDFA::NO_MATCH);
+}
+
+// NFA simulation Tests
+TEST(NFAMatcherTest, EnginesAgreeWithCompiledDFA) {
+    std::mt19937 rng(17);
+    for (const std::string regex : {"(a|b)*abb|ba*", "a?b+c{2,3}|[a-c]{4}", "(ab|a)*b?", "[^a]*a[^a]{1,2}", "c?"}) {
+        NFA nfa = RegexToNFA::fromRegex(regex);
+        CompiledDFA dfa(AutomataTransformations::nfa_to_dfa(nfa));
+        PikeVM pikeVM(nfa);
+        BitParallelNFA bitParallel(nfa);
+
+        for (int i = 0; i < 500; ++i) {
+            std::string input;
+            size_t length = rng() % 10;
+            for (size_t j = 0; j < length; ++j) {
+                input += static_cast<char>('a' + rng() % 4);
+            }
+            EXPECT_EQ(pikeVM.match(input), dfa.match(input)) << regex << " " << input;
+            EXPECT_EQ(pikeVM.longestPrefix(input), dfa.longestPrefix(input)) << regex << " " << input;
+            EXPECT_EQ(bitParallel.match(input), dfa.match(input)) << regex << " " << input;
+            EXPECT_EQ(bitParallel.longestPrefix(input), dfa.longestPrefix(input)) << regex << " " << input;
+        }
+    }
+}
+
+TEST(NFAMatcherTest, PicksEngineBySize) {
+    // (a|b)*a(a|b)^n has 3 + 2n byte edges
+    auto exponential = [](int n) {
+        std::string regex = "(a|b)*a";
+        for (int i = 0; i < n; ++i) {
+            regex += "(a|b)";
+        }
+        return RegexToNFA::fromRegex(regex);
+    };
+    NFAMatcher small(exponential(30));
+    NFAMatcher large(exponential(40));
+    EXPECT_EQ(small.getEngine(), NFAMatcher::Engine::BIT_PARALLEL);
+    EXPECT_EQ(large.getEngine(), NFAMatcher::Engine::PIKE_VM);
+    EXPECT_THROW(BitParallelNFA{exponential(40)}, std::runtime_error);
+
+    std::mt19937 rng(23);
+    std::string input;
+    for (int i = 0; i < 3000; ++i) {
+        input += rng() % 2 ? 'a' : 'b';
+    }
+    for (size_t end = 41; end <= input.size(); end += 997) {
+        std::string_view prefix(input.data(), end);
+        EXPECT_EQ(small.match(prefix), prefix[prefix.size() - 31] == 'a');
+        EXPECT_EQ(large.match(prefix), prefix[prefix.size() - 41] == 'a');
+    }
+    EXPECT_EQ(large.longestPrefix("bbb"), NFAMatcher::NO_MATCH);
+    EXPECT_FALSE(NFAMatcher(NFA()).match(""));
+}
+
+// Stats Tests, with the test build always defining SYPHON_STATS
+TEST(StatsTest, CountsConstructionPhases) {
+    Stats::Construction stats;
+    NFA nfa;
+    DFA dfa;
+    DFA minimized;
+    {
+        Stats::Collector collector(stats);
+        nfa = RegexToNFA::fromRegex("(a|b)*abb");
+        dfa = AutomataTransformations::nfa_to_dfa(nfa);
+        minimized = AutomataTransformations::minimize_dfa(dfa);
+    }
+    AutomataTransformations::minimize_dfa(dfa);
+
+    EXPECT_EQ(stats.nfaStates, nfa.getStates().size());
+    EXPECT_GT(stats.nfaEdges, 0);
+    EXPECT_EQ(stats.epsilonClosures, stats.nfaStates);
+    EXPECT_EQ(stats.dfaStates, dfa.getStates().size());
+    EXPECT_EQ(stats.subsetLookups, stats.dfaStates + stats.subsetHits);
+    EXPECT_GT(stats.subsetHits, 0);
+    EXPECT_EQ(stats.minimizedStates, minimized.getStates().size());
+    EXPECT_GT(stats.refinementIterations, 0);
+
+    // fromRegex runs fromPostfix within its own phase, which counts once. Minimizing after the collector is gone does
+    // not count at all.
+    for (const auto* phase : {&stats.regexToNFA, &stats.subsetConstruction, &stats.minimization}) {
+        EXPECT_EQ(phase->runs, 1);
+        EXPECT_GT(phase->seconds, 0);
+        EXPECT_GT(phase->bytesAllocated, 0);
+    }
+
+    std::string json = stats.toJSON();
+    EXPECT_EQ(json.front(), '{');
+    EXPECT_EQ(json.back(), '}');
+    EXPECT_NE(json.find("\"enabled\":true"), std::string::npos);
+    EXPECT_NE(json.find("\"minimized_states\":" + std::to_string(stats.minimizedStates)), std::string::npos);
+    EXPECT_NE(json.find("\"minimization\":{\"runs\":1,"), std::string::npos);
+}
+
+TEST(StatsTest, CountsStateVisitsAndDeadStateExits) {
+    CompiledDFA dfa = compileRegex("ab*c");
+    Stats::Matching stats;
+    {
+        Stats::Collector collector(stats);
+        EXPECT_TRUE(dfa.match("abbc"));
+        EXPECT_EQ(dfa.longestPrefix("axc"), CompiledDFA::NO_MATCH);
+    }
+    EXPECT_TRUE(dfa.match("abc"));
+
+    EXPECT_EQ(stats.scans, 2);
+    EXPECT_EQ(stats.bytes, 6);
+    EXPECT_EQ(stats.deadStateExits, 1);
+    uint64_t visits = 0;
+    for (uint64_t count : stats.stateVisits) {
+        visits += count;
+    }
+    // Every byte stepped over, and the start state once per scan
+    EXPECT_EQ(visits, 7);
+    // The state after the a loops on b, so it is entered by both a's and both b's
+    EXPECT_EQ(stats.stateVisits[dfa.getTransition(dfa.getStartState(), 'a')], 4);
+    EXPECT_NE(stats.toJSON().find("\"dead_state_exits\":1,\"state_visits\":["), std::string::npos);
+}
+
+// KeywordTable Tests
+TEST(KeywordTableTest, FindsEveryKeywordAndNothingElse) {
+    std::mt19937 rng(43);
+    std::vector<KeywordTable::Keyword> keywords;
+    for (int keyword = 0; keyword < 1000; ++keyword) {
+        std::string word;
+        for (size_t length = 1 + rng() % 10; length > 0; --length) {
+            word += static_cast<char>('a' + rng() % 26);
+        }
+        keywords.push_back({word, keyword});
+    }
+    keywords.push_back({keywords[5].word, -7});
+    KeywordTable table(keywords);
+
+    std::set<std::string> words;
+    for (const auto& keyword : keywords) {
+        words.insert(keyword.word);
+    }
+    EXPECT_EQ(table.size(), words.size());
+    for (const auto& keyword : keywords) {
+        int first = std::find_if(keywords.begin(), keywords.end(), [&keyword](const auto& other) {
+            return other.word == keyword.word;
+        })->tokenId;
+        EXPECT_EQ(table.find(keyword.word), first) << keyword.word;
+
+        for (const std::string& other : {keyword.word + "a", keyword.word.substr(1), "_" + keyword.word}) {
+            if (!words.count(other)) {
+                EXPECT_EQ(table.find(other), KeywordTable::NO_KEYWORD) << other;
+            }
+        }
+    }
+    EXPECT_EQ(table.find(""), KeywordTable::NO_KEYWORD);
+    EXPECT_EQ(table.getSeeds().size(), (words.size() + 3) / 4);
+
+    KeywordTable empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(empty.find("if"), KeywordTable::NO_KEYWORD);
+    EXPECT_TRUE(KeywordTable(std::vector<KeywordTable::Keyword>{}).empty());
+}
+
+TEST(KeywordTableTest, LexerTokenizesLikeTheMergedLexer) {
+    std::vector<std::string> regexes = createKeywordRules(13);
+    std::vector<Lexer::Rule> rules;
+    for (size_t rule = 0; rule < regexes.size(); ++rule) {
+        rules.push_back({static_cast<int>(rule) + 1, regexes[rule]});
+    }
+    Lexer merged(rules);
+    Lexer hashed(rules, CompiledDFA::Encoding::DENSE, {}, 1, true);
+
+    // The keyword rule is left out, the identifier rule carries its words
+    EXPECT_LT(hashed.getDFA().getStateCount() * 10, merged.getDFA().getStateCount());
+    EXPECT_GE(hashed.getKeywordTable().size(), 200);
+    EXPECT_EQ(hashed.getTokenIds(), (std::vector<int>{2, 3, 4}));
+    EXPECT_TRUE(hashed.isKeywordCarrier(0));
+    EXPECT_FALSE(hashed.isKeywordCarrier(1));
+
+    std::string input = "if else whilex x1 _for 42 returns int " + regexes[0].substr(0, 400);
+    std::replace(input.begin(), input.end(), '|', ' ');
+    std::vector<Token> expected = merged.tokenize(input);
+    EXPECT_EQ(hashed.tokenize(input), expected);
+    EXPECT_EQ(hashed.tokenizeParallel(input, 4, 16), expected);
+    for (size_t chunkSize : {1, 3, 64}) {
+        LexerStream stream(hashed);
+        std::vector<Token> streamed;
+        auto collect = [&streamed](const Token& token) { streamed.push_back(token); };
+        for (size_t at = 0; at < input.size(); at += chunkSize) {
+            stream.feed(std::string_view(input).substr(at, chunkSize), collect);
+        }
+        stream.finish(collect);
+        EXPECT_EQ(streamed, expected) << chunkSize;
+    }
+
+    EXPECT_THROW(hashed.save((std::filesystem::temp_directory_path() / "syphon_keywords.dfa").string()), std::runtime_error);
+}
+
+TEST(KeywordTableTest, KeepsKeywordsTheIdentifierRuleMisses) {
+    auto tokenizeBoth = [](const std::vector<Lexer::Rule>& rules, const std::string& input) {
+        Lexer hashed(rules, CompiledDFA::Encoding::DENSE, {}, 1, true);
+        EXPECT_EQ(hashed.tokenize(input), Lexer(rules).tokenize(input)) << input;
+        return hashed.getKeywordTable().size();
+    };
+
+    // 'i' is no identifier letter, so "if" stays in the DFA
+    EXPECT_EQ(tokenizeBoth({{IF, "if"}, {IDENT, "[a-f]+"}}, "ifabif"), 0);
+    // One word of the rule is missed, so the whole rule stays
+    EXPECT_EQ(tokenizeBoth({{IF, "(if|else|9x)"}, {IDENT, "[a-z]+"}, {AB_RUN, "[0-9]+"}}, "if9xelse"), 0);
+    // Not a word
+    EXPECT_EQ(tokenizeBoth({{IF, "i(f)"}, {IDENT, "[a-z]+"}}, "ifx if"), 0);
+    // The identifier rule comes first, so it wins over the keyword anyway
+    EXPECT_EQ(tokenizeBoth({{IDENT, "[a-z]+"}, {IF, "if"}}, "if iff"), 0);
+    EXPECT_EQ(tokenizeBoth({{IF, "if|else"}, {AB_RUN, "else"}, {IDENT, "[a-z]+"}}, "ifelse else if"), 2);
+
+    // Nothing but keywords leaves no rule to carry them
+    EXPECT_EQ(tokenizeBoth({{IF, "if"}, {IDENT, "else"}}, "ifelse"), 0);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""Generates lexer/unicodeTables.cpp, the code point ranges behind \\p{...} in regexes.
+
+The tables hold every two-letter general category but Cn (unassigned) and Cs (surrogates, which UTF-8 cannot
+encode), plus XID_Start and XID_Continue. They follow the Unicode version of the Python running this script.
+
+    python3 tools/generate_unicode_tables.py > lexer/unicodeTables.cpp
+"""
+
+import unicodedata
+from collections import defaultdict
+
+MAX_CODE_POINT = 0x10FFFF
+
+
+def add(ranges, code_point):
+    if ranges and ranges[-1][1] == code_point - 1:
+        ranges[-1][1] = code_point
+    else:
+        ranges.append([code_point, code_point])
+
+
+def collect():
+    properties = defaultdict(list)
+    for code_point in range(MAX_CODE_POINT + 1):
+        char = chr(code_point)
+        category = unicodedata.category(char)
+        if category not in ("Cn", "Cs"):
+            add(properties[category], code_point)
+        # Python identifiers are XID_Start plus '_' followed by XID_Continue
+        if char.isidentifier() and char != "_":
+            add(properties["XID_Start"], code_point)
+        if ("a" + char).isidentifier():
+            add(properties["XID_Continue"], code_point)
+    return properties
+
+
+def main():
+    properties = collect()
+    print("//")
+    print("// Generated by tools/generate_unicode_tables.py from Unicode %s. Do not edit." % unicodedata.unidata_version)
+    print("//")
+    print()
+    print("#include <iterator>")
+    print('#include "unicodeTables.h"')
+    print()
+    print("namespace {")
+    for name in sorted(properties):
+        ranges = properties[name]
+        print()
+        print("constexpr CodePointRange %s[] = {" % name.replace("_", ""))
+        line = "   "
+        for low, high in ranges:
+            entry = " {0x%X, 0x%X}," % (low, high)
+            if len(line) + len(entry) > 120:
+                print(line)
+                line = "   "
+            line += entry
+        print(line)
+        print("};")
+    print()
+    print("} // namespace")
+    print()
+    print('const char UnicodeTables::VERSION[] = "%s";' % unicodedata.unidata_version)
+    print()
+    print("const UnicodeTables::Property UnicodeTables::PROPERTIES[] = {")
+    for name in sorted(properties):
+        print('        {"%s", %s, std::size(%s)},' % (name, name.replace("_", ""), name.replace("_", "")))
+    print("};")
+    print()
+    print("const size_t UnicodeTables::PROPERTY_COUNT = std::size(UnicodeTables::PROPERTIES);")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,111 @@
+//
+// Created by jskad on 16-10-2026.
+//
+
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "codeGenerator.h"
+#include "lexer.h"
+#include "lexerSpec.h"
+#include "stats.h"
+
+static int usage(const char* program) {
+    std::cerr << "usage: " << program << " <spec> -o <output> [options]\n"
+              << "       " << program << " <spec> -o <output.cpp> --cpp <namespace> [--table] [options]\n"
+              << "options: --stats <stats.json> --max-states <n> --threads <n> --keyword-table" << std::endl;
+    return 2;
+}
+
+static void writeFile(const std::string& path, const std::string& contents) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << contents;
+    if (!file) throw std::runtime_error("Cannot write " + path);
+}
+
+// Compiles a lexer spec file, either into a DFA file that Lexer::load maps at startup, or with --cpp into a C++
+// scanner. The scanner source is written to the output path and its header next to it, with the extension replaced
+// by .h. --table emits a table-driven scanner instead of a direct-coded one. --stats writes the construction
+// statistics as JSON, which needs a build with SYPHON_STATS. --max-states fails the compile, with a report of how far
+// it got, once the DFA has more states than given. --threads builds the DFA on that many threads, 0 meaning one per
+// hardware thread. --keyword-table keeps keyword rules out of the DFA where an identifier rule matches their words,
+// see Lexer, and looks up identifiers in a perfect hash table instead. DFA files cannot hold the table, so it needs
+// --cpp.
+int main(int argc, char* argv[]) {
+    std::string specPath;
+    std::string outputPath;
+    std::string name;
+    std::string statsPath;
+    bool table = false;
+    bool keywordTable = false;
+    ConstructionBudget budget;
+    unsigned threadCount = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "-o" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (argument == "--cpp" && i + 1 < argc) {
+            name = argv[++i];
+        } else if (argument == "--stats" && i + 1 < argc) {
+            statsPath = argv[++i];
+        } else if (argument == "--max-states" && i + 1 < argc) {
+            char* end;
+            budget.maxStates = std::strtoull(argv[++i], &end, 10);
+            if (*end != '\0') return usage(argv[0]);
+        } else if (argument == "--threads" && i + 1 < argc) {
+            char* end;
+            threadCount = static_cast<unsigned>(std::strtoul(argv[++i], &end, 10));
+            if (*end != '\0') return usage(argv[0]);
+        } else if (argument == "--table") {
+            table = true;
+        } else if (argument == "--keyword-table") {
+            keywordTable = true;
+        } else if (specPath.empty() && argument[0] != '-') {
+            specPath = argument;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (specPath.empty() || outputPath.empty() || ((table || keywordTable) && name.empty())) {
+        return usage(argv[0]);
+    }
+
+    try {
+        if (!statsPath.empty() && !Stats::ENABLED) {
+            throw std::runtime_error("--stats needs a build with SYPHON_STATS");
+        }
+        LexerSpec spec = LexerSpec::fromFile(specPath);
+        Stats::Construction stats;
+        Stats::Collector collector(stats);
+        Lexer lexer(spec.rules, CompiledDFA::Encoding::DENSE, budget, threadCount, keywordTable);
+        if (!statsPath.empty()) {
+            writeFile(statsPath, stats.toJSON() + "\n");
+        }
+        if (name.empty()) {
+            lexer.save(outputPath);
+            return 0;
+        }
+
+        std::filesystem::path headerPath = std::filesystem::path(outputPath).replace_extension(".h");
+        CodeGenerator::Options options;
+        options.name = name;
+        options.style = table ? CodeGenerator::Style::TableDriven : CodeGenerator::Style::DirectCoded;
+        options.headerName = headerPath.filename().string();
+        options.tokenNames = spec.names;
+        for (const auto& rule : spec.rules) {
+            options.tokenNameIds.push_back(rule.tokenId);
+        }
+        options.keywords = &lexer.getKeywordTable();
+
+        GeneratedLexer generated = CodeGenerator::generate(lexer.getDFA(), lexer.getTokenIds(), options);
+        writeFile(headerPath.string(), generated.header);
+        writeFile(outputPath, generated.source);
+    } catch (const std::exception& error) {
+        std::cerr << specPath << ": " << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}